@@ -0,0 +1,86 @@
+// Per-pixel difference of two raw RGBA8 frame streams of the same size
+// (see --export-format raw), e.g. the same seeded frames rendered by the
+// render pipeline and the tile rasterizer, compared by 'make check-tiles'
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define CHUNK_SIZE (1 << 20)
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s <a.raw> <b.raw> <max-diff> <max-rms>\n", program);
+    printf("  max-diff  largest allowed difference of a color channel (0-255)\n");
+    printf("  max-rms   largest allowed root mean square difference\n");
+}
+
+static FILE *openFrames(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 5) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const unsigned long maxDiff = strtoul(argv[3], NULL, 10);
+    const double maxRms = strtod(argv[4], NULL);
+    
+    FILE *a = openFrames(argv[1]);
+    FILE *b = openFrames(argv[2]);
+    static uint8_t bufferA[CHUNK_SIZE];
+    static uint8_t bufferB[CHUNK_SIZE];
+    
+    uint64_t channels = 0;   // compared color channels (alpha is skipped)
+    uint64_t offset = 0;     // bytes read from each file
+    uint32_t worst = 0;
+    uint64_t worstPixel = 0;
+    double squares = 0.0;
+    for (;;) {
+        const size_t sizeA = fread(bufferA, 1, CHUNK_SIZE, a);
+        const size_t sizeB = fread(bufferB, 1, CHUNK_SIZE, b);
+        if (sizeA != sizeB) {
+            fprintf(stderr, "Streams differ in size\n");
+            return EXIT_FAILURE;
+        }
+        if (sizeA == 0) {
+            break;
+        }
+        for (size_t i = 0; i < sizeA; ++i) {
+            // Note: Chunks hold whole pixels, alpha is always opaque
+            if (i % 4 == 3) {
+                continue;
+            }
+            const uint32_t diff = (uint32_t)abs((int)bufferA[i] - (int)bufferB[i]);
+            if (diff > worst) {
+                worst = diff;
+                worstPixel = (offset + i) / 4;
+            }
+            squares += (double)diff * diff;
+            channels++;
+        }
+        offset += sizeA;
+    }
+    fclose(a);
+    fclose(b);
+    
+    if (channels == 0) {
+        fprintf(stderr, "Streams are empty\n");
+        return EXIT_FAILURE;
+    }
+    const double rms = sqrt(squares / (double)channels);
+    const int passed = worst <= maxDiff && rms <= maxRms;
+    printf("%s: max diff %u (pixel %llu), rms %.4f over %llu pixels "
+        "(tolerance: max diff %lu, rms %.4f)\n", passed ? "PASS" : "FAIL",
+        worst, (unsigned long long)worstPixel, rms,
+        (unsigned long long)(channels / 3), maxDiff, maxRms);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,594 @@
+// Headless microbenchmark of the particle update kernel (shader.comp) and its
+// memory layout variants (shaders/bench), built by 'make bench'
+#include "graphics.h"
+#include "vkutils.h"
+
+#include <string.h>
+
+#define MIN_LOG2_PARTICLES 11
+#define MAX_LOG2_PARTICLES 24
+#define DEFAULT_ITERATIONS 50
+#define WARMUP_ITERATIONS 5
+#define MAX_STREAMS 4
+#define MAX_GRID_BINDINGS 8
+
+// Commit the harness was built from (set by Makefile)
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"
+#endif
+
+// Kernel variant and memory layout of its particle buffers
+typedef struct KernelVariant {
+    const char *name;
+    const char *spirvPath;
+    uint32_t streamCount;                // #storage buffers per direction
+    uint32_t streamStrides[MAX_STREAMS]; // bytes per particle of each stream
+    uint32_t gridBindings;               // #grid/order/spark buffers (grid.h)
+} KernelVariant;
+
+static const KernelVariant VARIANTS[] = {
+    // Note: Kernel of the application (std140 array of structs)
+    { "aos_fp32",   "shaders/bin/comp.spv",        1, {48}, 8 },
+    { "soa_fp32",   "shaders/bin/bench/soa.spv",    4, {8, 8, 16, 4}, 0 },
+    { "aos_packed", "shaders/bin/bench/packed.spv", 1, {16}, 0 }
+};
+
+static const uint32_t WORKGROUP_SIZES[] = {64, 128, 256, 512, 1024};
+
+typedef struct BenchContext {
+    VkInstance instance;
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties properties;
+    VkDeviceSize heapSize;        // size of largest device-local heap
+    uint32_t queueFamily;         // compute queue family with timestamps
+    uint64_t timestampMask;       // valid bits of timestamp values
+    VkDevice device;
+    VkQueue queue;
+    VkCommandPool commandPool;
+    VkQueryPool queryPool;        // 2 timestamps per measured iteration
+    uint32_t iterations;          // #measured dispatches per configuration
+} BenchContext;
+
+typedef struct BenchResult {
+    double medianUs;
+    double minUs;
+} BenchResult;
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --device <i>       index of physical device (default 0)\n");
+    printf("  --iterations <n>   measured dispatches per configuration (default %u)\n",
+        DEFAULT_ITERATIONS);
+    printf("  --min-log2 <k>     smallest particle count 2^k (default %u)\n",
+        MIN_LOG2_PARTICLES);
+    printf("  --max-log2 <k>     largest particle count 2^k (default %u)\n",
+        MAX_LOG2_PARTICLES);
+}
+
+static uint32_t parseArgument(int argc, char **argv, int *i)
+{
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "Missing value for option '%s'\n", argv[*i]);
+        exit(EXIT_FAILURE);
+    }
+    char *end = NULL;
+    const unsigned long value = strtoul(argv[*i + 1], &end, 10);
+    if (end == argv[*i + 1] || *end != '\0' || value > UINT32_MAX) {
+        fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[*i + 1],
+            argv[*i]);
+        exit(EXIT_FAILURE);
+    }
+    *i += 1;
+    return (uint32_t)value;
+}
+
+static void initContext(BenchContext *ctx, uint32_t deviceIndex)
+{
+    VkApplicationInfo appInfo = {0};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Fireworks kernelbench";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+    
+    VkInstanceCreateInfo instanceInfo = {0};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    
+    CHK_VK_ERR(vkCreateInstance(&instanceInfo, NULL, &ctx->instance),
+        "Failed to create Vulkan instance\n");
+    
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(ctx->instance, &deviceCount, NULL);
+    if (deviceIndex >= deviceCount) {
+        fprintf(stderr, "No physical device with index %u (%u available)\n",
+            deviceIndex, deviceCount);
+        exit(EXIT_FAILURE);
+    }
+    VkPhysicalDevice *devices = NULL;
+    CHK_ALLOC(devices = malloc(deviceCount * sizeof(VkPhysicalDevice)));
+    vkEnumeratePhysicalDevices(ctx->instance, &deviceCount, devices);
+    ctx->physicalDevice = devices[deviceIndex];
+    free(devices);
+    
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &ctx->properties);
+    
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(ctx->physicalDevice, &memProps);
+    for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+        if ((memProps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+            memProps.memoryHeaps[i].size > ctx->heapSize)
+        {
+            ctx->heapSize = memProps.memoryHeaps[i].size;
+        }
+    }
+    
+    // Find compute queue family supporting timestamps
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalDevice,
+        &familyCount, NULL);
+    VkQueueFamilyProperties *families = NULL;
+    CHK_ALLOC(families = malloc(familyCount * sizeof(VkQueueFamilyProperties)));
+    vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalDevice,
+        &familyCount, families);
+    
+    ctx->queueFamily = familyCount;
+    for (uint32_t i = 0; i < familyCount; ++i) {
+        if ((families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+            families[i].timestampValidBits > 0)
+        {
+            ctx->queueFamily = i;
+            const uint32_t validBits = families[i].timestampValidBits;
+            ctx->timestampMask = validBits >= 64 ?
+                UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+            break;
+        }
+    }
+    free(families);
+    
+    if (ctx->queueFamily == familyCount) {
+        fprintf(stderr, "Device '%s' has no compute queue supporting "
+            "timestamps\n", ctx->properties.deviceName);
+        exit(EXIT_FAILURE);
+    }
+    
+    const float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo = {0};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = ctx->queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+    
+    VkDeviceCreateInfo deviceInfo = {0};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    
+    CHK_VK_ERR(vkCreateDevice(ctx->physicalDevice, &deviceInfo, NULL,
+        &ctx->device), "Failed to create logical device\n");
+    vkGetDeviceQueue(ctx->device, ctx->queueFamily, 0, &ctx->queue);
+    
+    VkCommandPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = ctx->queueFamily;
+    
+    CHK_VK_ERR(vkCreateCommandPool(ctx->device, &poolInfo, NULL,
+        &ctx->commandPool), "Failed to create command pool\n");
+    
+    VkQueryPoolCreateInfo queryInfo = {0};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = 2 * ctx->iterations;
+    
+    CHK_VK_ERR(vkCreateQueryPool(ctx->device, &queryInfo, NULL,
+        &ctx->queryPool), "Failed to create timestamp query pool\n");
+}
+
+static void cleanupContext(BenchContext *ctx)
+{
+    vkDestroyQueryPool(ctx->device, ctx->queryPool, NULL);
+    vkDestroyCommandPool(ctx->device, ctx->commandPool, NULL);
+    vkDestroyDevice(ctx->device, NULL);
+    vkDestroyInstance(ctx->instance, NULL);
+}
+
+static VkDeviceSize alignSize(VkDeviceSize size, VkDeviceSize alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Returns reason why configuration cannot run on device (NULL if it can)
+static const char *checkLimits(const BenchContext *ctx,
+    const KernelVariant *variant, uint32_t workgroupSize, uint32_t particles)
+{
+    const VkPhysicalDeviceLimits *limits = &ctx->properties.limits;
+    if (workgroupSize > limits->maxComputeWorkGroupSize[0] ||
+        workgroupSize > limits->maxComputeWorkGroupInvocations)
+    {
+        return "workgroup size exceeds device limit";
+    }
+    if ((particles + workgroupSize - 1) / workgroupSize >
+        limits->maxComputeWorkGroupCount[0])
+    {
+        return "workgroup count exceeds device limit";
+    }
+    
+    VkDeviceSize total = 0;
+    for (uint32_t s = 0; s < variant->streamCount; ++s) {
+        const VkDeviceSize size = (VkDeviceSize)particles * variant->streamStrides[s];
+        if (size > limits->maxStorageBufferRange) {
+            return "storage buffer range exceeds device limit";
+        }
+        total += size;
+    }
+    // Note: Input and output buffer, leave room for everything else
+    if (2 * total > ctx->heapSize / 2) {
+        return "particle buffers exceed half of device memory";
+    }
+    return NULL;
+}
+
+// Dispatch kernel repeatedly and measure GPU time of every dispatch
+static void runConfiguration(BenchContext *ctx, const KernelVariant *variant,
+    uint32_t workgroupSize, uint32_t particles, BenchResult *result)
+{
+    VkDevice device = ctx->device;
+    const VkDeviceSize alignment =
+        ctx->properties.limits.minStorageBufferOffsetAlignment;
+    
+    // - Particle buffers: streams suballocated from one buffer per direction
+    VkDeviceSize offsets[MAX_STREAMS];
+    VkDeviceSize bufferSize = 0;
+    for (uint32_t s = 0; s < variant->streamCount; ++s) {
+        offsets[s] = bufferSize;
+        bufferSize = alignSize(bufferSize +
+            (VkDeviceSize)particles * variant->streamStrides[s], alignment);
+    }
+    
+    VkBuffer buffers[2];
+    VkDeviceMemory memories[2];
+    for (uint32_t i = 0; i < 2; ++i) {
+        createBuffer(device, ctx->physicalDevice, bufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffers[i], &memories[i],
+            MEMORY_PARTICLES);
+    }
+    
+    // - Parameters: Always take update path (no animation reset)
+    VkBuffer uniformBuffer;
+    VkDeviceMemory uniformMemory;
+    createBuffer(device, ctx->physicalDevice, sizeof(ParameterBufferObject),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, &uniformMemory,
+        MEMORY_UNIFORMS);
+    
+    ParameterBufferObject pbo = {0};
+    pbo.deltaTime = 1.0f / 60.0f;
+    pbo.elapsedTime = 1.0f;
+    pbo.animationResetTime = (float)ANIMATION_RESET_TIME;
+    pbo.randomSeed = 1;
+    pbo.particleCount = particles;
+    
+    void *mapped;
+    vkMapMemory(device, uniformMemory, 0, sizeof(pbo), 0, &mapped);
+        memcpy(mapped, &pbo, sizeof(pbo));
+    vkUnmapMemory(device, uniformMemory);
+    
+    // - Descriptors: binding 0 parameters, then input and output streams,
+    //   neighbor grid and particle order
+    const uint32_t bindingCount = 1 + 2 * variant->streamCount + variant->gridBindings;
+    VkDescriptorSetLayoutBinding bindings[1 + 2 * MAX_STREAMS + MAX_GRID_BINDINGS] = {0};
+    for (uint32_t b = 0; b < bindingCount; ++b) {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = b == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindingCount;
+    layoutInfo.pBindings = bindings;
+    
+    VkDescriptorSetLayout setLayout;
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(device, &layoutInfo, NULL,
+        &setLayout), "Failed to create descriptor set layout\n");
+    
+    const VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          2 * variant->streamCount + variant->gridBindings }
+    };
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    
+    VkDescriptorPool descriptorPool;
+    CHK_VK_ERR(vkCreateDescriptorPool(device, &poolInfo, NULL,
+        &descriptorPool), "Failed to create descriptor pool\n");
+    
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+    
+    VkDescriptorSet set;
+    CHK_VK_ERR(vkAllocateDescriptorSets(device, &allocInfo, &set),
+        "Failed to allocate descriptor set\n");
+    
+    VkDescriptorBufferInfo bufferInfos[1 + 2 * MAX_STREAMS + MAX_GRID_BINDINGS];
+    VkWriteDescriptorSet writes[1 + 2 * MAX_STREAMS + MAX_GRID_BINDINGS] = {0};
+    bufferInfos[0] = (VkDescriptorBufferInfo) {
+        uniformBuffer, 0, sizeof(ParameterBufferObject)
+    };
+    for (uint32_t s = 0; s < variant->streamCount; ++s) {
+        const VkDeviceSize range = (VkDeviceSize)particles * variant->streamStrides[s];
+        bufferInfos[1 + s] = (VkDescriptorBufferInfo) {
+            buffers[0], offsets[s], range
+        };
+        bufferInfos[1 + variant->streamCount + s] = (VkDescriptorBufferInfo) {
+            buffers[1], offsets[s], range
+        };
+    }
+    // Note: Parameters disable interactions, reordering and sparks, so these
+    //       buffers are never accessed
+    for (uint32_t g = 0; g < variant->gridBindings; ++g) {
+        bufferInfos[1 + 2 * variant->streamCount + g] = (VkDescriptorBufferInfo) {
+            buffers[0], 0, 16
+        };
+    }
+    for (uint32_t b = 0; b < bindingCount; ++b) {
+        writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[b].dstSet = set;
+        writes[b].dstBinding = b;
+        writes[b].descriptorCount = 1;
+        writes[b].descriptorType = bindings[b].descriptorType;
+        writes[b].pBufferInfo = &bufferInfos[b];
+    }
+    vkUpdateDescriptorSets(device, bindingCount, writes, 0, NULL);
+    
+    // - Pipeline with workgroup size as specialization constant 0
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    
+    VkPipelineLayout pipelineLayout;
+    CHK_VK_ERR(vkCreatePipelineLayout(device, &pipelineLayoutInfo, NULL,
+        &pipelineLayout), "Failed to create pipeline layout\n");
+    
+    uint32_t codeSize = 0;
+    char *code = readBinFile(variant->spirvPath, &codeSize);
+    VkShaderModule shaderModule = createShaderModule(device, code, codeSize);
+    free(code);
+    
+    const VkSpecializationMapEntry specEntry = { 0, 0, sizeof(uint32_t) };
+    VkSpecializationInfo specInfo = {0};
+    specInfo.mapEntryCount = 1;
+    specInfo.pMapEntries = &specEntry;
+    specInfo.dataSize = sizeof(uint32_t);
+    specInfo.pData = &workgroupSize;
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specInfo;
+    
+    VkPipeline pipeline;
+    CHK_VK_ERR(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &pipeline), "Failed to create compute pipeline\n");
+    vkDestroyShaderModule(device, shaderModule, NULL);
+    
+    // - Record all dispatches into a single command buffer
+    VkCommandBufferAllocateInfo cbInfo = {0};
+    cbInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cbInfo.commandPool = ctx->commandPool;
+    cbInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbInfo.commandBufferCount = 1;
+    
+    VkCommandBuffer commandBuffer;
+    CHK_VK_ERR(vkAllocateCommandBuffers(device, &cbInfo, &commandBuffer),
+        "Failed to allocate command buffer\n");
+    
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+        "Failed to begin recording command buffer\n");
+    
+    vkCmdResetQueryPool(commandBuffer, ctx->queryPool, 0, 2 * ctx->iterations);
+    // Note: Kernel contains no data dependent branches on the update path,
+    //       so zero-initialized particles cost the same as random ones
+    vkCmdFillBuffer(commandBuffer, buffers[0], 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, buffers[1], 0, VK_WHOLE_SIZE, 0);
+    
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelineLayout, 0, 1, &set, 0, NULL);
+    
+    // Successive dispatches write the same output -> serialize them, so each
+    // timestamp pair brackets exactly one dispatch
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    const uint32_t groupCount = (particles + workgroupSize - 1) / workgroupSize;
+    for (uint32_t i = 0; i < WARMUP_ITERATIONS + ctx->iterations; ++i) {
+        const VkBool32 measured = i >= WARMUP_ITERATIONS;
+        const uint32_t query = 2 * (i - WARMUP_ITERATIONS);
+        // Note: Bottom of pipe -> written once all previous work completed
+        if (measured) {
+            vkCmdWriteTimestamp(commandBuffer,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, ctx->queryPool, query);
+        }
+        vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+        if (measured) {
+            vkCmdWriteTimestamp(commandBuffer,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, ctx->queryPool, query + 1);
+        }
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    }
+    
+    CHK_VK_ERR(vkEndCommandBuffer(commandBuffer),
+        "Failed to end recording command buffer\n");
+    
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    CHK_VK_ERR(vkCreateFence(device, &fenceInfo, NULL, &fence),
+        "Failed to create fence\n");
+    
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    CHK_VK_ERR(vkQueueSubmit(ctx->queue, 1, &submitInfo, fence),
+        "Failed to submit command buffer\n");
+    CHK_VK_ERR(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX),
+        "Failed to wait for fence\n");
+    
+    // - Evaluate timestamps
+    uint64_t *timestamps = NULL;
+    double *durations = NULL;
+    CHK_ALLOC(timestamps = malloc(2 * ctx->iterations * sizeof(uint64_t)));
+    CHK_ALLOC(durations = malloc(ctx->iterations * sizeof(double)));
+    CHK_VK_ERR(vkGetQueryPoolResults(device, ctx->queryPool, 0,
+        2 * ctx->iterations, 2 * ctx->iterations * sizeof(uint64_t), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT),
+        "Failed to read timestamps\n");
+    
+    const double period = (double)ctx->properties.limits.timestampPeriod;
+    for (uint32_t i = 0; i < ctx->iterations; ++i) {
+        const uint64_t ticks =
+            (timestamps[2*i + 1] - timestamps[2*i]) & ctx->timestampMask;
+        durations[i] = (double)ticks * period * 1e-3;  // microseconds
+    }
+    // Note: Median is robust against outliers (e.g. clock ramp-up)
+    qsort(durations, ctx->iterations, sizeof(double), compareDouble);
+    result->medianUs = durations[ctx->iterations / 2];
+    result->minUs = durations[0];
+    
+    free(durations);
+    free(timestamps);
+    
+    // - Cleanup
+    vkDestroyFence(device, fence, NULL);
+    vkFreeCommandBuffers(device, ctx->commandPool, 1, &commandBuffer);
+    vkDestroyPipeline(device, pipeline, NULL);
+    vkDestroyPipelineLayout(device, pipelineLayout, NULL);
+    vkDestroyDescriptorPool(device, descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(device, setLayout, NULL);
+    vkDestroyBuffer(device, uniformBuffer, NULL);
+    freeMemory(device, uniformMemory);
+    for (uint32_t i = 0; i < 2; ++i) {
+        vkDestroyBuffer(device, buffers[i], NULL);
+        freeMemory(device, memories[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t deviceIndex = 0;
+    uint32_t minLog2 = MIN_LOG2_PARTICLES;
+    uint32_t maxLog2 = MAX_LOG2_PARTICLES;
+    BenchContext ctx = {0};
+    ctx.iterations = DEFAULT_ITERATIONS;
+    
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--device") == 0) {
+            deviceIndex = parseArgument(argc, argv, &i);
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            ctx.iterations = parseArgument(argc, argv, &i);
+        } else if (strcmp(argv[i], "--min-log2") == 0) {
+            minLog2 = parseArgument(argc, argv, &i);
+        } else if (strcmp(argv[i], "--max-log2") == 0) {
+            maxLog2 = parseArgument(argc, argv, &i);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (ctx.iterations == 0 || minLog2 > maxLog2 || maxLog2 > 31) {
+        fprintf(stderr, "Invalid iteration count or particle count range\n");
+        return EXIT_FAILURE;
+    }
+    
+    initContext(&ctx, deviceIndex);
+    fprintf(stderr, "Benchmarking kernels on %s\n", ctx.properties.deviceName);
+    
+    // Note: Bytes per particle count reads and writes of the particle record
+    printf("revision,device,driver_version,kernel,workgroup_size,particles,"
+        "bytes_per_particle,iterations,median_us,min_us,particles_per_s,"
+        "gb_per_s\n");
+    
+    const uint32_t nVariants = sizeof(VARIANTS) / sizeof(VARIANTS[0]);
+    const uint32_t nSizes = sizeof(WORKGROUP_SIZES) / sizeof(WORKGROUP_SIZES[0]);
+    for (uint32_t v = 0; v < nVariants; ++v) {
+        const KernelVariant *variant = &VARIANTS[v];
+        uint32_t bytesPerParticle = 0;
+        for (uint32_t s = 0; s < variant->streamCount; ++s) {
+            bytesPerParticle += 2 * variant->streamStrides[s];
+        }
+        
+        for (uint32_t w = 0; w < nSizes; ++w) {
+            for (uint32_t k = minLog2; k <= maxLog2; ++k) {
+                const uint32_t particles = 1u << k;
+                const char *reason = checkLimits(&ctx, variant,
+                    WORKGROUP_SIZES[w], particles);
+                if (reason) {
+                    fprintf(stderr, "Skipping %s, workgroup size %u, "
+                        "%u particles: %s\n", variant->name, WORKGROUP_SIZES[w],
+                        particles, reason);
+                    continue;
+                }
+                
+                BenchResult result = {0};
+                runConfiguration(&ctx, variant, WORKGROUP_SIZES[w], particles,
+                    &result);
+                
+                const double seconds = result.medianUs * 1e-6;
+                printf("%s,\"%s\",%u,%s,%u,%u,%u,%u,%.3f,%.3f,%.6e,%.3f\n",
+                    BENCH_REVISION, ctx.properties.deviceName,
+                    ctx.properties.driverVersion, variant->name,
+                    WORKGROUP_SIZES[w], particles, bytesPerParticle,
+                    ctx.iterations, result.medianUs, result.minUs,
+                    (double)particles / seconds,
+                    (double)particles * bytesPerParticle / seconds * 1e-9);
+                fflush(stdout);
+            }
+        }
+    }
+    
+    cleanupContext(&ctx);
+    
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,10 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "options.h"
+
+// Render every combination of swept particle counts, MSAA sample counts and
+// reorder intervals and write frame time statistics (CSV or JSON) to options->benchOutput
+void runBenchmark(const Options *options);
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,67 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "graphics.h"
+
+#define BLOOM_MAX_LEVELS 8      // see MAX_BLOOM_LEVELS in options.c
+#define BLOOM_THRESHOLD  0.6f   // brightness where glow starts (soft knee)
+#define BLOOM_INTENSITY  0.8f   // weight of glow added to frame
+#define BLOOM_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+
+// Compute passes of bloom pyramid, one pipeline each (see bloom.comp)
+typedef enum BloomPass {
+    BLOOM_PASS_PREFILTER,   // soft threshold of first level
+    BLOOM_PASS_DOWNSAMPLE,  // level i from level i - 1
+    BLOOM_PASS_UPSAMPLE,    // level i += level i + 1
+    BLOOM_PASS_COUNT
+} BloomPass;
+
+// Push constants of all passes and composite (see bloom.comp, bloom.frag)
+typedef struct BloomConstants {
+    float texelSize[2];    // texel size of source level in uv coordinates
+    uint32_t sourceLevel;  // level sampled by pass
+    float threshold;
+    float intensity;
+} BloomConstants;
+
+typedef struct Bloom {
+    VkPipeline pipelines[BLOOM_PASS_COUNT];
+    VkPipeline compositePipeline;  // adds first level to swapchain image
+    VkPipelineLayout pipelineLayout;
+    VkRenderPass renderPass;       // loads swapchain image (see composite),
+                                   // none with dynamic rendering
+    VkFramebuffer *frameBuffers;   // one per swapchain image (or none)
+    uint32_t frameBufferCount;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSetLayout descriptorLayout;
+    // Note: Set i writes level i, all sets sample whole pyramid
+    VkDescriptorSet sets[BLOOM_MAX_LEVELS];
+    VkSampler sampler;
+    // Note: Pyramid is shared by frames in flight, since all passes run on
+    //       graphics queue (see bloomRecordFrame())
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;                         // all levels (sampled)
+    VkImageView levelViews[BLOOM_MAX_LEVELS];  // single level (storage)
+    VkExtent2D extents[BLOOM_MAX_LEVELS];
+    uint32_t levelCount;
+} Bloom;
+
+// Create pipelines and pyramid, leaves graphics->bloom NULL if disabled by
+// quality tier or unsupported by swapchain (see --quality)
+void initBloom(Graphics graphics);
+
+// Recreate pyramid and framebuffers after swapchain changed
+// Note: Device must be idle
+void bloomResize(Graphics graphics);
+
+// Record threshold, pyramid and composite onto rendered swapchain image,
+// leaving it in same layout as render pass would have
+// Note: Image is in transfer source layout on entry (see buildFrameGraph())
+void bloomRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex);
+
+// Note: Device must be idle
+void cleanupBloom(Graphics graphics);
+
+#endif /* BLOOM_H */
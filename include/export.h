@@ -0,0 +1,66 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "graphics.h"
+
+#include <pthread.h>
+
+typedef enum ExportSlotState {
+    EXPORT_SLOT_FREE,     // available for next capture
+    EXPORT_SLOT_PENDING,  // copy recorded/submitted, fence not yet observed
+    EXPORT_SLOT_QUEUED,   // copy completed, waiting for writer thread
+    EXPORT_SLOT_WRITING   // currently streamed out by writer thread
+} ExportSlotState;
+
+// Host-visible readback buffer receiving one resolved frame
+typedef struct ExportSlot {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    void *mapped;           // persistently mapped readback memory
+    VkFence fence;          // fence of submission containing the copy
+    uint64_t frame;         // frame number of captured image
+    ExportSlotState state;  // guarded by Exporter.mutex
+} ExportSlot;
+
+typedef struct Exporter {
+    FILE *stream;           // output file or pipe
+    ExportFormat format;
+    VkExtent2D extent;      // frame dimensions (fixed during export)
+    VkBool32 swizzle;       // captured images are BGRA instead of RGBA
+    VkDeviceSize frameSize; // bytes per captured RGBA8 frame
+    ExportSlot *slots;      // ring of readback buffers
+    uint32_t slotCount;
+    uint32_t *queue;        // FIFO of slot indices ready to be written
+    uint32_t queueHead;
+    uint32_t queueCount;
+    uint8_t *scratch;       // writer thread conversion buffer
+    pthread_t thread;       // writer thread
+    pthread_mutex_t mutex;  // guards slot states, queue and statistics
+    pthread_cond_t cond;    // signalled whenever a slot changes state
+    VkBool32 stop;          // writer thread should exit once queue is empty
+    VkBool32 writeFailed;   // stream broke, remaining frames are dropped
+    // Statistics
+    uint64_t written;       // frames streamed out successfully
+    uint64_t dropped;       // frames not captured (ring full or stream broken)
+    uint64_t late;          // frames for which rendering waited on the writer
+} Exporter;
+
+// Create readback ring and start writer thread (takes ownership of stream)
+void initExporter(Graphics graphics, FILE *stream);
+
+// Hand completed copies to writer thread without blocking
+// Note: frameFence is known to be signalled (VK_NULL_HANDLE if unknown) and
+//       must not have been reset yet
+void exportPollFrames(Graphics graphics, VkFence frameFence);
+
+// Record copy of resolved image into next free readback buffer, return
+// image from transfer to presentable layout
+// Note: Image is in transfer layout on entry (see buildFrameGraph())
+void exportRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex);
+
+// Flush outstanding frames, stop writer thread and report statistics
+// Note: Device must be idle
+void cleanupExporter(Graphics graphics);
+
+#endif /* EXPORT_H */
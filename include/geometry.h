@@ -6,15 +6,15 @@
 
 #include <stdalign.h>  // enforce alignment requirements of shader bindings
 
-typedef struct Vertex {
-    vec2 pos;
-} Vertex;
-
-// MVP matrices
+// MVP matrices and star outline (see shader.vert)
 typedef struct UniformBufferObject {
     alignas(16) mat4 model;
     alignas(16) mat4 view;
     alignas(16) mat4 proj;
+    float starSize;         // distance from center to tip/rim of all shapes
+    float starInnerRadius;  // distance from center to inner corners
+    uint32_t starPoints;    // #tips of star
+    float pixelSize;        // size of pixel at star distance
 } UniformBufferObject;
 
 // Elapsed time since animation begin
@@ -22,15 +22,26 @@ typedef struct ParameterBufferObject {
     float deltaTime;
     float elapsedTime;
     float animationResetTime;
-    uint32_t randomSeed;
+    uint32_t randomSeed;        // seed of random numbers (see rng.h, --seed)
+    uint32_t particleCount;
+    float interactionRadius;    // edge of neighbor grid cells (see grid.glsl)
+    float interactionStrength;  // pair force, 0 -> particles do not interact
+    uint32_t gridCellCount;     // #cell keys of neighbor grid
+    uint32_t reorderParticles;  // update gathers particles in Morton order
+    uint32_t sparksPerBurst;    // sparks appended by bursting star (0 -> off)
+    uint32_t sparkCapacity;     // #slots of spark buffers (see sparks.h)
+    uint32_t initShapeMask;     // reset also draws shapes (initialization only)
+    uint32_t show;              // #animation resets, key of random numbers
 } ParameterBufferObject;
 
-#define N_PARTICLES 2048  // Note: Assumed to be evenly divisible by 256
+#define N_PARTICLES 2048  // Default #particles (see --particles)
 typedef struct Particle {
     vec2 position;
     vec2 velocity;
     alignas(16) vec4 color;  // Note: Alignment is important for shaders
     float orientation;
+    uint32_t shape;          // ShapeKind, kept by compute shader
+    uint32_t id;             // index at launch, kept through --reorder
 } Particle;
 
 // Constants needed for star
@@ -40,16 +51,61 @@ typedef struct Particle {
 #define GEOM_STAR_SIN_72     0.951056516295153572116439333379382143f
 #define GEOM_STAR_COS_72     0.309016994374947424102293417182819059f
 
-#define N_VERTICES_STAR 11
-#define N_INDICES_STAR 30
-typedef struct Star {
-    Vertex vertices[N_VERTICES_STAR];
-    uint16_t indices[N_INDICES_STAR];
-} Star;
-
-// @param cx: x-coordinate of star center
-// @param cy: y-coordinate of star center
-// @param d : distance from star center to tip
-Star geomMakeStar(float cx, float cy, float d);
+#define DEFAULT_STAR_POINTS 5
+#define DEFAULT_STAR_SIZE   0.05f
+#define MIN_STAR_POINTS     3
+#define MAX_STAR_POINTS     64
+
+// #vertices drawn per star: 2 triangles per tip sharing the center
+#define GEOM_STAR_VERTEX_COUNT(points) (6 * (points))
+
+// Ratio of inner to outer radius of star with given #tips, such that
+// adjacent edges are collinear (regular star polygon {points/2})
+float geomStarInnerRatio(uint32_t points);
+
+// Shapes of particles (see shader.vert and shader.frag for same constants)
+typedef enum ShapeKind {
+    SHAPE_STAR,     // N-pointed star, generated in vertex shader
+    SHAPE_POLYGON,  // regular polygon
+    SHAPE_RING,     // annulus
+    SHAPE_COMET,    // disk tapering into tail (convex hull of 2 disks)
+    SHAPE_COUNT
+} ShapeKind;
+
+#define GEOM_POLYGON_SIDES      6
+#define GEOM_RING_INNER_RATIO   0.6f
+#define GEOM_RING_SEGMENTS      32
+#define GEOM_COMET_HEAD_RADIUS  0.4f  // head disk centered at (0, r - 1)
+#define GEOM_COMET_TAIL_RADIUS  0.1f  // tail disk centered at (0, 1 - r)
+#define GEOM_COMET_SEGMENTS     32
+
+#define GEOM_ARENA_MAX_VERTICES 128
+#define GEOM_ARENA_MAX_INDICES  1024
+
+// Range of shape in arena (see VkDrawIndexedIndirectCommand)
+typedef struct ShapeDraw {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+} ShapeDraw;
+
+// Vertices and indices of all shapes packed into one buffer each
+// Note: Shapes have unit size (tip/rim at distance 1 from center)
+typedef struct ShapeArena {
+    vec2 vertices[GEOM_ARENA_MAX_VERTICES];
+    uint32_t vertexCount;
+    uint16_t indices[GEOM_ARENA_MAX_INDICES];
+    uint32_t indexCount;
+    ShapeDraw draws[SHAPE_COUNT];
+} ShapeArena;
+
+// Fill arena with triangle lists of all shapes
+// Note: Star has no vertices, its indices enumerate the vertices of the
+//       largest star (MAX_STAR_POINTS) generated in vertex shader, such that
+//       #tips only changes its index count
+void geomBuildShapes(ShapeArena *arena);
+
+// Returns shape named name (e.g. "comet"), SHAPE_COUNT if unknown
+ShapeKind geomShapeFromName(const char *name);
 
 #endif /* GEOMETRY_H */
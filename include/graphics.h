@@ -12,12 +12,15 @@
 #include <errno.h>
 
 #include "geometry.h"
+#include "options.h"
+#include "timer.h"
 
 #define WINDOW_WIDTH 1400
 #define WINDOW_HEIGHT 1000
 #define MAX_FRAMES_IN_FLIGHT 2
 #define ANIMATION_RESET_TIME 10.0  // 10 seconds
 #define STARTING_POSITION_RADIUS 0.8f
+#define MIN_BUDGET_PARTICLES 1024  // lower bound when fitting memory budget
 
 #ifdef NDEBUG
 #define ENABLE_VALIDATION_LAYERS VK_FALSE
@@ -46,6 +49,14 @@
     }\
 } while(0)
 
+// Geometry of drawn stars, chosen by projected size (see shader.vert)
+typedef enum StarLod {
+    STAR_LOD_MESH,   // triangle fan of star outline
+    STAR_LOD_QUAD,   // single quad, star evaluated as signed distance
+    STAR_LOD_POINT,  // point sprite, star evaluated as signed distance
+    STAR_LOD_COUNT
+} StarLod;
+
 typedef struct QueueFamilyIndices {
     uint32_t graphicsFamily;  // queue family index of graphics queue
     uint32_t presentFamily;   // queue family index of present queue
@@ -66,15 +77,19 @@ typedef struct ImageResource {
 } ImageResource;
 
 typedef struct SwapChainData {
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain;     // VK_NULL_HANDLE in headless mode
     VkImage *images;              // imageCount many image handles
+    VkDeviceMemory *imageMemories;  // owned offscreen image memory (headless)
     VkImageView *imageViews;      // imageCount many image views
-    VkFramebuffer *frameBuffers;  // imageCount many framebuffers
+    VkFramebuffer *frameBuffers;  // imageCount many framebuffers (NULL with
+                                  // dynamic rendering)
     uint32_t imageCount;
     VkFormat format;
     VkExtent2D extent;
-    // Multisampling color buffer resolved to swapchain image
+    // Multisampling color buffer resolved to swapchain image, or persistent
+    // accumulation of frames in trail mode
     ImageResource colorResource;
+    VkBool32 colorCleared;  // accumulation holds defined contents
 } SwapChainData;
 
 typedef struct DescriptorData {
@@ -103,44 +118,79 @@ typedef struct SyncObjects {
 } SyncObjects;
 
 typedef struct GraphicsData {
-    GLFWwindow *window;     // window handle
+    Options options;        // runtime configuration
+    GLFWwindow *window;     // window handle (NULL in headless mode)
     VkInstance instance;    // instance storing application state
     VkPhysicalDevice physicalDevice;      // implementation of Vulkan
+    VkPhysicalDeviceProperties deviceProperties;  // name, limits, ...
+    VkPhysicalDeviceFeatures deviceFeatures;      // enabled optional features
+    VkBool32 calibratedTimestamps;  // VK_EXT_calibrated_timestamps enabled
+    VkBool32 memoryBudget;          // VK_EXT_memory_budget enabled
+    VkBool32 dynamicRendering;      // VK_KHR_dynamic_rendering enabled, no
+                                    // render pass or framebuffer objects
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering;  // loaded if dynamicRendering
+    PFN_vkCmdEndRenderingKHR cmdEndRendering;
     VkDevice device;        // logical device (including state information)
-    VkSurfaceKHR surface;   // surface to render graphics to
+    VkSurfaceKHR surface;   // surface to render graphics to (none if headless)
     VkQueue graphicsQueue;  // graphics queue handle
     VkQueue computeQueue;   // compute queue handle
     VkQueue presentQueue;   // presentation queue handle
-    VkRenderPass renderPass;  // rendering operations
-    VkPipeline graphicsPipeline;
+    VkRenderPass renderPass;  // rendering operations (none with dynamic rendering)
+    VkPipeline graphicsPipelines[STAR_LOD_COUNT];  // one per star geometry
     VkPipeline computePipeline;
+    VkPipeline bucketPipeline;  // sorts particles into per-shape draws
+    VkPipeline trailPipeline;   // fades accumulated frames (trail mode only)
     VkPipelineLayout pipelineLayout;
     VkPipelineLayout computePipelineLayout;
+    VkPipelineLayout bucketPipelineLayout;
     VkCommandPool commandPool;  // pool for allocating command buffers
     VkCommandBuffer commandBuffers[MAX_FRAMES_IN_FLIGHT];
     VkCommandBuffer computeCommandBuffers[MAX_FRAMES_IN_FLIGHT];
     VkSampleCountFlagBits msaaSamples;  // #multisampling sample count
     uint32_t currentFrame;  // index of current frame being drawn
+    uint64_t frameCounter;  // total #frames submitted so far
     VkBool32 framebufferResized;
+    StarLod starLod;        // star geometry drawn in current frame
+    VkBool32 drawTiles;     // tile rasterizer draws current frame
+    VkBool32 reorderParticles;  // update of current frame sorts particles
     QueueFamilyIndices queueFamilies;
     SwapChainSupport swapChainSupport;
     SwapChainData swapChainData;
-    BufferResource vertexData;
-    BufferResource indexData;
     VkDescriptorPool descriptorPool;
     DescriptorData vertexDescriptor;
     DescriptorData computeDescriptor;
+    DescriptorData bucketDescriptor;
     FlightBufferResource mvpUniform;
     FlightBufferResource deltaTimeUniform;
     FlightBufferResource shaderStorage; 
+    BufferResource shapeVertices;  // vertices of shape arena (storage buffer)
+    BufferResource shapeIndices;   // indices of shape arena (index buffer)
+    ShapeDraw shapeDraws[SHAPE_COUNT];      // range of every shape in arena
+    FlightBufferResource drawCommands;      // indirect draw per shape
+    FlightBufferResource shapeInstances;    // particle indices by shape
     SyncObjects sync;
+    struct Exporter *exporter;  // video export (NULL if disabled)
+    struct Profiler *profiler;  // CPU/GPU frame timings
+    struct TileRasterizer *tiles;  // compute rasterizer (see tiles.c)
+    struct NeighborGrid *grid;     // spatial hash of particles (see grid.c)
+    struct Bloom *bloom;   // glow post-process (NULL if disabled)
+    struct Sparks *sparks; // sparks of bursting stars (see sparks.c)
+    struct ParticleStream *stream;  // particle readback (NULL if disabled)
+    struct RenderGraph *renderGraph;  // passes of current frame (see rendergraph.h)
+    double timerStart;     // Timer value in seconds at animation begin
     double lastFrameTime;  // Elapsed time in seconds since last frame
+    uint32_t show;         // #animation resets, key of random numbers (see rng.h)
+    struct Snapshot *snapshot;   // mapped snapshot to restore (NULL once uploaded)
+    VkBool32 snapshotRequested;  // save snapshot before next frame (S key)
     VkDebugUtilsMessengerEXT debugMessenger;
 } GraphicsData;
 
 typedef GraphicsData * Graphics;
 
-Graphics initGraphics();
+Graphics initGraphics(const Options *options);
+// Process window events and draw a single frame
+// Returns VK_FALSE once the window was closed
+VkBool32 renderFrame(Graphics graphics);
 void renderLoop(Graphics graphics);
 void cleanupGraphics(Graphics graphics);
 
@@ -0,0 +1,72 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "graphics.h"
+
+#define GRID_SCAN_BLOCK_SIZE 1024  // cell keys scanned per work group (see grid.comp)
+
+// Bindings of neighbor grid in compute descriptor set, following parameters
+// and particles (see grid.glsl and grid.comp)
+#define GRID_BINDING_CELLS     3  // first/past-the-end slot per cell key
+#define GRID_BINDING_PARTICLES 4  // positions/velocities sorted by cell key
+#define GRID_BINDING_INDICES   5  // particle indices sorted by cell key
+#define GRID_BINDING_COUNTS    6  // #particles per cell key (build only)
+#define GRID_BINDING_BLOCKS    7  // offsets of blocks of keys (build only)
+#define GRID_BINDING_ORDER     8  // permutation applied by update (reorder)
+#define COMPUTE_BINDING_COUNT  11  // followed by sparks (see sparks.h)
+
+// Compute passes of grid build, one pipeline each (see grid.comp)
+typedef enum GridPass {
+    GRID_PASS_BIN,          // count particles per cell key
+    GRID_PASS_SCAN_BLOCKS,  // prefix sum of counts within blocks of keys
+    GRID_PASS_SCAN_SUMS,    // prefix sum of block totals
+    GRID_PASS_SPREAD,       // add block offsets to cell ranges
+    GRID_PASS_SCATTER,      // copy particles into slots of their cells
+    GRID_PASS_COUNT
+} GridPass;
+
+// Sort keys of grid build, one set of pipelines each (see grid.comp)
+typedef enum GridKey {
+    GRID_KEY_HASH,    // hashed cell of neighbor grid
+    GRID_KEY_MORTON,  // Morton code of position (see --reorder)
+    GRID_KEY_COUNT
+} GridKey;
+
+// Uniform grid of cells with edge interactionRadius, hashed into cellCount
+// keys and rebuilt from particles of previous step before every update
+// Note: Periodic reordering sorts by Morton code with the same passes and
+//       tables, before the grid is built
+typedef struct NeighborGrid {
+    VkPipeline pipelines[GRID_KEY_COUNT][GRID_PASS_COUNT];
+    // Note: Buffers are shared by frames in flight, since every build is
+    //       consumed by the update dispatch right after it (same queue)
+    BufferResource cellRanges;
+    BufferResource particles;
+    BufferResource indices;
+    BufferResource counts;
+    BufferResource blockSums;
+    BufferResource order;
+    uint32_t cellCount;        // #keys (power of 2, multiple of block size)
+    VkBool32 interactions;     // particles interact (see --interaction)
+    uint32_t reorderInterval;  // #frames between Morton sorts (0 -> off)
+    VkBool32 reorderPaused;    // toggled by M key
+} NeighborGrid;
+
+// Create pipelines and tables (minimal if disabled), bind them to compute
+// descriptor sets
+void initNeighborGrid(Graphics graphics);
+
+// Returns whether update of current frame permutes particles into Morton
+// order (see --reorder)
+VkBool32 gridSelectReorder(Graphics graphics);
+
+// Record sort of input particles of current compute descriptor set by key
+// Note: Render graph makes tables visible to the update dispatch (see
+//       buildFrameGraph())
+void gridRecordBuild(Graphics graphics, VkCommandBuffer commandBuffer,
+    GridKey key);
+
+// Note: Device must be idle
+void cleanupNeighborGrid(Graphics graphics);
+
+#endif /* GRID_H */
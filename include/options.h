@@ -0,0 +1,139 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Container formats of exported video stream
+typedef enum ExportFormat {
+    EXPORT_FORMAT_RAW,  // raw RGBA8 frames back to back
+    EXPORT_FORMAT_Y4M   // YUV4MPEG2 (4:4:4), understood by ffmpeg/mpv/x264
+} ExportFormat;
+
+// Output formats of benchmark results
+typedef enum BenchFormat {
+    BENCH_FORMAT_CSV,   // header + one row per configuration
+    BENCH_FORMAT_JSON   // single object with one entry per configuration
+} BenchFormat;
+
+// Geometry used for drawing stars
+typedef enum RenderMode {
+    RENDER_MODE_AUTO,  // by projected size: mesh, SDF quad or point sprite
+    RENDER_MODE_MESH,  // always triangle mesh
+    RENDER_MODE_SDF    // always signed distance (quad or point sprite)
+} RenderMode;
+
+// Renderer of particles
+typedef enum Rasterizer {
+    RASTERIZER_AUTO,      // tiles for many small stars, pipeline otherwise
+    RASTERIZER_PIPELINE,  // graphics pipeline (see RenderMode)
+    RASTERIZER_TILES      // compute shaders binning stars into screen tiles
+} Rasterizer;
+
+// Quality tier of optional effects
+typedef enum Quality {
+    QUALITY_AUTO,  // low on CPU drivers (e.g. lavapipe), high otherwise
+    QUALITY_LOW,   // skip post-processing (bloom)
+    QUALITY_HIGH   // bloom
+} Quality;
+
+// Performance profile, table of defaults per class of device (see profile.c)
+typedef enum ProfileKind {
+    PROFILE_AUTO,      // from device type and limits
+    PROFILE_HIGH,      // discrete GPUs
+    PROFILE_BALANCED,  // integrated/virtual GPUs, small device-local heaps
+    PROFILE_CPU,       // CPU drivers (e.g. lavapipe)
+    PROFILE_COUNT
+} ProfileKind;
+
+// Options given on command line, kept when profile is applied
+typedef enum ProfileOverride {
+    PROFILE_OVERRIDE_MSAA        = 1u << 0,
+    PROFILE_OVERRIDE_RENDER_MODE = 1u << 1,
+    PROFILE_OVERRIDE_QUALITY     = 1u << 2,
+    PROFILE_OVERRIDE_BLOOM_SCALE = 1u << 3,
+    PROFILE_OVERRIDE_WORKGROUP   = 1u << 4
+} ProfileOverride;
+
+// Maximum number of values of a swept parameter (e.g. --particles a,b,c)
+#define MAX_SWEEP_VALUES 16
+
+// Runtime configuration (see parseOptions() for command line flags)
+typedef struct Options {
+    VkBool32 headless;     // render offscreen without window or display server
+    uint32_t width;        // window or offscreen image width in pixels
+    uint32_t height;       // window or offscreen image height in pixels
+    const char *device;    // index, UUID or part of name of physical device
+                           // (NULL -> highest scored suitable device)
+    VkBool32 deviceProbe;  // time particle kernel on every candidate device
+    uint64_t frameCount;   // #frames to render before exiting (0 -> unlimited)
+    double fixedTimeStep;  // simulated seconds per frame (0 -> wall clock)
+    uint32_t particleCount;  // #simulated particles
+    uint32_t msaaSamples;    // max. MSAA sample count (0 -> highest supported)
+    ProfileKind profile;     // resolved once device is selected
+    uint32_t profileOverrides;  // ProfileOverride bits
+    uint32_t workgroupSize;  // invocations per work group of particle update
+    uint32_t seed;           // seed of random engine
+    uint32_t starPoints;     // #tips of drawn stars
+    float starSize;          // distance from star center to tip
+    uint32_t shapeMask;      // bit per drawn ShapeKind (see --shapes)
+    RenderMode renderMode;
+    float lodMeshSize;       // min. star diameter in pixels drawn as mesh
+    float lodPointSize;      // max. star diameter in pixels drawn as point
+    Rasterizer rasterizer;
+    uint32_t tileThreshold;  // min. #particles drawn by tile rasterizer (auto)
+    VkBool32 renderPasses;   // keep render pass objects (no dynamic rendering)
+    float interactionStrength;  // pair force of particles (0 -> off)
+    float interactionRadius;    // range of pair force
+    uint32_t reorderInterval;   // #frames between Morton sorts (0 -> off)
+    VkBool32 inPlace;           // single particle buffer updated in place
+    Quality quality;
+    uint32_t bloomLevels;    // #levels of bloom pyramid
+    uint32_t bloomScale;     // resolution divisor of first bloom level
+    float trailDecay;        // fraction of frame kept per frame (0 -> off)
+    uint32_t sparksPerBurst; // sparks emitted by a bursting star (0 -> off)
+    uint32_t sparkCapacity;  // max. #live sparks (0 -> one burst per star)
+    double statsInterval;    // seconds between logged frame stats (0 -> off)
+    const char *tracePath;   // Chrome trace-event output, "-" for stdout
+                             // (NULL -> off)
+    // Video export
+    const char *exportPath;     // output file, "-" for stdout (NULL -> off)
+    ExportFormat exportFormat;
+    uint32_t exportFps;         // frame rate of exported stream
+    uint32_t exportRingSize;    // #host-visible readback buffers
+    VkBool32 exportDropFrames;  // drop frames instead of waiting if ring full
+    // Snapshots (see snapshot.h)
+    const char *snapshotPath;   // saved on exit and on S key (NULL -> off)
+    VkBool32 snapshotQuantize;  // save quantized particles
+    const char *restorePath;    // snapshot resumed at startup (NULL -> off)
+    // Particle stream (see stream.h)
+    const char *streamName;     // shared-memory object (NULL -> off)
+    uint32_t streamInterval;    // #frames between captures
+    uint32_t streamFields;      // bit per StreamField
+    // Benchmark mode
+    VkBool32 benchmark;
+    uint64_t benchFrames;       // #measured frames per configuration
+    double benchSeconds;        // measured duration per configuration
+    uint32_t benchWarmup;       // #frames rendered before measuring
+    BenchFormat benchFormat;
+    const char *benchOutput;    // results file, "-" for stdout
+    uint32_t particleSweep[MAX_SWEEP_VALUES];  // particle counts to benchmark
+    uint32_t particleSweepCount;
+    uint32_t msaaSweep[MAX_SWEEP_VALUES];      // MSAA sample counts to benchmark
+    uint32_t msaaSweepCount;
+    uint32_t reorderSweep[MAX_SWEEP_VALUES];   // reorder intervals to benchmark
+    uint32_t reorderSweepCount;
+    ProfileKind profileSweep[MAX_SWEEP_VALUES];  // profiles to benchmark
+    uint32_t profileSweepCount;
+} Options;
+
+// Fill options with defaults, then override them with command line flags
+void parseOptions(int argc, char **argv, Options *options);
+
+// Open output file named on command line
+// Note: "-" keeps stdout for output and redirects printf() to stderr
+FILE *openOutputFile(const char *path);
+
+#endif /* OPTIONS_H */
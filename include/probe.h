@@ -0,0 +1,16 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "graphics.h"
+
+#define PROBE_PARTICLES (1u << 16)  // #particles updated per step
+#define PROBE_STEPS 16              // dispatches of timed submission
+
+// Time update dispatches of particle kernel (shaders/bin/comp.spv) with
+// work groups of given size on temporary device with single queue of family
+// Returns particle updates per second
+// Note: Takes well below a second on CPU drivers (e.g. lavapipe)
+double probeDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamily,
+    uint32_t workgroupSize);
+
+#endif /* PROBE_H */
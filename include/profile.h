@@ -0,0 +1,33 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "graphics.h"
+
+// Device-local memory below which GPUs get the balanced profile
+#define PROFILE_SMALL_HEAP_SIZE (2ull << 30)
+
+// Defaults tuned for a class of device (see ProfileKind)
+typedef struct PerformanceProfile {
+    const char *name;
+    uint32_t msaaSamples;    // max. MSAA samples (0 -> highest supported)
+    RenderMode renderMode;
+    Quality quality;         // whether bloom is rendered
+    uint32_t bloomScale;     // resolution divisor of bloom pyramid
+    uint32_t workgroupSize;  // invocations per work group of particle update
+} PerformanceProfile;
+
+const PerformanceProfile *profileGet(ProfileKind kind);
+
+// Returns PROFILE_COUNT for unknown name
+ProfileKind profileFromName(const char *name);
+
+// Work group size of particle update that profileApply() would choose for
+// device (e.g. to probe it before selecting a device)
+uint32_t profileWorkgroupSize(const Options *options, VkPhysicalDevice physicalDevice);
+
+// Resolve auto profile from type and limits of selected physical device,
+// then replace options not given on command line by values of profile
+// Note: Must precede setMsaaSamples() and pipeline creation
+void profileApply(Graphics graphics);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,137 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "graphics.h"
+#include "trace.h"
+
+// CPU side phases of a frame (see draw())
+typedef enum CpuPhase {
+    CPU_PHASE_FENCE_WAIT,  // waiting on compute/inFlight fences
+    CPU_PHASE_ACQUIRE,     // acquiring next swapchain image
+    CPU_PHASE_RECORD,      // updating uniforms and recording command buffers
+    CPU_PHASE_SUBMIT,      // submitting command buffers
+    CPU_PHASE_PRESENT,     // queueing presentation
+    CPU_PHASE_COUNT
+} CpuPhase;
+
+// GPU passes of a frame, bracketed by timestamp queries
+typedef enum GpuPass {
+    GPU_PASS_COMPUTE,  // particle update (shader.comp)
+    GPU_PASS_RENDER,   // render pass drawing star instances
+    GPU_PASS_GRID,     // neighbor grid build (grid.comp), if interacting
+    GPU_PASS_BLOOM,    // bloom pyramid and composite (bloom.c), if enabled
+    GPU_PASS_COUNT
+} GpuPass;
+
+// Pipeline statistics counted during render pass
+// Note: Same order as corresponding VkQueryPipelineStatisticFlagBits
+typedef enum PipelineStat {
+    PIPELINE_STAT_VERTEX_INVOCATIONS,     // vertex shader invocations
+    PIPELINE_STAT_PRIMITIVE_INVOCATIONS,  // primitives processed by clipping
+    PIPELINE_STAT_FRAGMENT_INVOCATIONS,   // fragment shader invocations
+    PIPELINE_STAT_COUNT
+} PipelineStat;
+
+// Counters written by GPU work and read back with a lag (see sparksCollect())
+typedef enum GpuCounter {
+    GPU_COUNTER_SPARKS_LIVE,     // sparks alive after update
+    GPU_COUNTER_SPARKS_EMITTED,  // sparks appended by bursting stars
+    GPU_COUNTER_SPARKS_DROPPED,  // sparks lost to full spark buffer
+    GPU_COUNTER_COUNT
+} GpuCounter;
+
+typedef struct FrameTimings {
+    double frameMs;                   // CPU time spent in draw()
+    double cpuMs[CPU_PHASE_COUNT];    // CPU time per phase
+    // Note: GPU results are collected once a frame slot is reused and thus
+    //       lag MAX_FRAMES_IN_FLIGHT frames behind CPU times
+    double gpuMs[GPU_PASS_COUNT];     // GPU time per pass
+    VkBool32 gpuValid[GPU_PASS_COUNT];  // gpuMs was collected this frame
+    uint64_t pipelineStats[PIPELINE_STAT_COUNT];
+    VkBool32 pipelineStatsValid;      // pipelineStats was collected this frame
+    uint64_t counters[GPU_COUNTER_COUNT];
+    VkBool32 countersValid;           // counters were collected this frame
+} FrameTimings;
+
+// Means per frame over all frames since last reset
+typedef struct ProfilerStats {
+    uint64_t frames;                  // #frames accumulated
+    double seconds;                   // wall time since last reset
+    double frameMs;
+    double cpuMs[CPU_PHASE_COUNT];
+    double gpuMs[GPU_PASS_COUNT];
+    VkBool32 gpuValid[GPU_PASS_COUNT];  // at least one GPU time collected
+    double pipelineStats[PIPELINE_STAT_COUNT];
+    VkBool32 pipelineStatsValid;
+    double counters[GPU_COUNTER_COUNT];
+    VkBool32 countersValid;
+} ProfilerStats;
+
+typedef struct Profiler {
+    VkQueryPool timestampPool;   // VK_NULL_HANDLE if timestamps unsupported
+    VkQueryPool statisticsPool;  // VK_NULL_HANDLE if statistics unsupported
+    double timestampPeriod;      // nanoseconds per timestamp tick
+    uint64_t timestampMask;      // valid bits of timestamp values
+    // Mapping of GPU timestamps to CPU clock for tracing
+    // (NULL if VK_EXT_calibrated_timestamps is unavailable)
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps;
+    uint64_t calibrationTicks;   // GPU timestamp at calibration
+    uint64_t calibrationNs;      // timerNanoseconds() at calibration
+    // Queries were written by frame slot, but not yet read back
+    VkBool32 pending[MAX_FRAMES_IN_FLIGHT][GPU_PASS_COUNT];
+    uint64_t frameStart;         // timer value at begin of current frame
+    uint64_t phaseStart;         // timer value at begin of current phase
+    const char *phaseName;       // trace event name of current phase
+    FrameTimings timings;        // timings of most recent frame
+    // Accumulated since last reset
+    ProfilerStats sums;          // sums instead of means
+    uint64_t gpuSamples[GPU_PASS_COUNT];
+    uint64_t statisticsSamples;
+    uint64_t counterSamples;
+    uint64_t resetTime;          // timer value at last reset
+} Profiler;
+
+// Name of phase/pass/statistic/counter as used in benchmark and log output
+const char *cpuPhaseName(CpuPhase phase);
+const char *gpuPassName(GpuPass pass);
+const char *pipelineStatName(PipelineStat stat);
+const char *gpuCounterName(GpuCounter counter);
+
+// Create query pools (as far as supported by device and graphics queue)
+void initProfiler(Graphics graphics);
+
+// Clear timings of previous frame and start frame timer
+void profilerBeginFrame(Graphics graphics);
+// Stop frame timer, accumulate timings and log them every
+// options.statsInterval seconds
+void profilerEndFrame(Graphics graphics);
+
+// Attribute time between begin and end to given CPU phase, traced as name
+// Note: Phases do not nest
+void profilerBeginPhase(Graphics graphics, const char *name);
+void profilerEndPhase(Graphics graphics, CpuPhase phase);
+
+// Record queries bracketing a GPU pass into commandBuffer of current frame
+// Note: Must be recorded outside of render pass instances
+void profilerBeginPass(Graphics graphics, VkCommandBuffer commandBuffer,
+    GpuPass pass);
+void profilerEndPass(Graphics graphics, VkCommandBuffer commandBuffer,
+    GpuPass pass);
+
+// Read back queries last recorded for pass by current frame slot
+// Note: Fence of the corresponding submission must be signalled, so this never
+//       blocks
+void profilerCollect(Graphics graphics, GpuPass pass);
+
+// Report counters read back for current frame
+void profilerSetCounters(Graphics graphics,
+    const uint32_t counters[GPU_COUNTER_COUNT]);
+
+// Means since last reset
+void profilerGetStats(Graphics graphics, ProfilerStats *stats);
+void profilerResetStats(Graphics graphics);
+
+// Destroy query pools
+void cleanupProfiler(Graphics graphics);
+
+#endif /* PROFILER_H */
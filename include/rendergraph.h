@@ -0,0 +1,131 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "graphics.h"
+#include "profiler.h"
+
+// Render graph: every frame, passes are declared in submission order along
+// with the resources they read and write (see buildFrameGraph()). Compiling
+// the graph culls passes whose writes nobody reads, and derives the barriers
+// between passes of a queue as well as the stages at which the graphics
+// submission waits on compute results and image acquisition
+// Accesses of every resource instance are kept across frames, so the first
+// pass using it in a later frame waits on them (compute and graphics share
+// one queue, and compute is submitted before the frame fence is waited on)
+// Note: Barriers inside a pass are still recorded by the pass itself
+
+#define RENDER_GRAPH_MAX_PASSES 16
+#define RENDER_GRAPH_MAX_ACCESSES 8  // per pass
+
+// Queue a pass is recorded to, compute is submitted first
+typedef enum RenderQueue {
+    RENDER_QUEUE_COMPUTE,
+    RENDER_QUEUE_GRAPHICS,
+    RENDER_QUEUE_COUNT
+} RenderQueue;
+
+// Resources passed between passes of a frame
+typedef enum RenderResource {
+    RENDER_RESOURCE_GRID,       // neighbor grid tables and Morton permutation
+    RENDER_RESOURCE_PARTICLES,  // particles written by current step
+    RENDER_RESOURCE_SPARKS,     // sparks and their indirect draw
+    RENDER_RESOURCE_DRAWS,      // per-shape indirect draws and instances
+    RENDER_RESOURCE_OUTPUT,     // swapchain (or offscreen) image, presented
+    RENDER_RESOURCE_COUNT
+} RenderResource;
+
+typedef void (*RenderPassRecord)(Graphics graphics,
+    VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+typedef struct RenderAccess {
+    RenderResource resource;
+    VkBool32 previous;           // instance of previous frame slot
+    VkPipelineStageFlags stage;  // first stage reading, or last stage writing
+    VkAccessFlags access;
+    VkBool32 write;
+    // Images only: layout expected on entry (undefined -> pass transitions
+    // image itself) and layout left behind
+    VkImageLayout layout;
+    VkImageLayout exitLayout;
+} RenderAccess;
+
+typedef struct RenderGraphPass {
+    const char *name;
+    RenderQueue queue;
+    GpuPass profilerPass;       // timed group (GPU_PASS_COUNT -> not timed)
+    RenderPassRecord record;
+    VkBool32 sideEffects;       // kept although no later pass reads its writes
+    RenderAccess accesses[RENDER_GRAPH_MAX_ACCESSES];
+    uint32_t accessCount;
+    // Derived by renderGraphCompile()
+    VkBool32 culled;
+    VkPipelineStageFlags srcStage;  // barrier recorded ahead of pass
+    VkPipelineStageFlags dstStage;  // (0 -> none)
+    VkAccessFlags srcAccess;        // global memory barrier (buffers)
+    VkAccessFlags dstAccess;
+    VkBool32 outputBarrier;         // barrier of OUTPUT image
+    VkAccessFlags outputSrcAccess;
+    VkAccessFlags outputDstAccess;
+    VkImageLayout outputOldLayout;
+    VkImageLayout outputNewLayout;
+} RenderGraphPass;
+
+// Accesses of a resource instance by frames since it was last waited on
+typedef struct RenderHistory {
+    VkPipelineStageFlags readStages;
+    VkPipelineStageFlags writeStages;
+    VkAccessFlags writeAccess;
+} RenderHistory;
+
+typedef struct RenderGraph {
+    RenderGraphPass passes[RENDER_GRAPH_MAX_PASSES];
+    uint32_t passCount;
+    // One instance of resource per frame slot, or one shared by all frames
+    VkBool32 slotted[RENDER_RESOURCE_COUNT];
+    RenderHistory history[RENDER_RESOURCE_COUNT][MAX_FRAMES_IN_FLIGHT];
+    // Derived by renderGraphCompile()
+    VkPipelineStageFlags computeWaitStages;  // graphics on compute semaphore
+    VkPipelineStageFlags acquireWaitStages;  // graphics on acquired image
+    uint32_t culledCount;
+} RenderGraph;
+
+void initRenderGraph(Graphics graphics);
+
+// Remove passes of previous frame
+void renderGraphReset(RenderGraph *graph);
+
+// Append pass to its queue, recorded in order of addition
+RenderGraphPass *renderGraphAddPass(RenderGraph *graph, const char *name,
+    RenderQueue queue, GpuPass profilerPass, RenderPassRecord record);
+
+// Declare buffer access of pass
+void renderGraphRead(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access);
+void renderGraphWrite(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access);
+// Declare read of instance written in previous frame slot (e.g. particles
+// of previous step), same instance as other accesses if not slotted
+void renderGraphReadPrevious(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access);
+
+// Declare image access of pass with layouts on entry and exit
+void renderGraphReadImage(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access,
+    VkImageLayout layout, VkImageLayout exitLayout);
+void renderGraphWriteImage(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access,
+    VkImageLayout layout, VkImageLayout exitLayout);
+
+// Cull unused passes, derive barriers and semaphore wait stages of frame
+// slot, including barriers against earlier frames using same instances
+// Note: Exits if a compute pass reads results of a graphics pass
+void renderGraphCompile(RenderGraph *graph, uint32_t slot);
+
+// Record passes of queue that were not culled, each preceded by its barrier
+// and enclosed by profiler pass of its group
+void renderGraphRecord(Graphics graphics, RenderQueue queue,
+    VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+void cleanupRenderGraph(Graphics graphics);
+
+#endif /* RENDERGRAPH_H */
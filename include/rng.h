@@ -0,0 +1,132 @@
+#ifndef RNG_H
+#define RNG_H
+
+// Counter-based random numbers (Philox4x32-10), shared by C and GLSL
+// Every block of 4 numbers is a pure function of key (seed, show) and counter
+// (particle, stream, block), so draws are reproducible, independent of
+// invocation order and never overlap between particles or streams
+// Note: Included by shaders (see SHADER_FLAGS in Makefile), glslc defines
+//       VULKAN when compiling GLSL for Vulkan
+
+// Multipliers and Weyl sequence of key schedule (Salmon et al. 2011)
+#define RNG_PHILOX_M0 0xD2511F53u
+#define RNG_PHILOX_M1 0xCD9E8D57u
+#define RNG_PHILOX_W0 0x9E3779B9u
+#define RNG_PHILOX_W1 0xBB67AE85u
+#define RNG_PHILOX_ROUNDS 10
+
+// Particle of draws shared by all particles of a step
+#define RNG_SHARED 0xFFFFFFFFu
+
+// Streams of particle update (see shader.comp)
+#define RNG_STREAM_SHAPE  0u  // shape drawn at initialization
+#define RNG_STREAM_LAUNCH 1u  // origin of show (RNG_SHARED)
+#define RNG_STREAM_STAR   2u  // orientation, color, speed and direction
+#define RNG_STREAM_BURST  3u  // burst threshold, then 3 numbers per spark
+
+#ifdef VULKAN
+
+uvec4 rngPhiloxRound(uvec4 counter, uvec2 key)
+{
+    uint hi0, lo0, hi1, lo1;
+    umulExtended(RNG_PHILOX_M0, counter.x, hi0, lo0);
+    umulExtended(RNG_PHILOX_M1, counter.z, hi1, lo1);
+    return uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+}
+
+// Returns 4 random numbers of given block of a particle's stream
+uvec4 rngBlock(uint seed, uint show, uint particle, uint stream, uint block)
+{
+    uvec4 counter = uvec4(particle, stream, block, 0u);
+    uvec2 key = uvec2(seed, show);
+    for (int i = 0; i < RNG_PHILOX_ROUNDS; ++i) {
+        counter = rngPhiloxRound(counter, key);
+        key += uvec2(RNG_PHILOX_W0, RNG_PHILOX_W1);
+    }
+    return counter;
+}
+
+// Returns random number mapped to interval [0, 1)
+float rngUnit(uint x)
+{
+    return float(x >> 8) * (1.0 / 16777216.0);
+}
+
+#else
+
+#include <stdint.h>
+
+typedef struct RngBlock {
+    uint32_t x, y, z, w;
+} RngBlock;
+
+static inline RngBlock rngPhiloxRound(RngBlock counter, uint32_t key0, uint32_t key1)
+{
+    const uint64_t product0 = (uint64_t)RNG_PHILOX_M0 * counter.x;
+    const uint64_t product1 = (uint64_t)RNG_PHILOX_M1 * counter.z;
+    RngBlock result;
+    result.x = (uint32_t)(product1 >> 32) ^ counter.y ^ key0;
+    result.y = (uint32_t)product1;
+    result.z = (uint32_t)(product0 >> 32) ^ counter.w ^ key1;
+    result.w = (uint32_t)product0;
+    return result;
+}
+
+// Returns Philox4x32-10 of a full counter (known answers of Random123 apply)
+static inline RngBlock rngPhilox(RngBlock counter, uint32_t key0, uint32_t key1)
+{
+    for (int i = 0; i < RNG_PHILOX_ROUNDS; ++i) {
+        counter = rngPhiloxRound(counter, key0, key1);
+        key0 += RNG_PHILOX_W0;
+        key1 += RNG_PHILOX_W1;
+    }
+    return counter;
+}
+
+// Returns 4 random numbers of given block of a particle's stream
+// Note: Same numbers as rngBlock() in shaders
+static inline RngBlock rngBlock(uint32_t seed, uint32_t show, uint32_t particle,
+    uint32_t stream, uint32_t block)
+{
+    const RngBlock counter = {particle, stream, block, 0u};
+    return rngPhilox(counter, seed, show);
+}
+
+// Fill blocks of consecutive particles starting at firstParticle, i.e.
+// out[4*i..4*i+3] = rngBlock(seed, show, firstParticle + i, stream, block)
+// Note: Rounds run over separate lanes in a loop without dependencies
+//       between particles, which compilers vectorize at -O3 (see
+//       bench/rngcheck.c)
+static inline void rngFillBlocks(uint32_t seed, uint32_t show,
+    uint32_t firstParticle, uint32_t count, uint32_t stream, uint32_t block,
+    uint32_t *out)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t c0 = firstParticle + i, c1 = stream, c2 = block, c3 = 0u;
+        uint32_t key0 = seed, key1 = show;
+        for (int r = 0; r < RNG_PHILOX_ROUNDS; ++r) {
+            const uint64_t product0 = (uint64_t)RNG_PHILOX_M0 * c0;
+            const uint64_t product1 = (uint64_t)RNG_PHILOX_M1 * c2;
+            c0 = (uint32_t)(product1 >> 32) ^ c1 ^ key0;
+            c1 = (uint32_t)product1;
+            c2 = (uint32_t)(product0 >> 32) ^ c3 ^ key1;
+            c3 = (uint32_t)product0;
+            key0 += RNG_PHILOX_W0;
+            key1 += RNG_PHILOX_W1;
+        }
+        out[4 * i + 0] = c0;
+        out[4 * i + 1] = c1;
+        out[4 * i + 2] = c2;
+        out[4 * i + 3] = c3;
+    }
+}
+
+// Returns random number mapped to interval [0, 1)
+static inline float rngUnit(uint32_t x)
+{
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif /* VULKAN */
+
+#endif /* RNG_H */
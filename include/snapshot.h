@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "graphics.h"
+
+// Snapshot file: header, zero padding up to dataOffset, particle records
+// Note: Native byte order and layouts, so the mapped data is uploaded as is
+#define SNAPSHOT_MAGIC "FWSNAP\0"         // 8 bytes including terminator
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_DATA_ALIGNMENT 4096      // page size, keeps records mappable
+
+typedef enum SnapshotEncoding {
+    SNAPSHOT_ENCODING_RAW,        // Particle as in storage buffer (geometry.h)
+    SNAPSHOT_ENCODING_QUANTIZED,  // QuantizedParticle (see snapshot.comp)
+    SNAPSHOT_ENCODING_COUNT
+} SnapshotEncoding;
+
+// Particle packed to a third of its size
+typedef struct QuantizedParticle {
+    uint32_t position;          // 2x half float
+    uint32_t velocity;          // 2x half float
+    uint32_t color;             // RGBA8 unorm
+    uint32_t orientationShape;  // half float orientation, shape in high bits
+} QuantizedParticle;
+
+typedef struct SnapshotHeader {
+    char magic[8];              // SNAPSHOT_MAGIC
+    uint32_t version;           // SNAPSHOT_VERSION
+    uint32_t headerSize;        // sizeof(SnapshotHeader)
+    uint32_t encoding;          // SnapshotEncoding
+    uint32_t recordSize;        // bytes per particle record
+    uint64_t particleCount;     // #records
+    uint64_t dataOffset;        // multiple of SNAPSHOT_DATA_ALIGNMENT
+    uint64_t dataSize;          // particleCount * recordSize
+    double elapsedTime;         // seconds into current show
+    double animationResetTime;  // seconds per show when saved
+    uint32_t seed;              // key of random numbers (see rng.h)
+    uint32_t show;              // #animation resets when saved
+} SnapshotHeader;
+
+// Read-only mapping of a snapshot file
+typedef struct Snapshot {
+    const SnapshotHeader *header;  // start of mapping
+    const void *records;           // header + dataOffset
+    size_t mappedSize;             // file size
+} Snapshot;
+
+// Map snapshot file and adopt its particle count and seed in options
+// Note: Exits on files that are truncated or of another version, must be
+//       called before initVulkan() sizes particle buffers
+Snapshot *openSnapshot(const char *path, Options *options);
+
+// Upload particles of mapped snapshot with a single staging copy (decode
+// pass if quantized) in place of initParticles(), resume its show and unmap
+// Note: Surplus particles are dropped if the memory budget lowered the count
+void restoreSnapshot(Graphics graphics);
+
+// Write particles read by next step, timer, seed and show to file
+// Note: Device must be idle
+void saveSnapshot(Graphics graphics, const char *path);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,72 @@
+#ifndef SPARKS_H
+#define SPARKS_H
+
+#include "graphics.h"
+
+#define SPARK_LOCAL_SIZE 256  // invocations per work group (see sparks.comp)
+
+// Bindings of sparks in compute descriptor set, following neighbor grid
+// (see grid.h and shader.comp)
+#define SPARK_BINDING_SPARKS 9   // sparks appended by update of this step
+#define SPARK_BINDING_STATE  10  // append counter of this step
+
+// Compute passes around update dispatch, one pipeline each (see sparks.comp)
+typedef enum SparkPass {
+    SPARK_PASS_UPDATE,    // move sparks of previous step, append survivors
+    SPARK_PASS_FINALIZE,  // clamp count, write indirect arguments
+    SPARK_PASS_COUNT
+} SparkPass;
+
+// Append counter and indirect arguments of one step (see sparks.glsl)
+// Note: Written on GPU only, counters are copied out for stats
+typedef struct SparkState {
+    VkDispatchIndirectCommand dispatch;  // update pass of next step
+    VkDrawIndirectCommand draw;          // one quad per spark
+    uint32_t count;     // #live sparks (#slots requested before finalize)
+    uint32_t emitted;   // #sparks appended by bursting stars
+    uint32_t dropped;   // #sparks exceeding capacity
+} SparkState;
+
+// Sparks of bursting stars, appended to per-frame buffers by the update
+// dispatch and moved by a separate pass in the next step
+// Note: Buffers are ping-ponged like particles, step i reads sparks of frame
+//       slot (i + 1) % MAX_FRAMES_IN_FLIGHT and appends to slot i
+typedef struct Sparks {
+    VkPipeline pipelines[SPARK_PASS_COUNT];
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    DescriptorData descriptor;        // spark passes (see sparks.comp)
+    DescriptorData vertexDescriptor;  // star vertex layout, sparks as particles
+    FlightBufferResource sparks;      // capacity many particles
+    FlightBufferResource states;      // SparkState
+    FlightBufferResource readback;    // host-visible copy of counters
+    VkBool32 pending[MAX_FRAMES_IN_FLIGHT];  // readback written, not yet read
+    uint32_t capacity;  // #slots of spark buffers
+    VkBool32 enabled;   // stars burst into sparks (see --sparks)
+} Sparks;
+
+// Create pipelines and buffers (minimal if disabled), bind them to compute
+// descriptor sets
+void initSparks(Graphics graphics);
+
+// Record reset of current append counter and update of previous sparks,
+// followed by barrier for the update dispatch (see shader.comp)
+void sparksRecordUpdate(Graphics graphics, VkCommandBuffer commandBuffer);
+
+// Record clamping of appended sparks and indirect arguments after update
+// dispatch, and copy of counters for sparksCollect()
+void sparksRecordFinalize(Graphics graphics, VkCommandBuffer commandBuffer);
+
+// Record indirect draw of current sparks into render pass instance
+// Note: Binds star quad pipeline
+void sparksRecordDraw(Graphics graphics, VkCommandBuffer commandBuffer);
+
+// Report counters last copied by current frame slot to profiler
+// Note: Compute fence of the slot must be signalled, counts are never used
+//       to size GPU work
+void sparksCollect(Graphics graphics);
+
+// Note: Device must be idle
+void cleanupSparks(Graphics graphics);
+
+#endif /* SPARKS_H */
@@ -0,0 +1,125 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "graphics.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Particle stream: every n-th step, a compute pass packs selected fields of
+// all particles into a host-visible readback buffer, and a publisher thread
+// copies completed buffers into a shared-memory ring read by other processes
+// Note: Rendering never waits, a capture is dropped if no buffer is free
+
+#define STREAM_MAGIC "FWSTRM\0"    // 8 bytes including terminator
+#define STREAM_VERSION 1
+#define STREAM_SLOT_COUNT 4        // readback buffers and shared-memory slots
+#define STREAM_FIELD_ALIGNMENT 256 // offset alignment of frame data and fields
+
+// Fields selected by --stream-fields, each packed into an array of its own
+typedef enum StreamField {
+    STREAM_FIELD_POSITION,     // 2x float
+    STREAM_FIELD_VELOCITY,     // 2x float
+    STREAM_FIELD_COLOR,        // RGBA8 unorm
+    STREAM_FIELD_ORIENTATION,  // float
+    STREAM_FIELD_SHAPE,        // uint32_t ShapeKind
+    STREAM_FIELD_COUNT
+} StreamField;
+
+// Layout of shared-memory object (see --stream), written by publisher only:
+// StreamRingHeader, then STREAM_SLOT_COUNT slots of slotSize bytes, each a
+// StreamFrameHeader followed by field arrays
+// Note: Readers copy a slot, then check its sequence is unchanged and even
+//       (seqlock), capture n is published to slot n % STREAM_SLOT_COUNT
+typedef struct StreamRingHeader {
+    char magic[8];            // STREAM_MAGIC
+    uint32_t version;         // STREAM_VERSION
+    uint32_t slotCount;       // STREAM_SLOT_COUNT
+    uint64_t slotOffset;      // bytes from ring start to first slot
+    uint64_t slotSize;        // bytes per slot
+    _Atomic uint64_t latest;  // sequence of newest complete slot (0 -> none)
+} StreamRingHeader;
+
+typedef struct StreamFrameHeader {
+    _Atomic uint64_t sequence;  // 2n once capture n is complete, odd while written
+    uint64_t frame;             // rendered frame of capture
+    double time;                // seconds into show
+    uint32_t show;              // #animation resets
+    uint32_t particleCount;
+    uint32_t fieldMask;         // bit per StreamField
+    uint32_t reserved;
+    uint64_t fieldOffsets[STREAM_FIELD_COUNT];  // bytes from slot start
+                                                // (0 -> not selected)
+} StreamFrameHeader;
+
+typedef enum StreamSlotState {
+    STREAM_SLOT_FREE,        // available for next capture
+    STREAM_SLOT_PENDING,     // pack pass submitted, fence not yet observed
+    STREAM_SLOT_QUEUED,      // packed, waiting for publisher thread
+    STREAM_SLOT_PUBLISHING   // currently copied by publisher thread
+} StreamSlotState;
+
+// Host-visible buffer receiving one capture, laid out like a shared slot
+typedef struct StreamSlot {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    void *mapped;             // persistently mapped, frame header written by host
+    VkFence fence;            // compute fence of submission containing pack pass
+    uint64_t frame;           // frame number of capture
+    StreamSlotState state;    // guarded by ParticleStream.mutex
+} StreamSlot;
+
+typedef struct ParticleStream {
+    VkPipeline pipeline;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorSetLayout descriptorLayout;
+    VkDescriptorPool descriptorPool;
+    // Note: One set per particle buffer and slot
+    VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT][STREAM_SLOT_COUNT];
+    StreamSlot slots[STREAM_SLOT_COUNT];
+    uint32_t fieldMask;       // bit per StreamField
+    uint64_t fieldOffsets[STREAM_FIELD_COUNT];  // see StreamFrameHeader
+    uint64_t slotSize;        // bytes per readback buffer and shared slot
+    uint32_t interval;        // #frames between captures
+    // Shared-memory ring
+    const char *name;         // POSIX shared-memory object name
+    StreamRingHeader *ring;   // mapped object
+    size_t ringSize;
+    uint64_t sequence;        // last published capture
+    // Publisher thread
+    uint32_t queue[STREAM_SLOT_COUNT];  // FIFO of slots ready to publish
+    uint32_t queueHead;
+    uint32_t queueCount;
+    pthread_t thread;
+    pthread_mutex_t mutex;    // guards slot states, queue and statistics
+    pthread_cond_t cond;      // signalled when a slot is queued or stop is set
+    VkBool32 stop;            // publisher exits once queue is empty
+    // Statistics
+    uint64_t published;       // captures copied to shared memory
+    uint64_t dropped;         // captures skipped since no buffer was free
+} ParticleStream;
+
+// Parse comma separated field names into StreamField bits
+// Returns 0 for unknown names
+uint32_t streamParseFields(const char *list);
+
+// Create shared-memory ring, readback buffers and pack pipeline, start
+// publisher thread
+void initStream(Graphics graphics);
+
+// Hand completed captures to publisher thread without blocking
+// Note: computeFence is known to be signalled and must not have been reset
+void streamPoll(Graphics graphics, VkFence computeFence);
+
+// Record pack pass of particles written by current step into free readback
+// buffer (dropped if none is free)
+// Note: Recorded every interval steps by render graph, after barrier for
+//       update dispatch (see buildFrameGraph())
+void streamRecordCapture(Graphics graphics, VkCommandBuffer commandBuffer);
+
+// Publish outstanding captures, stop thread, unlink shared memory and report
+// statistics
+// Note: Device must be idle
+void cleanupStream(Graphics graphics);
+
+#endif /* STREAM_H */
@@ -0,0 +1,67 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include "graphics.h"
+
+#define TILE_SIZE 16  // tile edge in pixels (see tiles.comp)
+#define TILE_ENTRIES_PER_PARTICLE 4  // avg. #tiles overlapped by particle
+
+// Compute passes of tile rasterizer, one pipeline each (see tiles.comp)
+typedef enum TilePass {
+    TILE_PASS_BIN,      // count particles per tile
+    TILE_PASS_SCAN,     // prefix sum of counts
+    TILE_PASS_SCATTER,  // append particle indices to bins
+    TILE_PASS_RASTER,   // shade tiles and pack pixels
+    TILE_PASS_COUNT
+} TilePass;
+
+// Flags of TileConstants.outputFlags
+#define TILE_OUTPUT_BGRA 1u  // swapchain stores blue channel first
+#define TILE_OUTPUT_SRGB 2u  // swapchain expects sRGB encoded colors
+
+// Push constants of all passes (see tiles.comp)
+typedef struct TileConstants {
+    uint32_t width;          // framebuffer extent in pixels
+    uint32_t height;
+    uint32_t tilesX;         // #tiles per row
+    uint32_t tilesY;         // #tiles per column
+    uint32_t particleCount;
+    uint32_t entryCapacity;  // #particle indices fitting into bins
+    uint32_t outputFlags;
+} TileConstants;
+
+typedef struct TileRasterizer {
+    VkPipeline pipelines[TILE_PASS_COUNT];
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    DescriptorData descriptor;
+    // Note: Buffers are shared by frames in flight, since all passes run on
+    //       graphics queue (see tilesRecordFrame())
+    BufferResource counts;   // #entries per tile
+    BufferResource offsets;  // first entry of every tile
+    BufferResource entries;  // particle indices binned by tile
+    BufferResource pixels;   // packed colors copied to swapchain image
+    TileConstants constants;
+    VkBool32 supported;      // swapchain images can be written by copy
+} TileRasterizer;
+
+// Create pipelines and bins (disabled if swapchain format is unsuitable)
+void initTileRasterizer(Graphics graphics);
+
+// Recreate tile buffers after swapchain extent changed
+// Note: Device must be idle
+void tilesResize(Graphics graphics);
+
+// Returns whether tile rasterizer draws current frame (see --rasterizer)
+// Note: Requires star geometry of current frame (see selectStarLod())
+VkBool32 tilesSelect(Graphics graphics);
+
+// Record all passes of tile rasterizer, leaving swapchain image in same
+// layout as render pass would have
+void tilesRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex);
+
+// Note: Device must be idle
+void cleanupTileRasterizer(Graphics graphics);
+
+#endif /* TILES_H */
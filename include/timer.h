@@ -0,0 +1,12 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Monotonic wall clock in nanoseconds (arbitrary but fixed origin)
+uint64_t timerNanoseconds(void);
+
+// Monotonic wall clock in seconds (same origin as timerNanoseconds)
+double timerSeconds(void);
+
+#endif /* TIMER_H */
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "timer.h"
+
+// Events recorded per thread before the oldest ones are overwritten
+#define TRACE_RING_SIZE (1u << 16)
+// Thread id of track holding GPU passes (CPU threads are numbered from 1)
+#define TRACE_GPU_TRACK 0
+
+// Non-zero once traceInit() was called with an output file
+// Note: Disabled tracing costs a single branch per marker
+extern int traceActive;
+
+// Start recording events, written to path ("-" for stdout) on traceShutdown()
+// Note: Does nothing for path == NULL
+void traceInit(const char *path);
+
+// Name track of calling thread in trace viewer
+void traceSetThreadName(const char *name);
+
+// Record event spanning [start, end) (timerNanoseconds() values) on track of
+// calling thread
+// Note: name must outlive traceShutdown() (e.g. string literal)
+void traceRecord(const char *name, uint64_t start, uint64_t end);
+// Same as traceRecord(), but on GPU track (times converted to CPU clock)
+void traceRecordGpu(const char *name, uint64_t start, uint64_t end);
+
+// Write recorded events as Chrome trace-event JSON (opens in Perfetto)
+// Note: All threads that recorded events must have finished recording
+void traceShutdown(void);
+
+typedef struct TraceScope {
+    const char *name;
+    uint64_t start;
+} TraceScope;
+
+static inline TraceScope traceScopeBegin(const char *name)
+{
+    return (TraceScope) { name, traceActive ? timerNanoseconds() : 0 };
+}
+
+static inline void traceScopeEnd(TraceScope *scope)
+{
+    if (traceActive) {
+        traceRecord(scope->name, scope->start, timerNanoseconds());
+    }
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Record event spanning from here to end of enclosing scope
+#define TRACE_SCOPE(name) \
+    TraceScope TRACE_CONCAT(traceScope, __LINE__) \
+    __attribute__((cleanup(traceScopeEnd))) = traceScopeBegin(name)
+
+#endif /* TRACE_H */
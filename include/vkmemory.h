@@ -0,0 +1,51 @@
+#ifndef VKMEMORY_H
+#define VKMEMORY_H
+
+#include <stdio.h>
+#include <vulkan/vulkan.h>
+
+// Share of device-local heaps assumed usable without VK_EXT_memory_budget
+#define MEMORY_FALLBACK_BUDGET_PERCENT 80
+
+// What device memory allocated by createBuffer()/createImage() is used for
+typedef enum MemoryCategory {
+    MEMORY_PARTICLES,    // buffers scaling with #particles (state, grid, sparks)
+    MEMORY_STAGING,      // host-visible upload and readback buffers
+    MEMORY_ATTACHMENTS,  // images and buffers scaling with framebuffer extent
+    MEMORY_UNIFORMS,     // per-frame uniform buffers
+    MEMORY_OTHER,        // shapes, indirect arguments, counters
+    MEMORY_CATEGORY_COUNT
+} MemoryCategory;
+
+typedef struct MemoryStats {
+    VkDeviceSize allocated[MEMORY_CATEGORY_COUNT];  // bytes allocated by app
+    VkDeviceSize usage;   // bytes of device-local heaps in use
+    VkDeviceSize budget;  // bytes of device-local heaps available to process
+    VkBool32 queried;     // usage and budget reported by VK_EXT_memory_budget
+} MemoryStats;
+
+const char *memoryCategoryName(MemoryCategory category);
+
+// Start accounting of physical device, budget is queried if device was
+// created with VK_EXT_memory_budget enabled
+void memoryInit(VkPhysicalDevice physicalDevice, VkBool32 budgetEnabled);
+
+// Record allocation of memory type, done by createBuffer() and createImage()
+void memoryTrack(VkDeviceMemory memory, VkDeviceSize size,
+    uint32_t memoryTypeIndex, MemoryCategory category);
+
+// Free memory and drop it from accounting (VK_NULL_HANDLE is ignored)
+void freeMemory(VkDevice device, VkDeviceMemory memory);
+
+// Allocations per category, usage vs budget of device-local heaps
+// Note: Without VK_EXT_memory_budget usage only counts tracked allocations
+//       and budget is MEMORY_FALLBACK_BUDGET_PERCENT of heap sizes
+void memoryGetStats(MemoryStats *stats);
+
+// Print usage, budget and allocations per category on single line
+void memoryPrintStats(FILE *stream);
+
+// Release accounting table
+void memoryShutdown(void);
+
+#endif /* VKMEMORY_H */
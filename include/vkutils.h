@@ -0,0 +1,49 @@
+#ifndef VKUTILS_H
+#define VKUTILS_H
+
+#include "graphics.h"
+#include "vkmemory.h"
+
+// Read whole binary file (e.g. SPIR-V) into newly allocated buffer
+char *readBinFile(const char *fileName, uint32_t *fileSize);
+
+VkShaderModule createShaderModule(VkDevice device, 
+    const char *code, uint32_t codeSize);
+
+VkBool32 deviceExtensionSupported(VkPhysicalDevice physicalDevice,
+    const char *name);
+
+// Size of largest device-local memory heap
+VkDeviceSize deviceLocalHeapSize(VkPhysicalDevice physicalDevice);
+
+// Properties of host-visible readback memory, cached if available, since
+// readback buffers are only ever read by host
+VkMemoryPropertyFlags readbackMemoryProperties(VkPhysicalDevice device);
+
+uint32_t findMemoryType(uint32_t typeFilter, 
+    VkMemoryPropertyFlags props, VkPhysicalDevice physicalDevice);
+
+VkImageView createImageView(VkImage image, VkFormat format, 
+    VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkDevice device);
+
+// Note: Memory of images and buffers is accounted under category and must be
+//       released by freeMemory() (see vkmemory.h)
+void createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
+    VkSampleCountFlagBits nSamples, VkFormat format, VkImageTiling tiling,
+    VkImageUsageFlags usage, VkMemoryPropertyFlags props, 
+    VkImage *image, VkDeviceMemory *imageMemory, VkDevice device, 
+    VkPhysicalDevice physicalDevice, MemoryCategory category);
+
+void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+    VkDeviceSize size, VkBufferUsageFlags usage, 
+    VkMemoryPropertyFlags properties, VkBuffer *buffer, 
+    VkDeviceMemory *bufferMemory, MemoryCategory category);
+
+// Single use command buffers submitted to graphics queue (blocking)
+VkCommandBuffer beginSingleUseCommands(Graphics graphics);
+void endSingleUseCommands(Graphics graphics, VkCommandBuffer commandBuffer);
+
+void copyBuffer(Graphics graphics, VkBuffer src, VkBuffer dst, 
+    VkDeviceSize size);
+
+#endif /* VKUTILS_H */
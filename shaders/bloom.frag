@@ -0,0 +1,23 @@
+#version 450 core
+
+// Adds first level of bloom pyramid to frame (additive blending, see bloom.c)
+
+layout(binding = 0) uniform sampler2D pyramid;
+
+// See bloom.comp for same structure
+layout(push_constant) uniform BloomConstants {
+    vec2 texelSize;
+    uint sourceLevel;
+    float threshold;
+    float intensity;
+} pc;
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // Note: Bilinear filtering upsamples reduced resolution of pyramid
+    outColor = vec4(pc.intensity * textureLod(pyramid, fragUv, 0.0).rgb, 0.0);
+}
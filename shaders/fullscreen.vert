@@ -0,0 +1,12 @@
+#version 450 core
+
+// Fullscreen triangle of post-processing passes (see bloom.frag, trail.frag)
+
+layout(location = 0) out vec2 fragUv;
+
+void main()
+{
+    // Note: Vertices (0, 0), (2, 0), (0, 2) in uv cover whole viewport
+    fragUv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(2.0 * fragUv - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,100 @@
+// Uniform grid spatial hash over particle positions, built every step by
+// grid.comp and queried by force terms of shader.comp
+// Note: Cells have edge interactionRadius and are hashed into gridCellCount
+//       (power of 2) keys, so distinct cells may share a key and neighbors
+//       must be filtered by distance
+// Note: Requires ParameterUBO declared as ubo (see shader.comp)
+
+// See GRID_BINDING_* in grid.h
+// First and past-the-end slot of every cell key in sorted arrays
+layout(std430, binding = 3) buffer GridCellSSBO {
+    uvec2 cellRanges[];
+};
+
+// Position (xy) and velocity (zw) of particles sorted by cell key
+layout(std430, binding = 4) buffer GridParticleSSBO {
+    vec4 sortedParticles[];
+};
+
+// Index of sorted particles in particle buffers
+layout(std430, binding = 5) buffer GridIndexSSBO {
+    uint sortedIndices[];
+};
+
+ivec2 gridCell(vec2 position)
+{
+    return ivec2(floor(position / ubo.interactionRadius));
+}
+
+// source: Teschner et al., "Optimized Spatial Hashing for Collision Detection
+//         of Deformable Objects"
+uint gridKey(ivec2 cell)
+{
+    return ((uint(cell.x) * 73856093u) ^ (uint(cell.y) * 19349663u)) &
+        (ubo.gridCellCount - 1u);
+}
+
+// Iterator over particles within interactionRadius of center, e.g.
+//   NeighborQuery query = gridBeginQuery(position);
+//   while (gridNextNeighbor(query)) { ... query.offset ... }
+// Note: Yields particle at center as well (compare query.index)
+struct NeighborQuery {
+    vec2 center;
+    ivec2 cell;      // cell containing center
+    uint neighbor;   // next of 3 x 3 cells around cell
+    uint keys[9];    // keys of visited cells (skips keys shared by cells)
+    uint slot;       // next slot of current cell
+    uint end;        // past-the-end slot of current cell
+    // Current neighbor
+    uint index;
+    vec2 offset;     // position relative to center
+    vec2 velocity;
+};
+
+NeighborQuery gridBeginQuery(vec2 center)
+{
+    NeighborQuery query;
+    query.center = center;
+    query.cell = gridCell(center);
+    query.neighbor = 0u;
+    query.slot = 0u;
+    query.end = 0u;
+    return query;
+}
+
+// Advance to next neighbor, returns false once all cells were visited
+bool gridNextNeighbor(inout NeighborQuery query)
+{
+    const float radius2 = ubo.interactionRadius * ubo.interactionRadius;
+    while (true) {
+        while (query.slot < query.end) {
+            const uint slot = query.slot++;
+            const vec4 particle = sortedParticles[slot];
+            const vec2 offset = particle.xy - query.center;
+            if (dot(offset, offset) < radius2) {
+                query.index = sortedIndices[slot];
+                query.offset = offset;
+                query.velocity = particle.zw;
+                return true;
+            }
+        }
+        if (query.neighbor == 9u) {
+            return false;
+        }
+        
+        const uint n = query.neighbor++;
+        const ivec2 cell = query.cell + ivec2(int(n % 3u) - 1, int(n / 3u) - 1);
+        const uint key = gridKey(cell);
+        query.keys[n] = key;
+        bool visited = false;
+        for (uint k = 0u; k < n; ++k) {
+            visited = visited || query.keys[k] == key;
+        }
+        if (!visited) {
+            const uvec2 range = cellRanges[key];
+            query.slot = range.x;
+            query.end = range.y;
+        }
+    }
+    return false;
+}
@@ -1,10 +1,56 @@
 #version 450 core
+#extension GL_GOOGLE_include_directive : require
+
+#define M_PI 3.1415926535897932384626433832795
+
+// See shader.vert
+#define LOD_MESH  0
+#define LOD_QUAD  1
+#define LOD_POINT 2
+layout(constant_id = 0) const uint LOD = LOD_MESH;
+
+#include "shape.glsl"
 
 layout(location = 0) in vec4 fragCol;
+layout(location = 1) in vec2 fragLocalPos;
+layout(location = 2) flat in float fragOrientation;
+layout(location = 3) flat in uint fragShape;
 
 layout(location = 0) out vec4 outCol;
 
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;    
+    mat4 view;    
+    mat4 proj;    
+    float starSize;
+    float starInnerRadius;
+    uint starPoints;
+    float pixelSize;
+} ubo;
+
 void main()
 {
-    outCol = fragCol;
+    if (LOD == LOD_MESH) {
+        outCol = fragCol;
+        return;
+    }
+    
+    vec2 p = fragLocalPos;
+    if (LOD == LOD_POINT) {
+        // Undo rotation of star (sprite is axis aligned in framebuffer)
+        const float extent = ubo.starSize + ubo.pixelSize;
+        const float cosTheta = cos(fragOrientation);
+        const float sinTheta = sin(fragOrientation);
+        const mat2 rotation = mat2(cosTheta, -sinTheta,
+                                   sinTheta, cosTheta);
+        p = (extent * (2.0 * gl_PointCoord - 1.0)) * rotation;
+    }
+    // Coverage of pixel from distance in pixels (analytic anti-aliasing)
+    const float dist = shapeDistance(fragShape, p, ubo.starSize,
+        ubo.starInnerRadius, ubo.starPoints) / ubo.pixelSize;
+    const float coverage = clamp(0.5 - dist, 0.0, 1.0);
+    if (coverage == 0.0) {
+        discard;
+    }
+    outCol = vec4(fragCol.rgb, fragCol.a * coverage);
 }
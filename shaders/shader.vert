@@ -1,27 +1,136 @@
 #version 450 core
 
-layout(location = 0) in vec2 inPos;
-layout(location = 1) in vec4 inCol;
-layout(location = 2) in vec2 inParticlePos;
-layout(location = 3) in float inOrientation;
+#define M_PI 3.1415926535897932384626433832795
+
+// Star geometry (see StarLod in graphics.h)
+#define LOD_MESH  0  // triangle fan of outline
+#define LOD_QUAD  1  // quad shaded with signed distance function
+#define LOD_POINT 2  // point sprite shaded with signed distance function
+layout(constant_id = 0) const uint LOD = LOD_MESH;
+
+#define SHAPE_STAR  0  // see ShapeKind in geometry.h
+#define SHAPE_COUNT 4
+
+// See geometry.h for same structure
+struct Particle {
+    vec2 position;
+    vec2 velocity;
+    vec4 color;
+    float orientation;
+    uint shape;
+    uint id;
+};
+
+// See VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
 
 layout(location = 0) out vec4 fragCol;
+layout(location = 1) out vec2 fragLocalPos;  // unrotated position in star
+layout(location = 2) flat out float fragOrientation;
+layout(location = 3) flat out uint fragShape;
 
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;    
     mat4 view;    
     mat4 proj;    
+    float starSize;
+    float starInnerRadius;
+    uint starPoints;
+    float pixelSize;
 } ubo;
 
+// Particles written by compute shader in this frame
+layout(std140, binding = 1) readonly buffer ParticleSSBO {
+    Particle particles[];
+};
+
+// Unit size vertices of shape arena (see geomBuildShapes)
+layout(std430, binding = 2) readonly buffer ShapeVertexSSBO {
+    vec2 shapeVertices[];
+};
+
+// Particle indices bucketed by shape (see bucket.comp)
+layout(std430, binding = 3) readonly buffer InstanceSSBO {
+    uint instances[];
+};
+
+// Indirect draws of shapes, instances counted by bucket.comp
+layout(std430, binding = 4) readonly buffer DrawCommandSSBO {
+    DrawCommand draws[SHAPE_COUNT];
+};
+
+// Shape drawn if indirect draws cannot set first instance, its instances
+// follow those of all shapes before it (0 -> first instance is set)
+layout(push_constant) uniform PushConstants {
+    uint baseShape;
+} pc;
+
+// Offset of instances of drawn shape
+uint instanceBase()
+{
+    uint base = 0u;
+    for (uint s = 0u; s < pc.baseShape; ++s) {
+        base += draws[s].instanceCount;
+    }
+    return base;
+}
+
+// Returns corner of star outline (tips at even, inner corners at odd k)
+// Note: Tip 0 points upwards (negative y-axis), see geomStarInnerRatio()
+vec2 starCorner(uint k)
+{
+    const float angle = float(k) * M_PI / float(ubo.starPoints);
+    const float radius = (k & 1u) == 0u ? ubo.starSize : ubo.starInnerRadius;
+    return -radius * vec2(sin(angle), cos(angle));
+}
+
+// Quad around star as 2 triangles, same winding as star triangles
+const vec2 QUAD_CORNERS[6] = vec2[](
+    vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0),
+    vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(-1.0, -1.0)
+);
+
 void main()
 {
+    // Note: Mesh is drawn per shape (indirect), SDF once for all particles
+    const uint particleIndex = LOD == LOD_MESH ?
+        instances[instanceBase() + gl_InstanceIndex] : gl_InstanceIndex;
+    const Particle particle = particles[particleIndex];
+    fragCol = particle.color;    
+    fragOrientation = particle.orientation;
+    fragShape = particle.shape;
+    
+    // Note: Margin of 1 pixel leaves room for anti-aliased edges
+    const float extent = ubo.starSize + ubo.pixelSize;
+    vec2 inPos = vec2(0.0);
+    if (LOD == LOD_POINT) {
+        // Note: Point sprites cannot rotate, fragment shader rotates instead
+        gl_PointSize = 2.0 * extent / ubo.pixelSize;
+    } else if (LOD == LOD_QUAD) {
+        inPos = extent * QUAD_CORNERS[gl_VertexIndex];
+    } else if (particle.shape == SHAPE_STAR) {
+        // Star is a fan of 2 * starPoints triangles (center, k + 1, k) around
+        // the center, its indices just enumerate vertices
+        const uint triangle = uint(gl_VertexIndex) / 3u;
+        const uint corner = uint(gl_VertexIndex) % 3u;
+        inPos = corner == 0u ? vec2(0.0) : starCorner(triangle + 2u - corner);
+    } else {
+        inPos = ubo.starSize * shapeVertices[gl_VertexIndex];
+    }
+    fragLocalPos = inPos;
+    
     // Note: Could also directly pass 2 x 2 rotation matrix
-    const float cosTheta = cos(inOrientation);
-    const float sinTheta = sin(inOrientation);
+    const float cosTheta = cos(particle.orientation);
+    const float sinTheta = sin(particle.orientation);
     const mat2 rotation = mat2(cosTheta, -sinTheta,
                                sinTheta, cosTheta);
     const vec2 rotatedPos = rotation * inPos;
     
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(rotatedPos + inParticlePos, 0.0, 1.0);
-    fragCol = inCol;    
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(rotatedPos + particle.position, 0.0, 1.0);
 }
@@ -0,0 +1,75 @@
+// Signed distance functions of particle shapes, shared by fragment shader
+// and tile rasterizer (see shader.frag and tiles.comp)
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+// See geometry.h for same constants
+#define SHAPE_STAR    0
+#define SHAPE_POLYGON 1
+#define SHAPE_RING    2
+#define SHAPE_COMET   3
+#define POLYGON_SIDES      6
+#define RING_INNER_RATIO   0.6
+#define COMET_HEAD_RADIUS  0.4
+#define COMET_TAIL_RADIUS  0.1
+
+// Signed distance from p to outline of star (negative inside)
+// Note: Same outline as star mesh (tip 0 along negative y-axis)
+float starDistance(vec2 p, float outerRadius, float innerRadius, uint points)
+{
+    // Fold p into half sector between tip (angle 0) and inner corner
+    const float sector = M_PI / float(points);
+    const float angle = mod(atan(-p.x, -p.y), 2.0 * sector);
+    const float theta = sector - abs(angle - sector);
+    const vec2 q = length(p) * vec2(cos(theta), sin(theta));
+    
+    // Distance to edge from tip to inner corner
+    const vec2 tip = vec2(outerRadius, 0.0);
+    const vec2 edge = innerRadius * vec2(cos(sector), sin(sector)) - tip;
+    const vec2 w = q - tip;
+    const float h = clamp(dot(w, edge) / dot(edge, edge), 0.0, 1.0);
+    const float dist = length(w - h * edge);
+    // Note: Center of star lies left of edge
+    return edge.x * w.y - edge.y * w.x > 0.0 ? -dist : dist;
+}
+
+// Signed distance to convex hull of disk r1 around origin and disk r2
+// around (0, h), source: https://iquilezles.org/articles/distfunctions2d/
+float unevenCapsuleDistance(vec2 p, float r1, float r2, float h)
+{
+    p.x = abs(p.x);
+    const float b = (r1 - r2) / h;
+    const float a = sqrt(1.0 - b*b);
+    const float k = dot(p, vec2(-b, a));
+    if (k < 0.0) {
+        return length(p) - r1;
+    }
+    if (k > a * h) {
+        return length(p - vec2(0.0, h)) - r2;
+    }
+    return dot(p, vec2(a, b)) - r1;
+}
+
+// Signed distance to outline of shape with size s (same as arena meshes)
+float shapeDistance(uint shape, vec2 p, float s, float starInnerRadius,
+    uint starPoints)
+{
+    if (shape == SHAPE_POLYGON) {
+        // Note: Polygon is star with inner corners at midpoints of its edges
+        return starDistance(p, s, s * cos(M_PI / POLYGON_SIDES), POLYGON_SIDES);
+    }
+    if (shape == SHAPE_RING) {
+        const float center = 0.5 * (1.0 + RING_INNER_RATIO) * s;
+        const float halfWidth = 0.5 * (1.0 - RING_INNER_RATIO) * s;
+        return abs(length(p) - center) - halfWidth;
+    }
+    if (shape == SHAPE_COMET) {
+        const float headY = (COMET_HEAD_RADIUS - 1.0) * s;
+        const float tailY = (1.0 - COMET_TAIL_RADIUS) * s;
+        return unevenCapsuleDistance(p - vec2(0.0, headY), COMET_HEAD_RADIUS * s,
+            COMET_TAIL_RADIUS * s, tailY - headY);
+    }
+    return starDistance(p, s, starInnerRadius, starPoints);
+}
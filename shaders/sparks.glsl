@@ -0,0 +1,20 @@
+// Append counter and indirect arguments of sparks, shared by update dispatch
+// and spark passes (see shader.comp and sparks.comp)
+
+// See SparkState in sparks.h for same structure
+struct SparkState {
+    uint groupCountX;    // indirect dispatch of next update pass
+    uint groupCountY;
+    uint groupCountZ;
+    uint vertexCount;    // indirect draw, one quad per spark
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint count;          // #live sparks, #requested slots until finalize
+    uint emitted;        // #sparks appended by bursting stars
+    uint dropped;        // #sparks exceeding capacity
+};
+
+#define SPARK_LOCAL_SIZE 256u  // see SPARK_LOCAL_SIZE in sparks.h
+#define SPARK_LIFETIME   1.2   // seconds until spark burns out
+#define SPARK_SPEED      0.25  // mean speed relative to bursting star
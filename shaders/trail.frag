@@ -0,0 +1,14 @@
+#version 450 core
+
+// Fades accumulated frame in trail mode (see createTrailPipeline())
+// Note: Blending computes decay * dst - step, so faint trails still reach
+//       black despite rounding of 8 bit framebuffers
+
+#define FADE_STEP (1.0 / 255.0)
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = vec4(vec3(FADE_STEP), 0.0);
+}
@@ -0,0 +1,298 @@
+#include "benchmark.h"
+#include "graphics.h"
+#include "profiler.h"
+#include "profile.h"
+
+#include <math.h>  // ceil()
+
+// Statistics of a single profile/particle count/MSAA/reorder configuration
+typedef struct BenchResult {
+    ProfileKind profile;       // resolved performance profile
+    uint32_t workgroupSize;    // of particle update
+    uint32_t particles;
+    uint32_t msaa;             // sample count actually used
+    uint32_t reorder;          // #frames between Morton sorts (0 -> off)
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+    ProfilerStats stats;       // means over measured frames
+} BenchResult;
+
+static int compareDouble(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, uint64_t count, double p)
+{
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * (double)count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+// Write string as quoted JSON string
+static void writeJsonString(FILE *stream, const char *str)
+{
+    fputc('"', stream);
+    for (const char *c = str; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', stream);
+        }
+        fputc(*c, stream);
+    }
+    fputc('"', stream);
+}
+
+static void writeCsvHeader(FILE *stream)
+{
+    fprintf(stream, "device,width,height,seed,profile,workgroup,particles,msaa,reorder,"
+        "frames,seconds,fps,frame_mean_ms,frame_p50_ms,frame_p95_ms,frame_p99_ms,frame_max_ms");
+    for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+        fprintf(stream, ",cpu_%s_ms", cpuPhaseName(i));
+    }
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        fprintf(stream, ",gpu_%s_ms", gpuPassName(i));
+    }
+    for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+        fprintf(stream, ",%s", pipelineStatName(i));
+    }
+    for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+        fprintf(stream, ",%s", gpuCounterName(i));
+    }
+    fprintf(stream, "\n");
+}
+
+static void writeCsvRow(FILE *stream, const Options *options,
+    const char *device, const BenchResult *result)
+{
+    const ProfilerStats *stats = &result->stats;
+    // Note: Device names do not contain quotes
+    fprintf(stream, "\"%s\",%u,%u,%u,%s,%u,%u,%u,%u,%llu,%.6f,%.3f,%.6f,%.6f,%.6f,%.6f,%.6f",
+        device, options->width, options->height, options->seed,
+        profileGet(result->profile)->name, result->workgroupSize,
+        result->particles, result->msaa, result->reorder,
+        (unsigned long long)stats->frames,
+        stats->seconds, (double)stats->frames / stats->seconds,
+        stats->frameMs, result->p50Ms, result->p95Ms, result->p99Ms,
+        result->maxMs);
+    for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+        fprintf(stream, ",%.6f", stats->cpuMs[i]);
+    }
+    // Empty field -> GPU time/statistic unavailable
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        if (stats->gpuValid[i]) {
+            fprintf(stream, ",%.6f", stats->gpuMs[i]);
+        } else {
+            fprintf(stream, ",");
+        }
+    }
+    for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+        if (stats->pipelineStatsValid) {
+            fprintf(stream, ",%.0f", stats->pipelineStats[i]);
+        } else {
+            fprintf(stream, ",");
+        }
+    }
+    for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+        if (stats->countersValid) {
+            fprintf(stream, ",%.0f", stats->counters[i]);
+        } else {
+            fprintf(stream, ",");
+        }
+    }
+    fprintf(stream, "\n");
+}
+
+static void writeJsonResult(FILE *stream, const Options *options,
+    const char *device, const BenchResult *result, VkBool32 first)
+{
+    const ProfilerStats *stats = &result->stats;
+    fprintf(stream, "%s\n    {\"device\": ", first ? "" : ",");
+    writeJsonString(stream, device);
+    fprintf(stream, ", \"width\": %u, \"height\": %u, \"seed\": %u,\n",
+        options->width, options->height, options->seed);
+    fprintf(stream, "     \"profile\": \"%s\", \"workgroup\": %u,\n",
+        profileGet(result->profile)->name, result->workgroupSize);
+    fprintf(stream, "     \"particles\": %u, \"msaa\": %u, \"reorder\": %u, "
+        "\"frames\": %llu, \"seconds\": %.6f, \"fps\": %.3f,\n",
+        result->particles, result->msaa, result->reorder,
+        (unsigned long long)stats->frames, stats->seconds,
+        (double)stats->frames / stats->seconds);
+    fprintf(stream, "     \"frame_ms\": {\"mean\": %.6f, \"p50\": %.6f, "
+        "\"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f},\n", stats->frameMs,
+        result->p50Ms, result->p95Ms, result->p99Ms, result->maxMs);
+    fprintf(stream, "     \"cpu_ms\": {");
+    for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+        fprintf(stream, "%s\"%s\": %.6f", i > 0 ? ", " : "", cpuPhaseName(i),
+            stats->cpuMs[i]);
+    }
+    // null -> GPU time/statistic unavailable
+    fprintf(stream, "},\n     \"gpu_ms\": {");
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        fprintf(stream, "%s\"%s\": ", i > 0 ? ", " : "", gpuPassName(i));
+        if (stats->gpuValid[i]) {
+            fprintf(stream, "%.6f", stats->gpuMs[i]);
+        } else {
+            fprintf(stream, "null");
+        }
+    }
+    fprintf(stream, "},\n     \"pipeline_stats\": {");
+    for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+        fprintf(stream, "%s\"%s\": ", i > 0 ? ", " : "", pipelineStatName(i));
+        if (stats->pipelineStatsValid) {
+            fprintf(stream, "%.0f", stats->pipelineStats[i]);
+        } else {
+            fprintf(stream, "null");
+        }
+    }
+    fprintf(stream, "},\n     \"counters\": {");
+    for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+        fprintf(stream, "%s\"%s\": ", i > 0 ? ", " : "", gpuCounterName(i));
+        if (stats->countersValid) {
+            fprintf(stream, "%.0f", stats->counters[i]);
+        } else {
+            fprintf(stream, "null");
+        }
+    }
+    fprintf(stream, "}}");
+}
+
+// Render and measure frames of a single configuration
+// Returns VK_FALSE if window was closed before measurement completed
+static VkBool32 measure(Graphics graphics, const Options *options,
+    BenchResult *result)
+{
+    // Warm-up: Fill pipeline, caches and let clocks ramp up
+    for (uint32_t i = 0; i < options->benchWarmup; ++i) {
+        if (!renderFrame(graphics)) {
+            return VK_FALSE;
+        }
+    }
+    
+    uint64_t capacity = options->benchFrames > 0 ? options->benchFrames : 1024;
+    double *frameMs = NULL;
+    CHK_ALLOC(frameMs = malloc(capacity * sizeof(double)));
+    
+    VkBool32 completed = VK_TRUE;
+    uint64_t frames = 0;
+    const uint64_t start = timerNanoseconds();
+    uint64_t now = start;
+    profilerResetStats(graphics);
+    for (;;) {
+        if (options->benchFrames > 0 && frames >= options->benchFrames) {
+            break;
+        }
+        if (options->benchSeconds > 0.0 &&
+            (double)(now - start) * 1e-9 >= options->benchSeconds)
+        {
+            break;
+        }
+        
+        const uint64_t frameCounter = graphics->frameCounter;
+        if (!renderFrame(graphics)) {
+            completed = VK_FALSE;
+            break;
+        }
+        now = timerNanoseconds();
+        // Note: Frames skipped due to swapchain recreation are not counted
+        if (graphics->frameCounter == frameCounter) {
+            continue;
+        }
+        
+        if (frames == capacity) {
+            capacity *= 2;
+            CHK_ALLOC(frameMs = realloc(frameMs, capacity * sizeof(double)));
+        }
+        frameMs[frames++] = graphics->profiler->timings.frameMs;
+    }
+    // Note: Means over the same frames
+    profilerGetStats(graphics, &result->stats);
+    
+    if (frames > 0) {
+        qsort(frameMs, frames, sizeof(double), compareDouble);
+        result->p50Ms = percentile(frameMs, frames, 50.0);
+        result->p95Ms = percentile(frameMs, frames, 95.0);
+        result->p99Ms = percentile(frameMs, frames, 99.0);
+        result->maxMs = frameMs[frames - 1];
+    }
+    
+    free(frameMs);
+    return completed;
+}
+
+void runBenchmark(const Options *options)
+{
+    assert(options && "Expected non-NULL options");
+    
+    // Note: Opened first, since writing to stdout redirects printf()
+    FILE *stream = openOutputFile(options->benchOutput);
+    
+    if (options->benchFormat == BENCH_FORMAT_CSV) {
+        writeCsvHeader(stream);
+    } else {
+        fprintf(stream, "{\"results\": [");
+    }
+    
+    VkBool32 first = VK_TRUE;
+    VkBool32 closed = VK_FALSE;
+    for (uint32_t f = 0; f < options->profileSweepCount && !closed; ++f) {
+        for (uint32_t p = 0; p < options->particleSweepCount && !closed; ++p) {
+            for (uint32_t m = 0; m < options->msaaSweepCount && !closed; ++m) {
+                for (uint32_t r = 0; r < options->reorderSweepCount && !closed; ++r) {
+                    Options run = *options;
+                    run.particleCount = options->particleSweep[p];
+                    run.msaaSamples = options->msaaSweep[m];
+                    run.reorderInterval = options->reorderSweep[r];
+                    run.profile = options->profileSweep[f];
+                    // Note: Logging would reset stats accumulated during measurement
+                    run.statsInterval = 0.0;
+                    // Note: Same seed -> same initial particles for every configuration
+                    Graphics graphics = initGraphics(&run);
+                    
+                    BenchResult result = {0};
+                    // Note: Both may be lowered to fit memory budget
+                    result.particles = graphics->options.particleCount;
+                    result.msaa = (uint32_t)graphics->msaaSamples;
+                    result.reorder = run.reorderInterval;
+                    result.profile = graphics->options.profile;
+                    result.workgroupSize = graphics->options.workgroupSize;
+                    printf("Benchmark: profile %s, %u particles, %ux MSAA, reorder %u\n",
+                        profileGet(result.profile)->name, result.particles,
+                        result.msaa, result.reorder);
+                    
+                    closed = !measure(graphics, &run, &result);
+                    vkDeviceWaitIdle(graphics->device);
+                    
+                    if (result.stats.frames > 0) {
+                        const char *device = graphics->deviceProperties.deviceName;
+                        if (options->benchFormat == BENCH_FORMAT_CSV) {
+                            writeCsvRow(stream, &run, device, &result);
+                        } else {
+                            writeJsonResult(stream, &run, device, &result, first);
+                        }
+                        first = VK_FALSE;
+                        fflush(stream);
+                    }
+                    cleanupGraphics(graphics);
+                }
+            }
+        }
+    }
+    
+    if (options->benchFormat == BENCH_FORMAT_JSON) {
+        fprintf(stream, "\n]}\n");
+    }
+    if (closed) {
+        fprintf(stderr, "Benchmark aborted, window was closed\n");
+    }
+    if (fclose(stream) != 0) {
+        fprintf(stderr, "Failed to write benchmark results\n");
+        exit(EXIT_FAILURE);
+    }
+}
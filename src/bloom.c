@@ -0,0 +1,736 @@
+#include "bloom.h"
+#include "vkutils.h"
+
+// Quality tier after resolving auto (CPU drivers cannot afford post-processing)
+static Quality resolveQuality(Graphics graphics)
+{
+    if (graphics->options.quality != QUALITY_AUTO) {
+        return graphics->options.quality;
+    }
+    return graphics->deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ?
+        QUALITY_LOW : QUALITY_HIGH;
+}
+
+// Whether rendered swapchain images can be blitted into pyramid
+static VkBool32 bloomSupported(Graphics graphics)
+{
+    // Note: Offscreen images are always copy sources
+    const VkBool32 copyable = graphics->options.headless ||
+        (graphics->swapChainSupport.capabilities.supportedUsageFlags &
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(graphics->physicalDevice,
+        graphics->swapChainData.format, &properties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return copyable &&
+        (properties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+static void createDescriptors(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    
+    // Whole pyramid (sampled) and written level (see bloom.comp)
+    VkDescriptorSetLayoutBinding layoutBindings[2] = {0};
+    layoutBindings[0].binding = 0;
+    layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    layoutBindings[0].descriptorCount = 1;
+    layoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT |
+        VK_SHADER_STAGE_FRAGMENT_BIT;
+    layoutBindings[1].binding = 1;
+    layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    layoutBindings[1].descriptorCount = 1;
+    layoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = layoutBindings;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfo,
+        NULL, &bloom->descriptorLayout),
+        "Failed to create bloom descriptor set layout\n");
+    
+    VkDescriptorPoolSize poolSizes[2] = {0};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = BLOOM_MAX_LEVELS;
+    
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = BLOOM_MAX_LEVELS;
+    
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = BLOOM_MAX_LEVELS;
+    
+    CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
+        &bloom->descriptorPool), "Failed to create bloom descriptor pool\n");
+    
+    VkDescriptorSetLayout layouts[BLOOM_MAX_LEVELS];
+    for (uint32_t i = 0; i < BLOOM_MAX_LEVELS; ++i) {
+        layouts[i] = bloom->descriptorLayout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = bloom->descriptorPool;
+    allocInfo.descriptorSetCount = BLOOM_MAX_LEVELS;
+    allocInfo.pSetLayouts = layouts;
+    
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+        bloom->sets), "Failed to allocate bloom descriptor sets\n");
+    
+    // Note: Levels are sampled in GENERAL layout, since they are written by
+    //       other passes in between
+    VkSamplerCreateInfo samplerInfo = {0};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = (float)BLOOM_MAX_LEVELS;
+    
+    CHK_VK_ERR(vkCreateSampler(graphics->device, &samplerInfo, NULL,
+        &bloom->sampler), "Failed to create bloom sampler\n");
+}
+
+// Render pass adding glow to rendered swapchain image
+static void createRenderPass(Graphics graphics)
+{
+    const VkImageLayout outputLayout = graphics->options.headless ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    
+    VkAttachmentDescription colorAttachment = {0};
+    colorAttachment.format = graphics->swapChainData.format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    // Keep rendered frame, glow is blended on top
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // Note: Image was blitted into pyramid before (see bloomRecordFrame())
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    colorAttachment.finalLayout = outputLayout;
+    
+    VkAttachmentReference colorAttachmentRef = {0};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    
+    VkSubpassDescription subpass = {0};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    
+    // Wait for blit reading image and for pyramid to be complete
+    VkSubpassDependency dependency = {0};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT |
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                               VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                               VK_ACCESS_SHADER_READ_BIT;
+    
+    VkRenderPassCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    createInfo.attachmentCount = 1;
+    createInfo.pAttachments = &colorAttachment;
+    createInfo.subpassCount = 1;
+    createInfo.pSubpasses = &subpass;
+    createInfo.dependencyCount = 1;
+    createInfo.pDependencies = &dependency;
+    
+    CHK_VK_ERR(vkCreateRenderPass(graphics->device, &createInfo, NULL,
+        &graphics->bloom->renderPass), "Failed to create bloom render pass\n");
+}
+
+static void createComputePipelines(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/bloom.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = bloom->pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    
+    // Note: Pass is selected by specialization constant 0
+    const VkSpecializationMapEntry passEntry = { 0, 0, sizeof(uint32_t) };
+    for (uint32_t pass = 0; pass < BLOOM_PASS_COUNT; ++pass) {
+        VkSpecializationInfo specInfo = {0};
+        specInfo.mapEntryCount = 1;
+        specInfo.pMapEntries = &passEntry;
+        specInfo.dataSize = sizeof(uint32_t);
+        specInfo.pData = &pass;
+        pipelineInfo.stage.pSpecializationInfo = &specInfo;
+        
+        CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+            &pipelineInfo, NULL, &bloom->pipelines[pass]),
+            "Failed to create bloom pipeline\n");
+    }
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+// Fullscreen triangle adding first level of pyramid to swapchain image
+static void createCompositePipeline(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    
+    uint32_t vertShaderSize = 0, fragShaderSize = 0;
+    char *vertShaderSource = readBinFile("shaders/bin/fullscreen.vert.spv", &vertShaderSize);
+    char *fragShaderSource = readBinFile("shaders/bin/bloom.frag.spv", &fragShaderSize);
+    VkShaderModule vertShaderModule = createShaderModule(graphics->device,
+        vertShaderSource, vertShaderSize);
+    VkShaderModule fragShaderModule = createShaderModule(graphics->device,
+        fragShaderSource, fragShaderSize);
+    
+    VkPipelineShaderStageCreateInfo shaderInfos[2] = {0};
+    shaderInfos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderInfos[0].module = vertShaderModule;
+    shaderInfos[0].pName = "main";
+    shaderInfos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderInfos[1].module = fragShaderModule;
+    shaderInfos[1].pName = "main";
+    
+    // Note: Triangle is derived from vertex index (see fullscreen.vert)
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {0};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    
+    VkPipelineInputAssemblyStateCreateInfo assemblyInfo = {0};
+    assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    assemblyInfo.primitiveRestartEnable = VK_FALSE;
+    
+    VkPipelineViewportStateCreateInfo viewportInfo = {0};
+    viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportInfo.viewportCount = 1;
+    viewportInfo.scissorCount = 1;
+    
+    const VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    
+    VkPipelineDynamicStateCreateInfo dynamicInfo = {0};
+    dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicInfo.dynamicStateCount = 2;
+    dynamicInfo.pDynamicStates = dynamicStates;
+    
+    VkPipelineRasterizationStateCreateInfo rasterizationInfo = {0};
+    rasterizationInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationInfo.lineWidth = 1.0f;
+    rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+    rasterizationInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    
+    VkPipelineMultisampleStateCreateInfo multisampleInfo = {0};
+    multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    
+    // C = src + dst, alpha of frame is kept
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {0};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+                                          VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT |
+                                          VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    
+    VkPipelineColorBlendStateCreateInfo colorBlendInfo = {0};
+    colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendInfo.logicOpEnable = VK_FALSE;
+    colorBlendInfo.attachmentCount = 1;
+    colorBlendInfo.pAttachments = &colorBlendAttachment;
+    
+    VkGraphicsPipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderInfos;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &assemblyInfo;
+    pipelineInfo.pViewportState = &viewportInfo;
+    pipelineInfo.pRasterizationState = &rasterizationInfo;
+    pipelineInfo.pMultisampleState = &multisampleInfo;
+    pipelineInfo.pColorBlendState = &colorBlendInfo;
+    pipelineInfo.pDynamicState = &dynamicInfo;
+    pipelineInfo.layout = bloom->pipelineLayout;
+    VkPipelineRenderingCreateInfoKHR renderingInfo = {0};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &graphics->swapChainData.format;
+    pipelineInfo.pNext = graphics->dynamicRendering ? &renderingInfo : NULL;
+    pipelineInfo.renderPass = bloom->renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+    
+    CHK_VK_ERR(vkCreateGraphicsPipelines(graphics->device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &bloom->compositePipeline),
+        "Failed to create bloom composite pipeline\n");
+    
+    vkDestroyShaderModule(graphics->device, vertShaderModule, NULL);
+    vkDestroyShaderModule(graphics->device, fragShaderModule, NULL);
+    free(vertShaderSource);
+    free(fragShaderSource);
+}
+
+static void createPipelines(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    
+    // Note: Composite reads intensity from same constants as compute passes
+    VkPushConstantRange pushConstantRange = {0};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT |
+        VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(BloomConstants);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &bloom->descriptorLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfo,
+        NULL, &bloom->pipelineLayout),
+        "Failed to create bloom pipeline layout\n");
+    
+    createComputePipelines(graphics);
+    createCompositePipeline(graphics);
+}
+
+// View of single level, written as storage image
+static VkImageView createLevelView(Graphics graphics, uint32_t level)
+{
+    VkImageViewCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image = graphics->bloom->image;
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = BLOOM_FORMAT;
+    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    createInfo.subresourceRange.baseMipLevel = level;
+    createInfo.subresourceRange.levelCount = 1;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+    
+    VkImageView view;
+    CHK_VK_ERR(vkCreateImageView(graphics->device, &createInfo, NULL, &view),
+        "Failed to create bloom level view\n");
+    return view;
+}
+
+static void createPyramid(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    const uint32_t scale = graphics->options.bloomScale;
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    
+    // Halve resolution per level until requested #levels or a single pixel
+    VkExtent2D levelExtent = {
+        (extent.width + scale - 1) / scale,
+        (extent.height + scale - 1) / scale
+    };
+    bloom->levelCount = 0;
+    while (bloom->levelCount < graphics->options.bloomLevels) {
+        bloom->extents[bloom->levelCount++] = levelExtent;
+        if (levelExtent.width == 1 || levelExtent.height == 1) {
+            break;
+        }
+        levelExtent.width = (levelExtent.width + 1) / 2;
+        levelExtent.height = (levelExtent.height + 1) / 2;
+    }
+    
+    createImage(bloom->extents[0].width, bloom->extents[0].height,
+        bloom->levelCount, VK_SAMPLE_COUNT_1_BIT, BLOOM_FORMAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &bloom->image, &bloom->memory,
+        graphics->device, graphics->physicalDevice, MEMORY_ATTACHMENTS);
+    bloom->view = createImageView(bloom->image, BLOOM_FORMAT,
+        VK_IMAGE_ASPECT_COLOR_BIT, bloom->levelCount, graphics->device);
+    
+    VkDescriptorImageInfo sampledInfo = {0};
+    sampledInfo.sampler = bloom->sampler;
+    sampledInfo.imageView = bloom->view;
+    sampledInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    
+    for (uint32_t i = 0; i < bloom->levelCount; ++i) {
+        bloom->levelViews[i] = createLevelView(graphics, i);
+        
+        VkDescriptorImageInfo storageInfo = {0};
+        storageInfo.imageView = bloom->levelViews[i];
+        storageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        
+        VkWriteDescriptorSet descriptorWrites[2] = {0};
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = bloom->sets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pImageInfo = &sampledInfo;
+        
+        descriptorWrites[1] = descriptorWrites[0];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[1].pImageInfo = &storageInfo;
+        
+        vkUpdateDescriptorSets(graphics->device, 2, descriptorWrites, 0, NULL);
+    }
+}
+
+static void createFramebuffers(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    const SwapChainData *swapChain = &graphics->swapChainData;
+    
+    bloom->frameBufferCount = swapChain->imageCount;
+    CHK_ALLOC(bloom->frameBuffers =
+        malloc(swapChain->imageCount * sizeof(VkFramebuffer)));
+    
+    for (uint32_t i = 0; i < swapChain->imageCount; ++i) {
+        VkFramebufferCreateInfo createInfo = {0};
+        createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        createInfo.renderPass = bloom->renderPass;
+        createInfo.attachmentCount = 1;
+        createInfo.pAttachments = &swapChain->imageViews[i];
+        createInfo.width = swapChain->extent.width;
+        createInfo.height = swapChain->extent.height;
+        createInfo.layers = 1;
+        
+        CHK_VK_ERR(vkCreateFramebuffer(graphics->device, &createInfo, NULL,
+            &bloom->frameBuffers[i]), "Failed to create bloom framebuffer(s)\n");
+    }
+}
+
+// Release pyramid and framebuffers of previous extent
+static void cleanupPyramid(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    for (uint32_t i = 0; i < bloom->frameBufferCount; ++i) {
+        vkDestroyFramebuffer(graphics->device, bloom->frameBuffers[i], NULL);
+    }
+    FREE_NULL(bloom->frameBuffers);
+    bloom->frameBufferCount = 0;
+    
+    for (uint32_t i = 0; i < bloom->levelCount; ++i) {
+        vkDestroyImageView(graphics->device, bloom->levelViews[i], NULL);
+    }
+    vkDestroyImageView(graphics->device, bloom->view, NULL);
+    vkDestroyImage(graphics->device, bloom->image, NULL);
+    freeMemory(graphics->device, bloom->memory);
+    bloom->levelCount = 0;
+}
+
+void initBloom(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    if (resolveQuality(graphics) == QUALITY_LOW) {
+        return;
+    }
+    if (!bloomSupported(graphics)) {
+        fprintf(stderr, "Swapchain images cannot be blitted, bloom disabled\n");
+        return;
+    }
+    
+    Bloom *bloom = NULL;
+    CHK_ALLOC(bloom = calloc(1, sizeof(Bloom)));
+    graphics->bloom = bloom;
+    
+    createDescriptors(graphics);
+    if (!graphics->dynamicRendering) {
+        createRenderPass(graphics);
+    }
+    createPipelines(graphics);
+    bloomResize(graphics);
+}
+
+void bloomResize(Graphics graphics)
+{
+    if (graphics->bloom->image != VK_NULL_HANDLE) {
+        cleanupPyramid(graphics);
+    }
+    createPyramid(graphics);
+    if (!graphics->dynamicRendering) {
+        createFramebuffers(graphics);
+    }
+}
+
+// Wait for writes of previous pass before sampling/writing pyramid again
+static void passBarrier(VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// Dispatch pass writing level from source level
+static void recordPass(Graphics graphics, VkCommandBuffer commandBuffer,
+    BloomPass pass, uint32_t level, uint32_t sourceLevel)
+{
+    const Bloom *bloom = graphics->bloom;
+    const VkExtent2D source = bloom->extents[sourceLevel];
+    const VkExtent2D target = bloom->extents[level];
+    
+    BloomConstants constants = {0};
+    constants.texelSize[0] = 1.0f / (float)source.width;
+    constants.texelSize[1] = 1.0f / (float)source.height;
+    constants.sourceLevel = sourceLevel;
+    constants.threshold = BLOOM_THRESHOLD;
+    constants.intensity = BLOOM_INTENSITY;
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        bloom->pipelines[pass]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        bloom->pipelineLayout, 0, 1, &bloom->sets[level], 0, NULL);
+    vkCmdPushConstants(commandBuffer, bloom->pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+        sizeof(BloomConstants), &constants);
+    // Note: 8x8 invocations per work group, 1 per texel
+    vkCmdDispatch(commandBuffer, (target.width + 7) / 8, (target.height + 7) / 8, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+// Layout transition of swapchain image around dynamic composite pass
+static void outputBarrier(VkCommandBuffer commandBuffer, VkImage image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    
+    // Note: Global barrier makes pyramid visible to fragment shader
+    VkMemoryBarrier memoryBarrier = {0};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+    
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &memoryBarrier,
+        0, NULL, 1, &barrier);
+}
+
+// Begin composite with render pass, or with dynamic rendering, transition
+// swapchain image as the render pass would (see createRenderPass())
+static void beginComposite(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    const Bloom *bloom = graphics->bloom;
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    
+    if (!graphics->dynamicRendering) {
+        VkRenderPassBeginInfo renderPassInfo = {0};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = bloom->renderPass;
+        renderPassInfo.framebuffer = bloom->frameBuffers[imageIndex];
+        renderPassInfo.renderArea.offset = (VkOffset2D) {0, 0};
+        renderPassInfo.renderArea.extent = extent;
+        
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+            VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+    
+    // Wait for blit reading image and for pyramid to be complete
+    outputBarrier(commandBuffer, graphics->swapChainData.images[imageIndex],
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_SHADER_READ_BIT);
+    
+    // Keep rendered frame, glow is blended on top
+    VkRenderingAttachmentInfoKHR colorAttachment = {0};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageView = graphics->swapChainData.imageViews[imageIndex];
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    
+    VkRenderingInfoKHR renderingInfo = {0};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.extent = extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    
+    graphics->cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+static void endComposite(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    if (!graphics->dynamicRendering) {
+        vkCmdEndRenderPass(commandBuffer);
+        return;
+    }
+    
+    graphics->cmdEndRendering(commandBuffer);
+    // Output layout, export barrier chains on attachment output stage
+    outputBarrier(commandBuffer, graphics->swapChainData.images[imageIndex],
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, graphics->options.headless ?
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT);
+}
+
+static void recordComposite(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    const Bloom *bloom = graphics->bloom;
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    
+    beginComposite(graphics, commandBuffer, imageIndex);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        bloom->compositePipeline);
+    
+    VkViewport viewport = {0};
+    viewport.width = (float) extent.width;
+    viewport.height = (float) extent.height;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    
+    VkRect2D scissor = {0};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    
+    BloomConstants constants = {0};
+    constants.intensity = BLOOM_INTENSITY;
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        bloom->pipelineLayout, 0, 1, &bloom->sets[0], 0, NULL);
+    vkCmdPushConstants(commandBuffer, bloom->pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+        sizeof(BloomConstants), &constants);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    
+    endComposite(graphics, commandBuffer, imageIndex);
+}
+
+void bloomRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    const Bloom *bloom = graphics->bloom;
+    const VkImage image = graphics->swapChainData.images[imageIndex];
+    
+    // Previous frame may still sample pyramid (same queue)
+    // Note: Render graph moved rendered image to transfer layout (see
+    //       buildFrameGraph())
+    VkImageMemoryBarrier pyramidBarrier = {0};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    // Note: Every level is rewritten each frame
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.image = bloom->image;
+    pyramidBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramidBarrier.subresourceRange.baseMipLevel = 0;
+    pyramidBarrier.subresourceRange.levelCount = bloom->levelCount;
+    pyramidBarrier.subresourceRange.baseArrayLayer = 0;
+    pyramidBarrier.subresourceRange.layerCount = 1;
+    
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        0, NULL, 0, NULL, 1, &pyramidBarrier);
+    
+    // Downscale frame into first level (filtered by blit)
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    VkImageBlit blit = {0};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = 0;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = (VkOffset3D) {(int32_t)extent.width, (int32_t)extent.height, 1};
+    blit.dstSubresource = blit.srcSubresource;
+    blit.dstOffsets[1] = (VkOffset3D) {
+        (int32_t)bloom->extents[0].width, (int32_t)bloom->extents[0].height, 1
+    };
+    
+    vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        bloom->image, VK_IMAGE_LAYOUT_GENERAL, 1, &blit, VK_FILTER_LINEAR);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    
+    recordPass(graphics, commandBuffer, BLOOM_PASS_PREFILTER, 0, 0);
+    for (uint32_t i = 1; i < bloom->levelCount; ++i) {
+        recordPass(graphics, commandBuffer, BLOOM_PASS_DOWNSAMPLE, i, i - 1);
+    }
+    for (uint32_t i = bloom->levelCount - 1; i > 0; --i) {
+        recordPass(graphics, commandBuffer, BLOOM_PASS_UPSAMPLE, i - 1, i);
+    }
+    
+    // Note: Composite waits on pyramid and leaves image in output layout
+    recordComposite(graphics, commandBuffer, imageIndex);
+}
+
+void cleanupBloom(Graphics graphics)
+{
+    Bloom *bloom = graphics->bloom;
+    if (!bloom) {
+        return;
+    }
+    
+    cleanupPyramid(graphics);
+    for (uint32_t i = 0; i < BLOOM_PASS_COUNT; ++i) {
+        vkDestroyPipeline(graphics->device, bloom->pipelines[i], NULL);
+    }
+    vkDestroyPipeline(graphics->device, bloom->compositePipeline, NULL);
+    vkDestroyPipelineLayout(graphics->device, bloom->pipelineLayout, NULL);
+    vkDestroyRenderPass(graphics->device, bloom->renderPass, NULL);
+    vkDestroySampler(graphics->device, bloom->sampler, NULL);
+    // Note: Descriptor sets are freed along with their pool
+    vkDestroyDescriptorPool(graphics->device, bloom->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device, bloom->descriptorLayout, NULL);
+    
+    FREE_NULL(graphics->bloom);
+}
@@ -0,0 +1,354 @@
+#include "export.h"
+#include "vkutils.h"
+#include "trace.h"
+
+#include <string.h>
+
+// Convert captured frame (RGBA8 or BGRA8) into output format and write it
+static VkBool32 writeFrame(Exporter *exporter, const uint8_t *pixels)
+{
+    TRACE_SCOPE("write frame");
+    const size_t nPixels = (size_t)exporter->extent.width * exporter->extent.height;
+    // Channel offsets of red and blue within captured pixels
+    const size_t r = exporter->swizzle ? 2 : 0;
+    const size_t b = exporter->swizzle ? 0 : 2;
+    
+    if (exporter->format == EXPORT_FORMAT_RAW) {
+        if (!exporter->swizzle) {
+            return fwrite(pixels, 4, nPixels, exporter->stream) == nPixels;
+        }
+        
+        for (size_t i = 0; i < nPixels; ++i) {
+            exporter->scratch[4*i + 0] = pixels[4*i + r];
+            exporter->scratch[4*i + 1] = pixels[4*i + 1];
+            exporter->scratch[4*i + 2] = pixels[4*i + b];
+            exporter->scratch[4*i + 3] = pixels[4*i + 3];
+        }
+        return fwrite(exporter->scratch, 4, nPixels, exporter->stream) == nPixels;
+    }
+    
+    // YUV4MPEG2: Planar 4:4:4 using BT.601 limited range (Y4M default)
+    uint8_t *yPlane = exporter->scratch;
+    uint8_t *uPlane = yPlane + nPixels;
+    uint8_t *vPlane = uPlane + nPixels;
+    for (size_t i = 0; i < nPixels; ++i) {
+        const int32_t R = pixels[4*i + r];
+        const int32_t G = pixels[4*i + 1];
+        const int32_t B = pixels[4*i + b];
+        
+        yPlane[i] = (uint8_t)((( 66 * R + 129 * G +  25 * B + 128) >> 8) +  16);
+        uPlane[i] = (uint8_t)(((-38 * R -  74 * G + 112 * B + 128) >> 8) + 128);
+        vPlane[i] = (uint8_t)(((112 * R -  94 * G -  18 * B + 128) >> 8) + 128);
+    }
+    
+    if (fputs("FRAME\n", exporter->stream) == EOF) {
+        return VK_FALSE;
+    }
+    return fwrite(exporter->scratch, 3, nPixels, exporter->stream) == nPixels;
+}
+
+static void *writerThread(void *arg)
+{
+    Exporter *exporter = (Exporter *)arg;
+    traceSetThreadName("export writer");
+    
+    pthread_mutex_lock(&exporter->mutex);
+    for (;;) {
+        while (exporter->queueCount == 0 && !exporter->stop) {
+            pthread_cond_wait(&exporter->cond, &exporter->mutex);
+        }
+        if (exporter->queueCount == 0) {
+            break;  // stop requested and all captured frames written
+        }
+        
+        ExportSlot *slot = &exporter->slots[exporter->queue[exporter->queueHead]];
+        exporter->queueHead = (exporter->queueHead + 1) % exporter->slotCount;
+        exporter->queueCount--;
+        slot->state = EXPORT_SLOT_WRITING;
+        const VkBool32 skip = exporter->writeFailed;
+        
+        // Note: Conversion and I/O happen without holding the lock
+        pthread_mutex_unlock(&exporter->mutex);
+        const VkBool32 success = !skip && writeFrame(exporter, slot->mapped);
+        pthread_mutex_lock(&exporter->mutex);
+        
+        if (success) {
+            exporter->written++;
+        } else {
+            if (!exporter->writeFailed) {
+                fprintf(stderr, "Failed to write exported frame %llu, "
+                    "dropping remaining frames\n", (unsigned long long)slot->frame);
+            }
+            exporter->writeFailed = VK_TRUE;
+            exporter->dropped++;
+        }
+        slot->state = EXPORT_SLOT_FREE;
+        pthread_cond_broadcast(&exporter->cond);
+    }
+    pthread_mutex_unlock(&exporter->mutex);
+    
+    return NULL;
+}
+
+void initExporter(Graphics graphics, FILE *stream)
+{
+    assert(graphics && stream && "Expected non-NULL graphics handle and stream");
+    
+    Exporter *exporter = NULL;
+    CHK_ALLOC(exporter = calloc(1, sizeof(Exporter)));
+    graphics->exporter = exporter;
+    
+    exporter->stream = stream;
+    exporter->format = graphics->options.exportFormat;
+    exporter->extent = graphics->swapChainData.extent;
+    exporter->swizzle = graphics->swapChainData.format == VK_FORMAT_B8G8R8A8_SRGB ||
+                        graphics->swapChainData.format == VK_FORMAT_B8G8R8A8_UNORM;
+    exporter->frameSize = (VkDeviceSize)exporter->extent.width *
+        exporter->extent.height * 4;
+    exporter->slotCount = graphics->options.exportRingSize;
+    
+    CHK_ALLOC(exporter->slots = calloc(exporter->slotCount, sizeof(ExportSlot)));
+    CHK_ALLOC(exporter->queue = malloc(exporter->slotCount * sizeof(uint32_t)));
+    // Note: Y4M needs 3 bytes per pixel, raw output at most 4
+    CHK_ALLOC(exporter->scratch = malloc((size_t)exporter->frameSize));
+    
+    const VkMemoryPropertyFlags memProps =
+        readbackMemoryProperties(graphics->physicalDevice);
+    for (uint32_t i = 0; i < exporter->slotCount; ++i) {
+        ExportSlot *slot = &exporter->slots[i];
+        createBuffer(graphics->device, graphics->physicalDevice,
+            exporter->frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memProps,
+            &slot->buffer, &slot->memory, MEMORY_STAGING);
+        CHK_VK_ERR(vkMapMemory(graphics->device, slot->memory, 0,
+            exporter->frameSize, 0, &slot->mapped),
+            "Failed to map export readback buffer\n");
+        slot->state = EXPORT_SLOT_FREE;
+    }
+    
+    if (exporter->format == EXPORT_FORMAT_Y4M) {
+        fprintf(stream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+            exporter->extent.width, exporter->extent.height,
+            graphics->options.exportFps);
+    }
+    
+    pthread_mutex_init(&exporter->mutex, NULL);
+    pthread_cond_init(&exporter->cond, NULL);
+    if (pthread_create(&exporter->thread, NULL, writerThread, exporter) != 0) {
+        fprintf(stderr, "Failed to start export writer thread\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("Exporting %ux%u frames at %u fps (%u readback buffers)\n",
+        exporter->extent.width, exporter->extent.height,
+        graphics->options.exportFps, exporter->slotCount);
+}
+
+// Oldest captured frame whose copy has not been handed to the writer yet
+static ExportSlot *oldestPendingSlot(Exporter *exporter)
+{
+    ExportSlot *oldest = NULL;
+    for (uint32_t i = 0; i < exporter->slotCount; ++i) {
+        ExportSlot *slot = &exporter->slots[i];
+        if (slot->state == EXPORT_SLOT_PENDING &&
+            (!oldest || slot->frame < oldest->frame))
+        {
+            oldest = slot;
+        }
+    }
+    return oldest;
+}
+
+// Queue completed copies in frame order (requires exporter->mutex)
+static void queueCompletedSlots(Graphics graphics, VkFence frameFence)
+{
+    Exporter *exporter = graphics->exporter;
+    
+    ExportSlot *slot = NULL;
+    while ((slot = oldestPendingSlot(exporter))) {
+        // Note: Fences are polled, never waited on
+        if (slot->fence != frameFence &&
+            vkGetFenceStatus(graphics->device, slot->fence) != VK_SUCCESS)
+        {
+            break;  // keep frame order, later frames wait for this one
+        }
+        
+        const uint32_t tail = (exporter->queueHead + exporter->queueCount) %
+            exporter->slotCount;
+        exporter->queue[tail] = (uint32_t)(slot - exporter->slots);
+        exporter->queueCount++;
+        slot->state = EXPORT_SLOT_QUEUED;
+        pthread_cond_broadcast(&exporter->cond);
+    }
+}
+
+void exportPollFrames(Graphics graphics, VkFence frameFence)
+{
+    Exporter *exporter = graphics->exporter;
+    
+    pthread_mutex_lock(&exporter->mutex);
+    queueCompletedSlots(graphics, frameFence);
+    pthread_mutex_unlock(&exporter->mutex);
+}
+
+static ExportSlot *findFreeSlot(Exporter *exporter)
+{
+    for (uint32_t i = 0; i < exporter->slotCount; ++i) {
+        if (exporter->slots[i].state == EXPORT_SLOT_FREE) {
+            return &exporter->slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns free readback buffer, or NULL if frame is dropped
+static ExportSlot *acquireSlot(Graphics graphics)
+{
+    Exporter *exporter = graphics->exporter;
+    
+    pthread_mutex_lock(&exporter->mutex);
+    ExportSlot *slot = findFreeSlot(exporter);
+    
+    if (!slot && !exporter->writeFailed && !graphics->options.exportDropFrames) {
+        // Ring is full -> the only case in which rendering waits on the writer
+        TRACE_SCOPE("wait for export slot");
+        exporter->late++;
+        while (!(slot = findFreeSlot(exporter))) {
+            ExportSlot *pending = oldestPendingSlot(exporter);
+            if (pending) {
+                // Writer may be idle, waiting for copies still in flight
+                const VkFence fence = pending->fence;
+                pthread_mutex_unlock(&exporter->mutex);
+                CHK_VK_ERR(vkWaitForFences(graphics->device, 1, &fence,
+                    VK_TRUE, UINT64_MAX), "Failed to wait for export copy\n");
+                pthread_mutex_lock(&exporter->mutex);
+                queueCompletedSlots(graphics, fence);
+            } else {
+                pthread_cond_wait(&exporter->cond, &exporter->mutex);
+            }
+        }
+    }
+    
+    if (slot) {
+        slot->state = EXPORT_SLOT_PENDING;
+        slot->fence = graphics->sync.inFlightFences[graphics->currentFrame];
+        slot->frame = graphics->frameCounter;
+    } else {
+        exporter->dropped++;
+    }
+    pthread_mutex_unlock(&exporter->mutex);
+    
+    return slot;
+}
+
+void exportRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    Exporter *exporter = graphics->exporter;
+    
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    ExportSlot *slot = NULL;
+    if (extent.width != exporter->extent.width ||
+        extent.height != exporter->extent.height)
+    {
+        // Stream resolution is fixed (e.g. window was resized externally)
+        pthread_mutex_lock(&exporter->mutex);
+        exporter->dropped++;
+        pthread_mutex_unlock(&exporter->mutex);
+    } else {
+        slot = acquireSlot(graphics);
+    }
+    
+    const VkImage image = graphics->swapChainData.images[imageIndex];
+    // Layout left behind by render pass (see createRenderPass())
+    const VkImageLayout finalLayout = graphics->options.headless ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    
+    // Make copy visible to host once frame fence is signalled
+    // Note: Render graph waited for resolve and moved image to transfer
+    //       layout (see buildFrameGraph())
+    VkBufferMemoryBarrier bufferBarrier = {0};
+    if (slot) {
+        // Tightly packed copy of whole image
+        VkBufferImageCopy region = {0};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = (VkOffset3D) {0, 0, 0};
+        region.imageExtent = (VkExtent3D) {extent.width, extent.height, 1};
+        
+        vkCmdCopyImageToBuffer(commandBuffer, image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+        
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = slot->buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+    }
+    
+    // Return swapchain image to presentable layout, also if frame is dropped
+    VkImageMemoryBarrier imageBarrier = {0};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageBarrier.dstAccessMask = 0;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    imageBarrier.newLayout = finalLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+    // Note: Offscreen images already are in their final layout
+    const uint32_t bufferBarrierCount = slot ? 1 : 0;
+    const uint32_t imageBarrierCount = graphics->options.headless ? 0 : 1;
+    
+    if (bufferBarrierCount + imageBarrierCount > 0) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, NULL, bufferBarrierCount, &bufferBarrier,
+            imageBarrierCount, &imageBarrier);
+    }
+}
+
+void cleanupExporter(Graphics graphics)
+{
+    Exporter *exporter = graphics->exporter;
+    
+    // Device is idle -> every pending copy has completed
+    pthread_mutex_lock(&exporter->mutex);
+    queueCompletedSlots(graphics, VK_NULL_HANDLE);
+    exporter->stop = VK_TRUE;
+    pthread_cond_broadcast(&exporter->cond);
+    pthread_mutex_unlock(&exporter->mutex);
+    
+    pthread_join(exporter->thread, NULL);
+    pthread_cond_destroy(&exporter->cond);
+    pthread_mutex_destroy(&exporter->mutex);
+    
+    if (fclose(exporter->stream) != 0 && !exporter->writeFailed) {
+        fprintf(stderr, "Failed to finish export stream: %s\n", strerror(errno));
+    }
+    
+    fprintf(stderr, "Export: %llu frames written, %llu dropped, %llu late "
+        "(rendering waited on writer)\n", (unsigned long long)exporter->written,
+        (unsigned long long)exporter->dropped, (unsigned long long)exporter->late);
+    
+    for (uint32_t i = 0; i < exporter->slotCount; ++i) {
+        vkDestroyBuffer(graphics->device, exporter->slots[i].buffer, NULL);
+        freeMemory(graphics->device, exporter->slots[i].memory);
+    }
+    free(exporter->slots);
+    free(exporter->queue);
+    free(exporter->scratch);
+    FREE_NULL(graphics->exporter);
+}
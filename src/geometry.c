@@ -1,64 +1,151 @@
 #include "geometry.h"
 
-Star geomMakeStar(float cx, float cy, float d)
+#include <string.h>
+#include <assert.h>
+
+float geomStarInnerRatio(uint32_t points)
 {
-    const float s = GEOM_STAR_INV_PHI_SQ * d;  // interior pentagon distance
-    
-    // Note: Could use primitive topology TRIANGLE_FAN for star instead, since
-    //       all triangles share central vertex. 
-    //       This might not be supported however...
-    Star star = {0};
-    star.vertices[0]  = (Vertex) {cx, cy - d};
-    star.vertices[1]  = (Vertex) {cx - d * GEOM_STAR_SIN_72, cy - d * GEOM_STAR_COS_72};
-    star.vertices[2]  = (Vertex) {cx - d * GEOM_STAR_SIN_36, cy + d * GEOM_STAR_COS_36};
-    star.vertices[3]  = (Vertex) {cx + d * GEOM_STAR_SIN_36, cy + d * GEOM_STAR_COS_36};
-    star.vertices[4]  = (Vertex) {cx + d * GEOM_STAR_SIN_72, cy - d * GEOM_STAR_COS_72};
-    star.vertices[5]  = (Vertex) {cx - s * GEOM_STAR_SIN_36, cy - s * GEOM_STAR_COS_36};
-    star.vertices[6]  = (Vertex) {cx - s * GEOM_STAR_SIN_72, cy + s * GEOM_STAR_COS_72};
-    star.vertices[7]  = (Vertex) {cx, cy + s};
-    star.vertices[8]  = (Vertex) {cx + s * GEOM_STAR_SIN_72, cy + s * GEOM_STAR_COS_72};
-    star.vertices[9]  = (Vertex) {cx + s * GEOM_STAR_SIN_36, cy - s * GEOM_STAR_COS_36};
-    star.vertices[10] = (Vertex) {cx, cy};
-    
-    star.indices[0]  = 10;
-    star.indices[1]  = 5;
-    star.indices[2]  = 0;
-    
-    star.indices[3]  = 10;
-    star.indices[4]  = 1;
-    star.indices[5]  = 5;
-    
-    star.indices[6]  = 10;
-    star.indices[7]  = 6;
-    star.indices[8]  = 1;
-    
-    star.indices[9]  = 10;
-    star.indices[10] = 2;
-    star.indices[11] = 6;
-    
-    star.indices[12] = 10;
-    star.indices[13] = 7;
-    star.indices[14] = 2;
-    
-    star.indices[15] = 10;
-    star.indices[16] = 3;
-    star.indices[17] = 7;
-    
-    star.indices[18] = 10;
-    star.indices[19] = 8;
-    star.indices[20] = 3;
-    
-    star.indices[21] = 10;
-    star.indices[22] = 4;
-    star.indices[23] = 8;
-    
-    star.indices[24] = 10;
-    star.indices[25] = 9;
-    star.indices[26] = 4;
-    
-    star.indices[27] = 10;
-    star.indices[28] = 0;
-    star.indices[29] = 9;
+    if (points == 5) {
+        return GEOM_STAR_INV_PHI_SQ;  // = cos(72) / cos(36)
+    }
+    // Note: Degenerate for less than 5 tips (inner corners at/behind center)
+    if (points < 5) {
+        return 0.5f;
+    }
+    return cosf(2.0f * GLM_PIf / (float)points) / cosf(GLM_PIf / (float)points);
+}
+
+// Point at given angle and distance from center
+// Note: Angle 0 points upwards (negative y-axis) like tip 0 of star, front
+//       facing triangles are (center, larger angle, smaller angle)
+static void geomDirection(float angle, float radius, vec2 dest)
+{
+    dest[0] = -radius * sinf(angle);
+    dest[1] = -radius * cosf(angle);
+}
+
+static uint32_t geomAddVertex(ShapeArena *arena, ShapeKind shape, 
+    const vec2 vertex)
+{
+    assert(arena->vertexCount < GEOM_ARENA_MAX_VERTICES && "Arena too small");
+    glm_vec2_copy((float *)vertex, arena->vertices[arena->vertexCount++]);
+    // Note: Indices are relative to first vertex of shape
+    return arena->vertexCount - 1 - (uint32_t)arena->draws[shape].vertexOffset;
+}
+
+static void geomAddTriangle(ShapeArena *arena, uint32_t a, uint32_t b, 
+    uint32_t c)
+{
+    assert(arena->indexCount + 3 <= GEOM_ARENA_MAX_INDICES && "Arena too small");
+    arena->indices[arena->indexCount++] = (uint16_t)a;
+    arena->indices[arena->indexCount++] = (uint16_t)b;
+    arena->indices[arena->indexCount++] = (uint16_t)c;
+}
+
+// Triangle fan around center through given outline (in increasing angle)
+static void geomAddFan(ShapeArena *arena, ShapeKind shape, 
+    vec2 *outline, uint32_t count)
+{
+    const uint32_t center = geomAddVertex(arena, shape, (vec2){0.0f, 0.0f});
+    const uint32_t first = center + 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        geomAddVertex(arena, shape, outline[i]);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        geomAddTriangle(arena, center, first + (i + 1) % count, first + i);
+    }
+}
+
+static void geomAddPolygon(ShapeArena *arena)
+{
+    vec2 outline[GEOM_POLYGON_SIDES];
+    for (uint32_t i = 0; i < GEOM_POLYGON_SIDES; ++i) {
+        geomDirection(2.0f * GLM_PIf * (float)i / GEOM_POLYGON_SIDES, 1.0f, outline[i]);
+    }
+    geomAddFan(arena, SHAPE_POLYGON, outline, GEOM_POLYGON_SIDES);
+}
+
+static void geomAddRing(ShapeArena *arena)
+{
+    // Vertices alternate between outer (even) and inner (odd) rim
+    for (uint32_t i = 0; i < GEOM_RING_SEGMENTS; ++i) {
+        const float angle = 2.0f * GLM_PIf * (float)i / GEOM_RING_SEGMENTS;
+        vec2 vertex;
+        geomDirection(angle, 1.0f, vertex);
+        geomAddVertex(arena, SHAPE_RING, vertex);
+        geomDirection(angle, GEOM_RING_INNER_RATIO, vertex);
+        geomAddVertex(arena, SHAPE_RING, vertex);
+    }
+    for (uint32_t i = 0; i < GEOM_RING_SEGMENTS; ++i) {
+        const uint32_t outer = 2 * i;
+        const uint32_t inner = 2 * i + 1;
+        const uint32_t nextOuter = 2 * ((i + 1) % GEOM_RING_SEGMENTS);
+        const uint32_t nextInner = nextOuter + 1;
+        geomAddTriangle(arena, inner, nextInner, outer);
+        geomAddTriangle(arena, nextInner, nextOuter, outer);
+    }
+}
+
+static void geomAddComet(ShapeArena *arena)
+{
+    // Outline of convex hull of head and tail disk: farthest point of either
+    // disk in every direction
+    const float headY = GEOM_COMET_HEAD_RADIUS - 1.0f;
+    const float tailY = 1.0f - GEOM_COMET_TAIL_RADIUS;
+    vec2 outline[GEOM_COMET_SEGMENTS];
+    for (uint32_t i = 0; i < GEOM_COMET_SEGMENTS; ++i) {
+        vec2 direction;
+        geomDirection(2.0f * GLM_PIf * (float)i / GEOM_COMET_SEGMENTS, 1.0f, direction);
+        
+        const float head = direction[1] * headY + GEOM_COMET_HEAD_RADIUS;
+        const float tail = direction[1] * tailY + GEOM_COMET_TAIL_RADIUS;
+        const float radius = head >= tail ? GEOM_COMET_HEAD_RADIUS : GEOM_COMET_TAIL_RADIUS;
+        glm_vec2_scale(direction, radius, outline[i]);
+        outline[i][1] += head >= tail ? headY : tailY;
+    }
+    geomAddFan(arena, SHAPE_COMET, outline, GEOM_COMET_SEGMENTS);
+}
+
+void geomBuildShapes(ShapeArena *arena)
+{
+    assert(arena && "Expected non-NULL arena");
     
-    return star;
+    memset(arena, 0, sizeof(ShapeArena));
+    for (uint32_t shape = 0; shape < SHAPE_COUNT; ++shape) {
+        const uint32_t firstIndex = arena->indexCount;
+        arena->draws[shape].firstIndex = firstIndex;
+        arena->draws[shape].vertexOffset = (int32_t)arena->vertexCount;
+        
+        switch (shape) {
+            case SHAPE_STAR:
+                // Note: Vertex shader derives corners from vertex index
+                for (uint32_t i = 0; i < GEOM_STAR_VERTEX_COUNT(MAX_STAR_POINTS); ++i) {
+                    arena->indices[arena->indexCount++] = (uint16_t)i;
+                }
+                break;
+            case SHAPE_POLYGON:
+                geomAddPolygon(arena);
+                break;
+            case SHAPE_RING:
+                geomAddRing(arena);
+                break;
+            case SHAPE_COMET:
+                geomAddComet(arena);
+                break;
+        }
+        arena->draws[shape].indexCount = arena->indexCount - firstIndex;
+    }
+}
+
+ShapeKind geomShapeFromName(const char *name)
+{
+    static const char *const NAMES[SHAPE_COUNT] = {
+        "star", "polygon", "ring", "comet"
+    };
+    for (uint32_t shape = 0; shape < SHAPE_COUNT; ++shape) {
+        if (strcmp(name, NAMES[shape]) == 0) {
+            return (ShapeKind)shape;
+        }
+    }
+    return SHAPE_COUNT;
 }
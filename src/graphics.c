@@ -1,7 +1,20 @@
 #include "graphics.h"
+#include "vkutils.h"
+#include "export.h"
+#include "profiler.h"
+#include "tiles.h"
+#include "grid.h"
+#include "bloom.h"
+#include "sparks.h"
+#include "vkmemory.h"
+#include "probe.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "stream.h"
+#include "rendergraph.h"
 
 #include <string.h>
-#include <time.h>  // time()
+#include <ctype.h>  // isxdigit(), tolower()
 
 // Globals
 static const char *const VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
@@ -9,6 +22,21 @@ static const char *REQ_DEVICE_EXTENSIONS[] = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+#define BUCKET_LOCAL_SIZE 256  // invocations per work group of bucket.comp
+
+// Dispatches of bucket pass (see bucket.comp)
+typedef enum BucketPhase {
+    BUCKET_PHASE_COUNT,    // count particles of every shape per work group
+    BUCKET_PHASE_SCAN,     // prefix sum of work group counts
+    BUCKET_PHASE_SCATTER   // write particle indices behind prefix of counts
+} BucketPhase;
+
+// See BucketConstants in bucket.comp
+typedef struct BucketConstants {
+    uint32_t phase;
+    uint32_t firstInstance;  // drawIndirectFirstInstance supported
+} BucketConstants;
+
 // --- Start Helper functions
 // Allocate new string with same contents as src (NULL-terminated)
 static char *copyString(const char *src)
@@ -27,34 +55,16 @@ static uint32_t clampu32(uint32_t x, uint32_t min, uint32_t max)
     return x;
 }
 
-static char *readBinFile(const char *fileName, uint32_t *fileSize)
+// #work groups of count and scatter dispatches of bucket pass
+static uint32_t bucketGroupCount(uint32_t particleCount)
 {
-    FILE *fp = fopen(fileName, "rb");
-    if (!fp) {
-        fprintf(stderr, "Failed to open file: '%s'\n", fileName);
-        exit(EXIT_FAILURE);
-    }
-    
-    // Move to end of file
-    if (fseek(fp, 0, SEEK_END) != 0) {
-        fprintf(stderr, "fseek() error: %s\n", strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    *fileSize = (uint32_t) ftell(fp);
-    // Go back to beginning
-    rewind(fp);
-    // Allocate buffer containing file contents
-    char *bin = NULL;
-    CHK_ALLOC(bin = malloc(*fileSize * sizeof(char)));
-    // Read 
-    if (fread(bin, sizeof(char), *fileSize, fp) != *fileSize * sizeof(char)) {
-        fprintf(stderr, "Failed to read file: '%s'\n", fileName);
-        exit(EXIT_FAILURE);
-    }
-    // Cleanup
-    fclose(fp);
-    
-    return bin;
+    return (particleCount + BUCKET_LOCAL_SIZE - 1) / BUCKET_LOCAL_SIZE;
+}
+
+// Shape counts of every work group of bucket pass (see bucket.comp)
+static VkDeviceSize bucketCountsSize(uint32_t particleCount)
+{
+    return (VkDeviceSize)bucketGroupCount(particleCount) * SHAPE_COUNT * sizeof(uint32_t);
 }
 // --- End Helper functions
 
@@ -77,6 +87,31 @@ static void glfwKeyCallback(GLFWwindow *window, int key, int scancode,
         // Close window
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
+    if (action != GLFW_PRESS && action != GLFW_REPEAT) {
+        return;
+    }
+    // Reshape stars (applied with next frame, nothing to re-upload)
+    Options *options = &((Graphics) glfwGetWindowUserPointer(window))->options;
+    if (key == GLFW_KEY_UP && options->starPoints < MAX_STAR_POINTS) {
+        options->starPoints += 1;
+    } else if (key == GLFW_KEY_DOWN && options->starPoints > MIN_STAR_POINTS) {
+        options->starPoints -= 1;
+    } else if (key == GLFW_KEY_RIGHT) {
+        options->starSize *= 1.25f;
+    } else if (key == GLFW_KEY_LEFT) {
+        options->starSize /= 1.25f;
+    } else if (key == GLFW_KEY_T) {
+        // Cycle through auto, pipeline and tile rasterizer
+        options->rasterizer = (Rasterizer)((options->rasterizer + 1) %
+            (RASTERIZER_TILES + 1));
+    } else if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        // Pause/resume Morton reordering (see --reorder)
+        NeighborGrid *grid = ((Graphics) glfwGetWindowUserPointer(window))->grid;
+        grid->reorderPaused = !grid->reorderPaused;
+    } else if (key == GLFW_KEY_S && action == GLFW_PRESS && options->snapshotPath) {
+        // Save snapshot between frames (see --snapshot)
+        ((Graphics) glfwGetWindowUserPointer(window))->snapshotRequested = VK_TRUE;
+    }
 }
 
 static void framebufferResizeCallback(GLFWwindow *window, int width, int height)
@@ -147,9 +182,12 @@ static void initWindow(Graphics graphics)
     // Use minimum required version of 3.3
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Exported video stream has fixed resolution
+    glfwWindowHint(GLFW_RESIZABLE, 
+        graphics->options.exportPath ? GLFW_FALSE : GLFW_TRUE);
     // Create window
-    graphics->window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
-        "Fireworks", NULL, NULL);
+    graphics->window = glfwCreateWindow((int)graphics->options.width,
+        (int)graphics->options.height, "Fireworks", NULL, NULL);
     
     if (!graphics->window) {
         fprintf(stderr, "Failed to create window\n");
@@ -233,17 +271,23 @@ static void initInstance(Graphics graphics)
     
     uint32_t glfwExtensionCount = 0;
     const char **glfwExtensions = NULL;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    if (!glfwExtensions) {
-        fprintf(stderr, "Failed to get GLFW extension count\n");
-        exit(EXIT_FAILURE);
+    // Note: Headless rendering needs no surface (and hence no WSI) extensions
+    if (!graphics->options.headless) {
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        if (!glfwExtensions) {
+            fprintf(stderr, "Failed to get GLFW extension count\n");
+            exit(EXIT_FAILURE);
+        }
     }
     // Add also DEBUG extension
     uint32_t requiredExtensionCount = glfwExtensionCount;
     if (ENABLE_VALIDATION_LAYERS) requiredExtensionCount += 1;
     
     char **requiredExtensions = NULL;
-    CHK_ALLOC(requiredExtensions = malloc(requiredExtensionCount * sizeof(char *)));
+    // Note: Release builds in headless mode do not require any extension
+    if (requiredExtensionCount > 0) {
+        CHK_ALLOC(requiredExtensions = malloc(requiredExtensionCount * sizeof(char *)));
+    }
     for (uint32_t i = 0; i < glfwExtensionCount; ++i)  {
         requiredExtensions[i] = copyString(glfwExtensions[i]);
     }
@@ -269,7 +313,7 @@ static void initInstance(Graphics graphics)
         }
         
         if (!isFound) {
-            fprintf(stderr, "Required GLFW extension '%s' not supported\n",
+            fprintf(stderr, "Required instance extension '%s' not supported\n",
                 glfwExtension);
             exit(EXIT_FAILURE);
         }
@@ -353,13 +397,12 @@ static void cleanupSwapChainSupport(SwapChainSupport *details)
     details->presentCount = 0;
 }
 
-// Returns true if Vulkan implementation meets all requirements
+// Returns true if Vulkan implementation meets all requirements, sets reason
+// of rejection otherwise
 static VkBool32 isDeviceSuitable(Graphics graphics, VkPhysicalDevice device,
-    QueueFamilyIndices *indices, SwapChainSupport *swapChainSupport)
+    QueueFamilyIndices *indices, SwapChainSupport *swapChainSupport,
+    const char **reason)
 {    
-    VkPhysicalDeviceProperties deviceProps;
-    vkGetPhysicalDeviceProperties(device, &deviceProps);
-    
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
     
@@ -392,6 +435,10 @@ static VkBool32 isDeviceSuitable(Graphics graphics, VkPhysicalDevice device,
             foundGraphicsQueue = VK_TRUE;
         }
         
+        if (graphics->options.headless) {
+            continue;  // no surface to present to
+        }
+        
         VkBool32 supportsPresent = VK_FALSE;
         CHK_VK_ERR(vkGetPhysicalDeviceSurfaceSupportKHR(device, i,
             graphics->surface, &supportsPresent), 
@@ -409,10 +456,23 @@ static VkBool32 isDeviceSuitable(Graphics graphics, VkPhysicalDevice device,
     // Cleanup
     free(queueProps);
     
+    if (graphics->options.headless && foundGraphicsQueue) {
+        // Nothing is presented -> present queue is never used
+        indices->presentFamily = indices->graphicsFamily;
+        foundPresentQueue = VK_TRUE;
+    }
+    
     if (!foundGraphicsQueue || !foundPresentQueue) {
+        *reason = foundGraphicsQueue ? "no queue can present to surface" :
+            "no queue supports graphics and compute";
         return VK_FALSE;  // early termination
     }
     
+    if (graphics->options.headless) {
+        // Offscreen rendering requires neither swapchain nor surface support
+        return VK_TRUE;
+    }
+    
     // Check if required device extensions are supported
     uint32_t extensionCount = 0;
     CHK_VK_ERR(vkEnumerateDeviceExtensionProperties(device, NULL,
@@ -449,6 +509,7 @@ static VkBool32 isDeviceSuitable(Graphics graphics, VkPhysicalDevice device,
     free(deviceExtensions);
     
     if (!foundReqDevExt) {
+        *reason = "swapchain extension not supported";
         return VK_FALSE;  // early termination
     }
     
@@ -459,11 +520,10 @@ static VkBool32 isDeviceSuitable(Graphics graphics, VkPhysicalDevice device,
     if (swapChainSupport->formatCount == 0 ||
         swapChainSupport->presentCount == 0)
     {
+        *reason = "no surface format or present mode";
         return VK_FALSE;
     }
     
-    printf("Using device: %s\n", deviceProps.deviceName);
-    
     return VK_TRUE;
 }
 
@@ -485,8 +545,13 @@ static void setMsaaSamples(Graphics graphics)
     const uint32_t nSampleCounts = sizeof(sampleCounts) / sizeof(sampleCounts[0]);
     // Note: Does not consider depth buffer MSAA support
     const VkSampleCountFlags counts = props.limits.framebufferColorSampleCounts;
+    // Upper bound requested by user (0 -> no bound)
+    const uint32_t maxSamples = graphics->options.msaaSamples;
     // Pick highest supported sample count
     for (uint32_t i = 0; i < nSampleCounts; ++i) {
+        if (maxSamples > 0 && (uint32_t)sampleCounts[i] > maxSamples) {
+            continue;
+        }
         if  (counts & sampleCounts[i]) {
             graphics->msaaSamples = sampleCounts[i];
             return;
@@ -496,6 +561,131 @@ static void setMsaaSamples(Graphics graphics)
     assert(VK_FALSE && "Unreachable");
 }
 
+// Suitable physical device competing for selection
+typedef struct DeviceCandidate {
+    VkPhysicalDevice device;
+    uint32_t index;           // enumeration order (see --device)
+    QueueFamilyIndices indices;
+    SwapChainSupport swapChainSupport;
+    uint32_t typeRank;        // see deviceTypeRank()
+    VkDeviceSize heapSize;    // largest device-local heap
+    VkBool32 sharedQueue;     // graphics and present queue of same family
+    double probeRate;         // particle updates per second (0 -> not probed)
+} DeviceCandidate;
+
+// Preference of device type, higher is better
+static uint32_t deviceTypeRank(VkPhysicalDeviceType type)
+{
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static const char *deviceTypeName(VkPhysicalDeviceType type)
+{
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return "cpu";
+        default:
+            return "other";
+    }
+}
+
+// Write UUID as 8-4-4-4-12 hex digits
+static void formatUuid(const uint8_t uuid[VK_UUID_SIZE],
+    char text[2 * VK_UUID_SIZE + 5])
+{
+    char *out = text;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *out++ = '-';
+        }
+        out += sprintf(out, "%02x", uuid[i]);
+    }
+}
+
+// Returns true if selector spells out UUID as hex digits (dashes ignored)
+static VkBool32 matchesUuid(const char *selector, const uint8_t uuid[VK_UUID_SIZE])
+{
+    uint32_t digits = 0;
+    for (const char *c = selector; *c != '\0'; ++c) {
+        if (*c == '-') {
+            continue;
+        }
+        if (!isxdigit((unsigned char)*c) || digits == 2 * VK_UUID_SIZE) {
+            return VK_FALSE;
+        }
+        const uint8_t nibble = isdigit((unsigned char)*c) ?
+            (uint8_t)(*c - '0') : (uint8_t)(tolower((unsigned char)*c) - 'a' + 10);
+        const uint8_t byte = uuid[digits / 2];
+        if (nibble != (digits % 2 == 0 ? byte >> 4 : byte & 0xf)) {
+            return VK_FALSE;
+        }
+        digits++;
+    }
+    return digits == 2 * VK_UUID_SIZE;
+}
+
+// Returns true if device is selected by --device: UUID, enumeration index or
+// case-insensitive part of its name
+static VkBool32 deviceMatches(const char *selector, uint32_t index,
+    const char *name, const uint8_t uuid[VK_UUID_SIZE])
+{
+    if (matchesUuid(selector, uuid)) {
+        return VK_TRUE;
+    }
+    if (selector[strspn(selector, "0123456789")] == '\0') {
+        return strtoul(selector, NULL, 10) == index;
+    }
+    
+    const size_t length = strlen(selector);
+    for (; *name != '\0'; ++name) {
+        size_t i = 0;
+        while (i < length && name[i] != '\0' &&
+            tolower((unsigned char)name[i]) == tolower((unsigned char)selector[i]))
+        {
+            i++;
+        }
+        if (i == length) {
+            return VK_TRUE;
+        }
+    }
+    return VK_FALSE;
+}
+
+// Positive if a is preferred over b: probe results (if any) decide first,
+// then device type, device-local memory and queue layout
+static int compareCandidates(const DeviceCandidate *a, const DeviceCandidate *b)
+{
+    if (a->probeRate != b->probeRate) {
+        return a->probeRate > b->probeRate ? 1 : -1;
+    }
+    if (a->typeRank != b->typeRank) {
+        return a->typeRank > b->typeRank ? 1 : -1;
+    }
+    if (a->heapSize != b->heapSize) {
+        return a->heapSize > b->heapSize ? 1 : -1;
+    }
+    return (int)a->sharedQueue - (int)b->sharedQueue;
+}
+
+// Log every device with its score or reason of rejection, then pick best
+// suitable one (restricted to those matching --device)
 static void selectPhysicalDevice(Graphics graphics)
 {    
     uint32_t deviceCount = 0;
@@ -513,33 +703,129 @@ static void selectPhysicalDevice(Graphics graphics)
     CHK_VK_ERR(vkEnumeratePhysicalDevices(graphics->instance, &deviceCount,
         devices), "Failed to list physical devices\n");
     
-    // Initialize
-    graphics->physicalDevice = VK_NULL_HANDLE;
+    DeviceCandidate *candidates = NULL;
+    CHK_ALLOC(candidates = calloc(deviceCount, sizeof(DeviceCandidate)));
+    uint32_t candidateCount = 0;
     
-    QueueFamilyIndices indices;
-    SwapChainSupport details;
+    const char *selector = graphics->options.device;
+    VkBool32 selectorMatched = VK_FALSE;
     for (uint32_t i = 0; i < deviceCount; ++i) {
-        // Select first device that is suitable
-        if (isDeviceSuitable(graphics, devices[i], &indices, &details)) {
-            // Set physical device
-            graphics->physicalDevice = devices[i];
-            graphics->queueFamilies = indices;
-            graphics->swapChainSupport = details;  // copies buffer pointers
-            // Set #multi samples
-            setMsaaSamples(graphics);
-            break;
+        VkPhysicalDeviceIDProperties idProps = {0};
+        idProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 props = {0};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        props.pNext = &idProps;
+        vkGetPhysicalDeviceProperties2(devices[i], &props);
+        
+        char uuid[2 * VK_UUID_SIZE + 5];
+        formatUuid(idProps.deviceUUID, uuid);
+        printf("Device %u: %s (%s, %s)", i, props.properties.deviceName,
+            deviceTypeName(props.properties.deviceType), uuid);
+        
+        if (selector && !deviceMatches(selector, i,
+                props.properties.deviceName, idProps.deviceUUID))
+        {
+            printf(": skipped, not selected by --device\n");
+            continue;
         }
+        selectorMatched = VK_TRUE;
         
-        cleanupSwapChainSupport(&details);  // deallocate temporary buffers
+        DeviceCandidate candidate = {0};
+        const char *reason = NULL;
+        if (!isDeviceSuitable(graphics, devices[i], &candidate.indices,
+                &candidate.swapChainSupport, &reason))
+        {
+            printf(": rejected, %s\n", reason);
+            cleanupSwapChainSupport(&candidate.swapChainSupport);
+            continue;
+        }
+        candidate.device = devices[i];
+        candidate.index = i;
+        candidate.typeRank = deviceTypeRank(props.properties.deviceType);
+        candidate.heapSize = deviceLocalHeapSize(devices[i]);
+        candidate.sharedQueue =
+            candidate.indices.graphicsFamily == candidate.indices.presentFamily;
+        printf(": %llu MiB device-local, %s queue",
+            (unsigned long long)(candidate.heapSize >> 20),
+            candidate.sharedQueue ? "shared graphics/present" : "separate present");
+        if (graphics->options.deviceProbe) {
+            const uint32_t workgroupSize =
+                profileWorkgroupSize(&graphics->options, devices[i]);
+            candidate.probeRate = probeDevice(devices[i],
+                candidate.indices.graphicsFamily, workgroupSize);
+            printf(", probe %.1f M particle updates/s (work groups of %u)",
+                candidate.probeRate * 1e-6, workgroupSize);
+        }
+        printf("\n");
+        candidates[candidateCount++] = candidate;
     }
     
     // Cleanup
     free(devices);
     
-    if (graphics->physicalDevice == VK_NULL_HANDLE) {
-        fprintf(stderr, "Failed to find any suitable device (GPU)\n");
+    if (selector && !selectorMatched) {
+        fprintf(stderr, "No device matches '%s' (see --device)\n", selector);
+        exit(EXIT_FAILURE);
+    }
+    if (candidateCount == 0) {
+        fprintf(stderr, selector ? "Device selected by --device is not suitable\n" :
+            "Failed to find any suitable device (GPU)\n");
         exit(EXIT_FAILURE);
     }
+    
+    // Note: Ties keep enumeration order
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < candidateCount; ++i) {
+        if (compareCandidates(&candidates[i], &candidates[best]) > 0) {
+            best = i;
+        }
+    }
+    for (uint32_t i = 0; i < candidateCount; ++i) {
+        if (i != best) {
+            cleanupSwapChainSupport(&candidates[i].swapChainSupport);
+        }
+    }
+    
+    // Set physical device
+    const DeviceCandidate *chosen = &candidates[best];
+    graphics->physicalDevice = chosen->device;
+    vkGetPhysicalDeviceProperties(chosen->device, &graphics->deviceProperties);
+    graphics->queueFamilies = chosen->indices;
+    graphics->swapChainSupport = chosen->swapChainSupport;  // copies buffer pointers
+    // Fill options left to performance profile, then set #multi samples
+    profileApply(graphics);
+    setMsaaSamples(graphics);
+    
+    const char *why = candidateCount == 1 ?
+        (selector ? "selected by --device" : "only suitable device") :
+        (graphics->options.deviceProbe ? "fastest probe" : "highest score");
+    printf("Using device %u: %s (%s%s)\n", chosen->index,
+        graphics->deviceProperties.deviceName, why,
+        graphics->options.headless ? ", headless" : "");
+    
+    free(candidates);
+}
+
+// Dynamic rendering draws into image views without render pass and
+// framebuffer objects (see beginRendering()), unless --render-pass is given
+// Note: Extensions it depends on are core since Vulkan 1.2
+static VkBool32 dynamicRenderingSupported(Graphics graphics)
+{
+    if (graphics->options.renderPasses ||
+        graphics->deviceProperties.apiVersion < VK_API_VERSION_1_2 ||
+        !deviceExtensionSupported(graphics->physicalDevice,
+            VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+    {
+        return VK_FALSE;
+    }
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering = {0};
+    dynamicRendering.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features = {0};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRendering;
+    vkGetPhysicalDeviceFeatures2(graphics->physicalDevice, &features);
+    return dynamicRendering.dynamicRendering;
 }
 
 static void initLogicalDevice(Graphics graphics)
@@ -577,15 +863,59 @@ static void initLogicalDevice(Graphics graphics)
     VkPhysicalDeviceFeatures deviceFeatures = {0};
     // Note: Ignore for now
     //deviceFeatures.samplerAnisotropy = VK_TRUE;
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(graphics->physicalDevice, &supportedFeatures);
+    // Optional: Invocation counts of render pass (see profiler.c)
+    deviceFeatures.pipelineStatisticsQuery = 
+        supportedFeatures.pipelineStatisticsQuery;
+    // Optional: Point sprites larger than 1 pixel (see selectStarLod)
+    deviceFeatures.largePoints = supportedFeatures.largePoints;
+    // Optional: All shapes in a single indirect draw (see recordCommandBuffer)
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = 
+        supportedFeatures.drawIndirectFirstInstance;
+    graphics->deviceFeatures = deviceFeatures;
     
     VkDeviceCreateInfo deviceInfo = {0};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceInfo.queueCreateInfoCount = uniqueQueueCount;
     deviceInfo.pQueueCreateInfos = queueCreateInfos;
     deviceInfo.pEnabledFeatures = &deviceFeatures;
-    deviceInfo.enabledExtensionCount = 
-        sizeof(REQ_DEVICE_EXTENSIONS) / sizeof(REQ_DEVICE_EXTENSIONS[0]);
-    deviceInfo.ppEnabledExtensionNames = REQ_DEVICE_EXTENSIONS;
+    
+    const uint32_t nReqs = sizeof(REQ_DEVICE_EXTENSIONS) / sizeof(REQ_DEVICE_EXTENSIONS[0]);
+    const char *extensions[sizeof(REQ_DEVICE_EXTENSIONS) / sizeof(REQ_DEVICE_EXTENSIONS[0]) + 3];
+    uint32_t extensionCount = 0;
+    // Note: Swapchain extension is only required for presenting to a surface
+    if (!graphics->options.headless) {
+        for (uint32_t i = 0; i < nReqs; ++i) {
+            extensions[extensionCount++] = REQ_DEVICE_EXTENSIONS[i];
+        }
+    }
+    // Optional: Correlate GPU timestamps with CPU clock when tracing
+    graphics->calibratedTimestamps = traceActive &&
+        deviceExtensionSupported(graphics->physicalDevice,
+            VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    if (graphics->calibratedTimestamps) {
+        extensions[extensionCount++] = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+    }
+    // Optional: Usage and budget of memory heaps (see vkmemory.c)
+    graphics->memoryBudget = deviceExtensionSupported(graphics->physicalDevice,
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (graphics->memoryBudget) {
+        extensions[extensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+    // Optional: Render without render pass and framebuffer objects
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {0};
+    dynamicRenderingFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    graphics->dynamicRendering = dynamicRenderingSupported(graphics);
+    if (graphics->dynamicRendering) {
+        extensions[extensionCount++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        deviceInfo.pNext = &dynamicRenderingFeatures;
+    }
+    deviceInfo.enabledExtensionCount = extensionCount;
+    deviceInfo.ppEnabledExtensionNames = extensions;
     
     if (ENABLE_VALIDATION_LAYERS) {
         // For backwards compatibility set also validation layers here
@@ -608,94 +938,55 @@ static void initLogicalDevice(Graphics graphics)
         0, &graphics->computeQueue);
     vkGetDeviceQueue(graphics->device, graphics->queueFamilies.presentFamily,
         0, &graphics->presentQueue);
+    
+    if (graphics->dynamicRendering) {
+        graphics->cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)
+            vkGetDeviceProcAddr(graphics->device, "vkCmdBeginRenderingKHR");
+        graphics->cmdEndRendering = (PFN_vkCmdEndRenderingKHR)
+            vkGetDeviceProcAddr(graphics->device, "vkCmdEndRenderingKHR");
+    }
 }
 
-static VkImageView createImageView(VkImage image, VkFormat format, 
-    VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkDevice device)
+// Trails accumulate frames in color image instead of clearing it
+static VkBool32 trailsEnabled(Graphics graphics)
 {
-    VkImageView imageView;
-    
-    VkImageViewCreateInfo viewInfo = {0};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = image;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = format;
-    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.subresourceRange.aspectMask = aspectFlags;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = mipLevels;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-    
-    CHK_VK_ERR(vkCreateImageView(device, &viewInfo, NULL, 
-        &imageView), "Failed to create image view\n");
-    
-    return imageView;
+    return graphics->options.trailDecay > 0.0f;
 }
 
-static uint32_t findMemoryType(uint32_t typeFilter, 
-    VkMemoryPropertyFlags props, VkPhysicalDevice physicalDevice)
+// Single sampled trails are copied to swapchain image instead of resolved
+static VkBool32 trailsCopied(Graphics graphics)
 {
-    VkPhysicalDeviceMemoryProperties memProps;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
-    
-    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
-        if ((typeFilter & (1 << i)) &&
-            (memProps.memoryTypes[i].propertyFlags & props) == props)
-        {
-            return i;
-        }
-    }
-    
-    fprintf(stderr, "Failed to find requested memory type\n");
-    exit(EXIT_FAILURE);
+    return trailsEnabled(graphics) && graphics->msaaSamples == VK_SAMPLE_COUNT_1_BIT;
 }
 
-static void createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
-    VkSampleCountFlagBits nSamples, VkFormat format, VkImageTiling tiling,
-    VkImageUsageFlags usage, VkMemoryPropertyFlags props, 
-    VkImage *image, VkDeviceMemory *imageMemory, VkDevice device, 
-    VkPhysicalDevice physicalDevice)
+// Create multisampled color image, depends on swapchain format and extent
+static void createColorResource(Graphics graphics)
 {
-    VkImageCreateInfo imageInfo = {0};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.format = format;
-    imageInfo.extent.width = width;
-    imageInfo.extent.height = height;
-    imageInfo.extent.depth = 1;  // 3D extent
-    imageInfo.mipLevels = mipLevels;
-    imageInfo.arrayLayers = 1;
-    imageInfo.samples = nSamples;  // #samples per pixel (multisampling)
-    imageInfo.tiling = tiling;
-    imageInfo.usage = usage;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    
-    CHK_VK_ERR(vkCreateImage(device, &imageInfo, NULL, image),
-        "Failed to create image\n");
-    
-    // Get memory requirements of image
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, *image, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo = {0};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        memRequirements.memoryTypeBits, props, physicalDevice
-    );
-    
-    // Allocate image memory
-    CHK_VK_ERR(vkAllocateMemory(device, &allocInfo, NULL, imageMemory),
-        "Failed to allocate image memory\n");
+    graphics->swapChainData.colorCleared = VK_FALSE;
+    if (graphics->msaaSamples == VK_SAMPLE_COUNT_1_BIT && !trailsEnabled(graphics)) {
+        // Render directly into swapchain image, nothing to resolve
+        graphics->swapChainData.colorResource = (ImageResource) {0};
+        return;
+    }
+    // Create color image for MSAA resolved to swapchain image
+    // Note: Trails keep contents across frames, which are cleared by transfer
+    //       and copied out without MSAA
+    const VkImageUsageFlags usage = trailsEnabled(graphics) ?
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT :
+        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    createImage(graphics->swapChainData.extent.width, 
+        graphics->swapChainData.extent.height, 1, graphics->msaaSamples, 
+        graphics->swapChainData.format, VK_IMAGE_TILING_OPTIMAL,
+        usage | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+        &graphics->swapChainData.colorResource.image, 
+        &graphics->swapChainData.colorResource.memory,
+        graphics->device, graphics->physicalDevice, MEMORY_ATTACHMENTS);
     
-    // Bind device memory to image
-    CHK_VK_ERR(vkBindImageMemory(device, *image, *imageMemory, 0),
-        "Failed to bind device memory to image\n");
+    graphics->swapChainData.colorResource.view = createImageView(
+        graphics->swapChainData.colorResource.image,
+        graphics->swapChainData.format,
+        VK_IMAGE_ASPECT_COLOR_BIT, 1, graphics->device);
 }
 
 static void createSwapChain(Graphics graphics)
@@ -763,6 +1054,29 @@ static void createSwapChain(Graphics graphics)
     createInfo.imageExtent = swapExtent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (graphics->options.exportPath) {
+        // Exported frames are copied from swapchain images
+        if (!(support.capabilities.supportedUsageFlags & 
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) 
+        {
+            fprintf(stderr, "Swapchain images cannot be copied for export, "
+                "use --headless instead\n");
+            exit(EXIT_FAILURE);
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    // Bloom downscales rendered swapchain images by blit (see bloom.c)
+    if (support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    // Tile rasterizer copies its pixels into swapchain images (see tiles.c)
+    if (support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    } else if (trailsCopied(graphics)) {
+        fprintf(stderr, "Swapchain images cannot be copied to for trails, "
+            "use --msaa instead\n");
+        exit(EXIT_FAILURE);
+    }
     
     const uint32_t queueFamilyIndices[] = {
         graphics->queueFamilies.graphicsFamily,
@@ -817,28 +1131,57 @@ static void createSwapChain(Graphics graphics)
         );
     }
     
-    // Create color image for MSAA resolved to swapchain image
-    createImage(graphics->swapChainData.extent.width, 
-        graphics->swapChainData.extent.height, 1, graphics->msaaSamples, 
-        graphics->swapChainData.format, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
-        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-        &graphics->swapChainData.colorResource.image, 
-        &graphics->swapChainData.colorResource.memory,
-        graphics->device, graphics->physicalDevice);
+    createColorResource(graphics);
+}
+
+// Create offscreen render targets replacing swapchain images in headless mode
+static void createOffscreenImages(Graphics graphics)
+{
+    SwapChainData *data = &graphics->swapChainData;
+    // One image per frame in flight suffices (no presentation engine involved)
+    data->swapChain = VK_NULL_HANDLE;
+    data->imageCount = MAX_FRAMES_IN_FLIGHT;
+    // Note: RGBA byte order allows frames to be read back without swizzling
+    data->format = VK_FORMAT_R8G8B8A8_SRGB;
+    data->extent = (VkExtent2D) {
+        graphics->options.width, graphics->options.height
+    };
+    const uint32_t maxDimension = graphics->deviceProperties.limits.maxImageDimension2D;
+    if (data->extent.width > maxDimension || data->extent.height > maxDimension) {
+        fprintf(stderr, "Image size %ux%u exceeds device limit of %u\n",
+            data->extent.width, data->extent.height, maxDimension);
+        exit(EXIT_FAILURE);
+    }
     
-    graphics->swapChainData.colorResource.view = createImageView(
-        graphics->swapChainData.colorResource.image,
-        graphics->swapChainData.format,
-        VK_IMAGE_ASPECT_COLOR_BIT, 1, graphics->device);
+    CHK_ALLOC(data->images = malloc(data->imageCount * sizeof(VkImage)));
+    CHK_ALLOC(data->imageMemories = 
+        malloc(data->imageCount * sizeof(VkDeviceMemory)));
+    CHK_ALLOC(data->imageViews = malloc(data->imageCount * sizeof(VkImageView)));
+    
+    for (uint32_t i = 0; i < data->imageCount; ++i) {
+        // Resolve target of render pass (or copy target of tile rasterizer),
+        // may be copied from afterwards
+        createImage(data->extent.width, data->extent.height, 1,
+            VK_SAMPLE_COUNT_1_BIT, data->format, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &data->images[i], &data->imageMemories[i],
+            graphics->device, graphics->physicalDevice, MEMORY_ATTACHMENTS);
+        
+        data->imageViews[i] = createImageView(data->images[i], data->format,
+            VK_IMAGE_ASPECT_COLOR_BIT, 1, graphics->device);
+    }
+    
+    createColorResource(graphics);
 }
 
 static void cleanupImage(VkDevice device, ImageResource resource)
 {
     vkDestroyImageView(device, resource.view, NULL);
     vkDestroyImage(device, resource.image, NULL);
-    vkFreeMemory(device, resource.memory, NULL);
+    freeMemory(device, resource.memory);
 }
 
 static void cleanupSwapChain(Graphics graphics)
@@ -848,18 +1191,32 @@ static void cleanupSwapChain(Graphics graphics)
     
     // Destroy all image views
     for (uint32_t i = 0; i < graphics->swapChainData.imageCount; ++i) {
-        // Destroy framebuffers
-        vkDestroyFramebuffer(graphics->device, 
-            graphics->swapChainData.frameBuffers[i], NULL);
+        // Destroy framebuffers (none with dynamic rendering)
+        if (graphics->swapChainData.frameBuffers) {
+            vkDestroyFramebuffer(graphics->device, 
+                graphics->swapChainData.frameBuffers[i], NULL);
+        }
         // Destroy swapchain image views
         vkDestroyImageView(graphics->device, 
             graphics->swapChainData.imageViews[i], NULL);
     }
-    // Cleanup swapchain object
-    vkDestroySwapchainKHR(graphics->device, graphics->swapChainData.swapChain, NULL);
-    // Deallocate buffers detailing swap chain support
-    cleanupSwapChainSupport(&graphics->swapChainSupport);
+    
+    if (graphics->options.headless) {
+        // Offscreen images are owned by application (unlike swapchain images)
+        for (uint32_t i = 0; i < graphics->swapChainData.imageCount; ++i) {
+            vkDestroyImage(graphics->device, 
+                graphics->swapChainData.images[i], NULL);
+            freeMemory(graphics->device, 
+                graphics->swapChainData.imageMemories[i]);
+        }
+    } else {
+        // Cleanup swapchain object
+        vkDestroySwapchainKHR(graphics->device, graphics->swapChainData.swapChain, NULL);
+        // Deallocate buffers detailing swap chain support
+        cleanupSwapChainSupport(&graphics->swapChainSupport);
+    }
     FREE_NULL(graphics->swapChainData.images);
+    FREE_NULL(graphics->swapChainData.imageMemories);
     FREE_NULL(graphics->swapChainData.imageViews);
     FREE_NULL(graphics->swapChainData.frameBuffers);
     graphics->swapChainData.imageCount = 0;
@@ -867,19 +1224,36 @@ static void cleanupSwapChain(Graphics graphics)
 
 static void createRenderPass(Graphics graphics)
 {
+    // Without multisampling the swapchain image is rendered to directly
+    const VkBool32 resolve = graphics->msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+    // Trails are drawn over previous frames and copied out without MSAA
+    const VkBool32 trails = trailsEnabled(graphics);
+    // Optimal layout for presenting contents to surface, or for reading them
+    // back in case of offscreen rendering
+    const VkImageLayout outputLayout = graphics->options.headless ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    
     VkAttachmentDescription colorAttachment = {0};
     colorAttachment.format = graphics->swapChainData.format;
     colorAttachment.samples = graphics->msaaSamples;  // multisampled
-    // Clear color framebuffer to black before next frame
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // Clear color framebuffer to black before next frame (unless fading it)
+    colorAttachment.loadOp = trails ?
+        VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
     // Store results in framebuffer for rendering
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     // No stencil buffer
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     // Initial and final layout of color framebuffer
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    // Note: Trails are cleared once (see clearTrails())
+    colorAttachment.initialLayout = trails ?
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    if (resolve) {
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    } else {
+        colorAttachment.finalLayout = trails ?
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : outputLayout;
+    }
     
     VkAttachmentReference colorAttachmentRef = {0};
     colorAttachmentRef.attachment = 0;  // index in VkRenderPassCreateInfo.pAttachments
@@ -895,8 +1269,7 @@ static void createRenderPass(Graphics graphics)
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    // Optimal layout for presenting contents to surface
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachmentResolve.finalLayout = outputLayout;
     
     VkAttachmentReference colorAttachmentResolveRef = {0};
     colorAttachmentResolveRef.attachment = 1;  // index in VkRenderPassCreateInfo.pAttachments
@@ -908,18 +1281,20 @@ static void createRenderPass(Graphics graphics)
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
+    subpass.pResolveAttachments = resolve ? &colorAttachmentResolveRef : NULL;
     
     VkSubpassDependency dependency = {0};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
     // Operations to wait on before writing to color framebuffer
+    // Note: Trails load what previous frame wrote
     dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
+    dependency.srcAccessMask = trails ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        (trails ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
     
     // Create render pass
     VkAttachmentDescription attachments[] = {
@@ -929,7 +1304,7 @@ static void createRenderPass(Graphics graphics)
     
     VkRenderPassCreateInfo createInfo = {0};
     createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    createInfo.attachmentCount = 2;  // see attachments array
+    createInfo.attachmentCount = resolve ? 2 : 1;  // see attachments array
     createInfo.pAttachments = attachments;
     createInfo.subpassCount = 1;
     createInfo.pSubpasses = &subpass;
@@ -940,21 +1315,6 @@ static void createRenderPass(Graphics graphics)
         &graphics->renderPass), "Failed to create render pass");
 }
 
-static VkShaderModule createShaderModule(VkDevice device, 
-    const char *code, uint32_t codeSize)
-{
-    VkShaderModuleCreateInfo createInfo = {0};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = codeSize;
-    createInfo.pCode = (const uint32_t *)code;
-    
-    VkShaderModule shaderModule;
-    CHK_VK_ERR(vkCreateShaderModule(device, &createInfo, NULL, 
-        &shaderModule), "Failed to create shader module\n");
-        
-    return shaderModule;
-}
-
 // Depends on renderPass
 static void createFramebuffers(Graphics graphics)
 {
@@ -969,12 +1329,16 @@ static void createFramebuffers(Graphics graphics)
             graphics->swapChainData.colorResource.view,
             graphics->swapChainData.imageViews[i]
         }; 
+        // Single sample -> swapchain image is the only attachment (or the
+        // accumulated trails, copied to it afterwards)
+        const VkBool32 resolve = graphics->msaaSamples != VK_SAMPLE_COUNT_1_BIT;
         
         VkFramebufferCreateInfo createInfo = {0};
         createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         createInfo.renderPass = graphics->renderPass;
-        createInfo.attachmentCount = 2;
-        createInfo.pAttachments = attachments;
+        createInfo.attachmentCount = resolve ? 2 : 1;
+        createInfo.pAttachments = resolve || trailsEnabled(graphics) ?
+            attachments : &attachments[1];
         // Framebuffer dimensions
         createInfo.width = graphics->swapChainData.extent.width;
         createInfo.height = graphics->swapChainData.extent.height;
@@ -1004,65 +1368,104 @@ static void recreateSwapChain(Graphics graphics)
     fillSwapChainSupport(graphics, graphics->physicalDevice, 
         &graphics->swapChainSupport);
     createSwapChain(graphics);
-    createFramebuffers(graphics);
+    if (!graphics->dynamicRendering) {
+        createFramebuffers(graphics);
+    }
+    tilesResize(graphics);
+    if (graphics->bloom) {
+        bloomResize(graphics);
+    }
 }
 
 static void createDescriptorResources(Graphics graphics)
 {
     // - Create descriptor set layout
-    VkDescriptorSetLayoutBinding layoutBindingVertex = {0};
-    layoutBindingVertex.binding = 0;  // see binding in vertex shader
-    layoutBindingVertex.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    layoutBindingVertex.descriptorCount = 1;
-    layoutBindingVertex.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutBinding layoutBindingsVertex[5] = {0};
+    layoutBindingsVertex[0].binding = 0;  // see binding in vertex shader
+    layoutBindingsVertex[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layoutBindingsVertex[0].descriptorCount = 1;
+    // Note: Fragment shader evaluates star outline for SDF geometry
+    layoutBindingsVertex[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT |
+        VK_SHADER_STAGE_FRAGMENT_BIT;
+    
+    // Note: Particles are pulled from storage buffer (no vertex attributes)
+    layoutBindingsVertex[1].binding = 1;  // see binding in vertex shader
+    layoutBindingsVertex[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    layoutBindingsVertex[1].descriptorCount = 1;
+    layoutBindingsVertex[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    
+    // Shape arena vertices, particle indices bucketed by shape and their
+    // indirect draws
+    for (uint32_t i = 2; i < 5; ++i) {
+        layoutBindingsVertex[i].binding = i;  // see binding in vertex shader
+        layoutBindingsVertex[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindingsVertex[i].descriptorCount = 1;
+        layoutBindingsVertex[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    }
     
     VkDescriptorSetLayoutCreateInfo layoutInfoVertex = {0};
     layoutInfoVertex.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfoVertex.bindingCount = 1;
-    layoutInfoVertex.pBindings = &layoutBindingVertex;
+    layoutInfoVertex.bindingCount = 5;
+    layoutInfoVertex.pBindings = layoutBindingsVertex;
     
     CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfoVertex,
         NULL, &graphics->vertexDescriptor.layout),
         "Failed to create descriptor set layout\n");
         
-    VkDescriptorSetLayoutBinding layoutBindingsCompute[3] = {0};
-    layoutBindingsCompute[0].binding = 0;  // see binding in compute shader
-    layoutBindingsCompute[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    layoutBindingsCompute[0].descriptorCount = 1;
-    layoutBindingsCompute[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    
-    layoutBindingsCompute[1].binding = 1;  // see binding in compute shader
-    layoutBindingsCompute[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    layoutBindingsCompute[1].descriptorCount = 1;
-    layoutBindingsCompute[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    
-    layoutBindingsCompute[2].binding = 2;  // see binding in compute shader
-    layoutBindingsCompute[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    layoutBindingsCompute[2].descriptorCount = 1;
-    layoutBindingsCompute[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    // Parameters, input/output particles (see shader.comp) and neighbor grid
+    // (see grid.comp)
+    VkDescriptorSetLayoutBinding layoutBindingsCompute[COMPUTE_BINDING_COUNT] = {0};
+    for (uint32_t i = 0; i < COMPUTE_BINDING_COUNT; ++i) {
+        layoutBindingsCompute[i].binding = i;  // see binding in compute shader
+        layoutBindingsCompute[i].descriptorType = i == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindingsCompute[i].descriptorCount = 1;
+        layoutBindingsCompute[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
     
     VkDescriptorSetLayoutCreateInfo layoutInfoCompute = {0};
     layoutInfoCompute.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfoCompute.bindingCount = 3;
+    layoutInfoCompute.bindingCount = COMPUTE_BINDING_COUNT;
     layoutInfoCompute.pBindings = layoutBindingsCompute;
     
     CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfoCompute,
         NULL, &graphics->computeDescriptor.layout),
         "Failed to create descriptor set layout\n");
         
+    // Parameters, particles, draw commands and instances (see bucket.comp)
+    VkDescriptorSetLayoutBinding layoutBindingsBucket[4] = {0};
+    for (uint32_t i = 0; i < 4; ++i) {
+        layoutBindingsBucket[i].binding = i;  // see binding in bucket shader
+        layoutBindingsBucket[i].descriptorType = i == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindingsBucket[i].descriptorCount = 1;
+        layoutBindingsBucket[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfoBucket = {0};
+    layoutInfoBucket.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfoBucket.bindingCount = 4;
+    layoutInfoBucket.pBindings = layoutBindingsBucket;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfoBucket,
+        NULL, &graphics->bucketDescriptor.layout),
+        "Failed to create descriptor set layout\n");
+    
     // - Create descriptor pool
     VkDescriptorPoolSize poolSizes[2] = {0};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * 2;
+    poolSizes[0].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * 3;
     
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolSizes[1].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * 2;
+    // Note: Vertex (4), compute and bucket (3) sets
+    poolSizes[1].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT *
+        (4 + (COMPUTE_BINDING_COUNT - 1) + 3);
     
     VkDescriptorPoolCreateInfo poolInfo = {0};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = 2;
     poolInfo.pPoolSizes = poolSizes;
-    poolInfo.maxSets = (uint32_t)MAX_FRAMES_IN_FLIGHT * 2;
+    poolInfo.maxSets = (uint32_t)MAX_FRAMES_IN_FLIGHT * 3;
     
     CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
         &graphics->descriptorPool),
@@ -1095,6 +1498,15 @@ static void createDescriptorResources(Graphics graphics)
     CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfoCompute,
         graphics->computeDescriptor.sets),
         "Failed to allocate compute descriptor sets\n");
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        layouts[i] = graphics->bucketDescriptor.layout;
+    }
+    allocInfoCompute.pSetLayouts = layouts;
+    
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfoCompute,
+        graphics->bucketDescriptor.sets),
+        "Failed to allocate bucket descriptor sets\n");
 }
 
 static void cleanupDescriptorResources(Graphics graphics)
@@ -1107,6 +1519,8 @@ static void cleanupDescriptorResources(Graphics graphics)
         graphics->vertexDescriptor.layout, NULL);
     vkDestroyDescriptorSetLayout(graphics->device,
         graphics->computeDescriptor.layout, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device,
+        graphics->bucketDescriptor.layout, NULL);
 }
 
 static void createGraphicsPipeline(Graphics graphics)
@@ -1115,6 +1529,8 @@ static void createGraphicsPipeline(Graphics graphics)
     char *vertShaderSource = readBinFile("shaders/bin/vert.spv", &vertShaderSize);
     char *compShaderSource = readBinFile("shaders/bin/comp.spv", &compShaderSize);
     char *fragShaderSource = readBinFile("shaders/bin/frag.spv", &fragShaderSize);
+    uint32_t bucketShaderSize = 0;
+    char *bucketShaderSource = readBinFile("shaders/bin/bucket.spv", &bucketShaderSize);
     
     // - Initialize shader modules
     VkShaderModule vertShaderModule = createShaderModule(
@@ -1123,6 +1539,8 @@ static void createGraphicsPipeline(Graphics graphics)
         graphics->device, compShaderSource, compShaderSize);
     VkShaderModule fragShaderModule = createShaderModule(
         graphics->device, fragShaderSource, fragShaderSize);
+    VkShaderModule bucketShaderModule = createShaderModule(
+        graphics->device, bucketShaderSource, bucketShaderSize);
     
     // - Assign shader modules to respective graphics pipeline stages
     VkPipelineShaderStageCreateInfo vertShaderInfo = {0};
@@ -1143,55 +1561,21 @@ static void createGraphicsPipeline(Graphics graphics)
     fragShaderInfo.module = fragShaderModule;
     fragShaderInfo.pName = "main";  // entry point of shader code
     
-    const VkPipelineShaderStageCreateInfo shaderInfos[] = {
+    VkPipelineShaderStageCreateInfo shaderInfos[] = {
         vertShaderInfo,
         fragShaderInfo
     };
     
-    // - Initialize vertex input binding and attribute descriptions
-    VkVertexInputBindingDescription bindingDescriptions[2] = {0};
-    bindingDescriptions[0].binding = 0;  // index (only 1 binding)
-    bindingDescriptions[0].stride = sizeof(Vertex);
-    // Attribute addressing using vertex index (as opposed to instance index)
-    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    
-    bindingDescriptions[1].binding = 1;
-    bindingDescriptions[1].stride = sizeof(Particle);
-    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-    
-    // See Vertex and Particle structure in graphics.h 
-    VkVertexInputAttributeDescription attributeDescriptions[4] = {0};
-    // Vertex.pos (vec2 -> r32g32)
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, pos);
-    // Particle.col (vec4 -> r32g32b32a32)
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].binding = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Particle, color);
-    // Particle.pos (vec2 -> r32g32)
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].binding = 1;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Particle, position);
-    // Particle.orientation (float)
-    attributeDescriptions[3].location = 3;
-    attributeDescriptions[3].binding = 1;
-    attributeDescriptions[3].format = VK_FORMAT_R32_SFLOAT;
-    attributeDescriptions[3].offset = offsetof(Particle, orientation);
-    
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {0};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 2;
-    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
-    vertexInputInfo.vertexAttributeDescriptionCount = 4;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions;
+    // Note: No vertex input, star outline is derived from vertex index and
+    //       particles are read from storage buffer (see shader.vert)
+    vertexInputInfo.vertexBindingDescriptionCount = 0;
+    vertexInputInfo.vertexAttributeDescriptionCount = 0;
     
     VkPipelineInputAssemblyStateCreateInfo pipelineAssemblyInfo = {0};
     pipelineAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    // Geometry drawn from list of triangles
+    // Geometry drawn from list of triangles (points for STAR_LOD_POINT)
     pipelineAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     // Only applies to _STRIP topologies
     pipelineAssemblyInfo.primitiveRestartEnable = VK_FALSE;
@@ -1274,8 +1658,13 @@ static void createGraphicsPipeline(Graphics graphics)
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &graphics->vertexDescriptor.layout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = NULL;
+    // Shape offsetting bucketed instances (see recordRenderPass)
+    VkPushConstantRange pushConstantRange = {0};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     
     CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, 
         &pipelineLayoutInfo, NULL, &graphics->pipelineLayout), 
@@ -1295,15 +1684,37 @@ static void createGraphicsPipeline(Graphics graphics)
     pipelineInfo.pColorBlendState = &colorBlendInfo;
     pipelineInfo.pDynamicState = &dynamicInfo;
     pipelineInfo.layout = graphics->pipelineLayout;
+    // Note: Attachment format is given in place of render pass if rendering
+    //       dynamically
+    VkPipelineRenderingCreateInfoKHR renderingInfo = {0};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &graphics->swapChainData.format;
+    pipelineInfo.pNext = graphics->dynamicRendering ? &renderingInfo : NULL;
     pipelineInfo.renderPass = graphics->renderPass;
     pipelineInfo.subpass = 0;  // index
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE,
     pipelineInfo.basePipelineIndex = -1;
     
-    // Create only 1 pipeline with pipeline caching disabled
-    CHK_VK_ERR(vkCreateGraphicsPipelines(graphics->device, VK_NULL_HANDLE,
-        1, &pipelineInfo, NULL, &graphics->graphicsPipeline), 
-        "Failed to create graphics pipeline\n");
+    // Create 1 pipeline per star geometry with pipeline caching disabled
+    // Note: Geometry is selected in both shaders by specialization constant 0
+    const VkSpecializationMapEntry lodEntry = { 0, 0, sizeof(uint32_t) };
+    for (uint32_t lod = 0; lod < STAR_LOD_COUNT; ++lod) {
+        VkSpecializationInfo specInfo = {0};
+        specInfo.mapEntryCount = 1;
+        specInfo.pMapEntries = &lodEntry;
+        specInfo.dataSize = sizeof(uint32_t);
+        specInfo.pData = &lod;
+        shaderInfos[0].pSpecializationInfo = &specInfo;
+        shaderInfos[1].pSpecializationInfo = &specInfo;
+        
+        pipelineAssemblyInfo.topology = lod == STAR_LOD_POINT ?
+            VK_PRIMITIVE_TOPOLOGY_POINT_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        
+        CHK_VK_ERR(vkCreateGraphicsPipelines(graphics->device, VK_NULL_HANDLE,
+            1, &pipelineInfo, NULL, &graphics->graphicsPipelines[lod]), 
+            "Failed to create graphics pipeline\n");
+    }
     
     // Create compute pipeline/layout
     VkPipelineLayoutCreateInfo pipelineLayoutInfoCompute = {0};
@@ -1319,230 +1730,191 @@ static void createGraphicsPipeline(Graphics graphics)
     pipelineInfoCompute.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
     pipelineInfoCompute.layout = graphics->computePipelineLayout;
     pipelineInfoCompute.stage = compShaderInfo;
+    // Note: Work group size is specialization constant 0 (see shader.comp)
+    const VkSpecializationMapEntry workgroupEntry = { 0, 0, sizeof(uint32_t) };
+    VkSpecializationInfo workgroupInfo = {0};
+    workgroupInfo.mapEntryCount = 1;
+    workgroupInfo.pMapEntries = &workgroupEntry;
+    workgroupInfo.dataSize = sizeof(uint32_t);
+    workgroupInfo.pData = &graphics->options.workgroupSize;
+    pipelineInfoCompute.stage.pSpecializationInfo = &workgroupInfo;
     
     CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
         &pipelineInfoCompute, NULL, &graphics->computePipeline), "Failed to create compute pipeline\n");
     
+    // Create bucket pipeline/layout
+    pipelineLayoutInfoCompute.pSetLayouts = &graphics->bucketDescriptor.layout;
+    // Phase of bucket pass (see recordBucketPass)
+    VkPushConstantRange bucketConstantRange = {0};
+    bucketConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bucketConstantRange.offset = 0;
+    bucketConstantRange.size = sizeof(BucketConstants);
+    pipelineLayoutInfoCompute.pushConstantRangeCount = 1;
+    pipelineLayoutInfoCompute.pPushConstantRanges = &bucketConstantRange;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfoCompute,
+        NULL, &graphics->bucketPipelineLayout),
+        "Failed to create bucket pipeline layout\n");
+    
+    pipelineInfoCompute.layout = graphics->bucketPipelineLayout;
+    pipelineInfoCompute.stage.module = bucketShaderModule;
+    
+    CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+        &pipelineInfoCompute, NULL, &graphics->bucketPipeline), "Failed to create bucket pipeline\n");
+    
     // - Cleanup
     vkDestroyShaderModule(graphics->device, vertShaderModule, NULL);
     vkDestroyShaderModule(graphics->device, compShaderModule, NULL);
     vkDestroyShaderModule(graphics->device, fragShaderModule, NULL);
+    vkDestroyShaderModule(graphics->device, bucketShaderModule, NULL);
     
     free(vertShaderSource);
     free(compShaderSource);
     free(fragShaderSource);
+    free(bucketShaderSource);
 }
 
-// Initialize command pool and buffers
-static void createCommandResources(Graphics graphics)
+// Fullscreen triangle fading previous frames in trail mode (see --trails)
+// Note: Uses star pipeline layout, since it binds no resources itself
+static void createTrailPipeline(Graphics graphics)
 {
-    VkCommandPoolCreateInfo createInfo = {0};
-    createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    // Allow resetting command buffers allocated from this pool
-    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    createInfo.queueFamilyIndex = graphics->queueFamilies.graphicsFamily;
+    uint32_t vertShaderSize = 0, fragShaderSize = 0;
+    char *vertShaderSource = readBinFile("shaders/bin/fullscreen.vert.spv", &vertShaderSize);
+    char *fragShaderSource = readBinFile("shaders/bin/trail.frag.spv", &fragShaderSize);
+    VkShaderModule vertShaderModule = createShaderModule(graphics->device,
+        vertShaderSource, vertShaderSize);
+    VkShaderModule fragShaderModule = createShaderModule(graphics->device,
+        fragShaderSource, fragShaderSize);
+    
+    VkPipelineShaderStageCreateInfo shaderInfos[2] = {0};
+    shaderInfos[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderInfos[0].module = vertShaderModule;
+    shaderInfos[0].pName = "main";
+    shaderInfos[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderInfos[1].module = fragShaderModule;
+    shaderInfos[1].pName = "main";
     
-    CHK_VK_ERR(vkCreateCommandPool(graphics->device, &createInfo,
-        NULL, &graphics->commandPool), "Failed to create command pool\n");
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {0};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     
-    VkCommandBufferAllocateInfo allocInfo = {0};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = graphics->commandPool;
-    // Can be submitted to (graphics) queue for execution but not callable
-    // from other command buffers
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
+    VkPipelineInputAssemblyStateCreateInfo assemblyInfo = {0};
+    assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     
-    // Allocate command buffers for both graphics and compute queues
-    // Note: Command buffers are freed when their command pool is destroyed
-    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
-        graphics->commandBuffers), "Failed to allocate command buffers\n");
+    VkPipelineViewportStateCreateInfo viewportInfo = {0};
+    viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportInfo.viewportCount = 1;
+    viewportInfo.scissorCount = 1;
     
-    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
-        graphics->computeCommandBuffers), 
-        "Failed to allocate compute command buffers\n");
-}
-
-static void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
-    VkDeviceSize size, VkBufferUsageFlags usage, 
-    VkMemoryPropertyFlags properties, VkBuffer *buffer, 
-    VkDeviceMemory *bufferMemory)
-{
-    VkBufferCreateInfo createInfo = {0};
-    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    createInfo.size = size;
-    createInfo.usage = usage;
-    // Only accessed by single queue family
-    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.queueFamilyIndexCount = 0;  // optional
-    createInfo.pQueueFamilyIndices = NULL;  // optional
+    const VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
     
-    CHK_VK_ERR(vkCreateBuffer(device, &createInfo, NULL, buffer),
-        "Failed to create buffer\n");
+    VkPipelineDynamicStateCreateInfo dynamicInfo = {0};
+    dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicInfo.dynamicStateCount = 2;
+    dynamicInfo.pDynamicStates = dynamicStates;
     
-    // Query memory requirements of this buffer
-    VkMemoryRequirements memReq;
-    vkGetBufferMemoryRequirements(device, *buffer, &memReq);
+    VkPipelineRasterizationStateCreateInfo rasterizationInfo = {0};
+    rasterizationInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationInfo.lineWidth = 1.0f;
+    rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+    rasterizationInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
     
-    VkMemoryAllocateInfo allocInfo = {0};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits,
-        properties, physicalDevice);
+    // Note: Every sample is faded, same as star pipelines
+    VkPipelineMultisampleStateCreateInfo multisampleInfo = {0};
+    multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleInfo.rasterizationSamples = graphics->msaaSamples;
     
-    // Allocate required memory for buffer
-    CHK_VK_ERR(vkAllocateMemory(device, &allocInfo, NULL, bufferMemory),
-        "Failed to allocate buffer memory\n");
+    // C = decay * dst - src (decay as blend constant), alpha is kept
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {0};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+                                          VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT |
+                                          VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_CONSTANT_COLOR;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_REVERSE_SUBTRACT;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
     
-    // Bind buffer memory to buffer object
-    CHK_VK_ERR(vkBindBufferMemory(device, *buffer, *bufferMemory, 0),
-        "Failed to bind memory to buffer\n");
-}
-
-static VkCommandBuffer beginSingleUseCommands(Graphics graphics)
-{
-    VkCommandBufferAllocateInfo allocInfo = {0};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = graphics->commandPool;
-    allocInfo.commandBufferCount = 1;
-    
-    VkCommandBuffer commandBuffer;
-    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
-        &commandBuffer), "Failed to allocate single use command buffer\n");
-    
-    // Begin recording commands to single time command buffer
-    VkCommandBufferBeginInfo beginInfo = {0};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    // Commands of command buffer are only submitted once 
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    
-    CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
-        "Failed to begin recording single use command buffer\n");
-    
-    return commandBuffer;
-}
-
-static void endSingleUseCommands(Graphics graphics, 
-    VkCommandBuffer commandBuffer)
-{
-    // End recording commands
-    CHK_VK_ERR(vkEndCommandBuffer(commandBuffer), 
-        "Failed to end recording single use command buffer\n");
-    
-    VkSubmitInfo submitInfo = {0};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    
-    // Note: Wait on fence instead of queue to be idle
-    // Submit command buffer to graphics queue
-    VkFenceCreateInfo fenceInfo = {0};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    
-    VkFence fence;
-    CHK_VK_ERR(vkCreateFence(graphics->device, &fenceInfo, NULL, &fence),
-        "Failed to create fence for single use command buffer\n");
-    
-    CHK_VK_ERR(vkQueueSubmit(graphics->graphicsQueue, 1, &submitInfo,
-        fence), "Failed to submit single use command buffer to graphics queue\n");
-    // Wait until commands recorded to command buffer are executed
-    // (timeout is maximum possible value)
-    CHK_VK_ERR(vkWaitForFences(graphics->device, 1, &fence, VK_TRUE,
-        UINT64_MAX), "Failed to wait for single use command buffer completion\n");
-    
-    // Cleanup
-    vkDestroyFence(graphics->device, fence, NULL);
-    vkFreeCommandBuffers(graphics->device, graphics->commandPool,
-        1, &commandBuffer);
-}
-
-static void copyBuffer(Graphics graphics, VkBuffer src, VkBuffer dst, 
-    VkDeviceSize size)
-{
-    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
-    
-    VkBufferCopy copyRegion = {0};
-    // No offsets
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    
-    // Record command to copy buffer data
-    vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
-    
-    // Cleanup
-    endSingleUseCommands(graphics, commandBuffer);
-}
-
-static void createVertexBuffer(Graphics graphics, const Vertex *vertices,
-    uint32_t nVertices)
-{
-    const VkDeviceSize bufferSize = nVertices * sizeof(vertices[0]);
-    
-    // Temporary staging buffer to move data from host (CPU) to device (GPU)
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
-    
-    // Fill staging buffer with vertex data
-    void *data = NULL;
-    vkMapMemory(graphics->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices, (size_t)bufferSize);
-    vkUnmapMemory(graphics->device, stagingBufferMemory);
+    const float decay = graphics->options.trailDecay;
+    VkPipelineColorBlendStateCreateInfo colorBlendInfo = {0};
+    colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendInfo.logicOpEnable = VK_FALSE;
+    colorBlendInfo.attachmentCount = 1;
+    colorBlendInfo.pAttachments = &colorBlendAttachment;
+    colorBlendInfo.blendConstants[0] = decay;
+    colorBlendInfo.blendConstants[1] = decay;
+    colorBlendInfo.blendConstants[2] = decay;
+    colorBlendInfo.blendConstants[3] = 1.0f;
     
-    // Create vertex buffer
-    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &graphics->vertexData.buffer, &graphics->vertexData.memory);
+    VkGraphicsPipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderInfos;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &assemblyInfo;
+    pipelineInfo.pViewportState = &viewportInfo;
+    pipelineInfo.pRasterizationState = &rasterizationInfo;
+    pipelineInfo.pMultisampleState = &multisampleInfo;
+    pipelineInfo.pColorBlendState = &colorBlendInfo;
+    pipelineInfo.pDynamicState = &dynamicInfo;
+    pipelineInfo.layout = graphics->pipelineLayout;
+    VkPipelineRenderingCreateInfoKHR renderingInfo = {0};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &graphics->swapChainData.format;
+    pipelineInfo.pNext = graphics->dynamicRendering ? &renderingInfo : NULL;
+    pipelineInfo.renderPass = graphics->renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
     
-    // Copy contents of staging buffer
-    copyBuffer(graphics, stagingBuffer, graphics->vertexData.buffer, bufferSize);
+    CHK_VK_ERR(vkCreateGraphicsPipelines(graphics->device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &graphics->trailPipeline),
+        "Failed to create trail pipeline\n");
     
-    // Cleanup staging buffer
-    vkDestroyBuffer(graphics->device, stagingBuffer, NULL);
-    vkFreeMemory(graphics->device, stagingBufferMemory, NULL);
+    vkDestroyShaderModule(graphics->device, vertShaderModule, NULL);
+    vkDestroyShaderModule(graphics->device, fragShaderModule, NULL);
+    free(vertShaderSource);
+    free(fragShaderSource);
 }
 
-static void createIndexBuffer(Graphics graphics, const uint16_t *indices,
-    uint32_t nIndices)
+// Initialize command pool and buffers
+static void createCommandResources(Graphics graphics)
 {
-    const VkDeviceSize bufferSize = nIndices * sizeof(indices[0]);
-    
-    // Temporary staging buffer to move data from host (CPU) to device (GPU)
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
+    VkCommandPoolCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // Allow resetting command buffers allocated from this pool
+    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    createInfo.queueFamilyIndex = graphics->queueFamilies.graphicsFamily;
     
-    // Fill staging buffer with vertex data
-    void *data = NULL;
-    vkMapMemory(graphics->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices, (size_t)bufferSize);
-    vkUnmapMemory(graphics->device, stagingBufferMemory);
+    CHK_VK_ERR(vkCreateCommandPool(graphics->device, &createInfo,
+        NULL, &graphics->commandPool), "Failed to create command pool\n");
     
-    // Create vertex buffer
-    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &graphics->indexData.buffer, &graphics->indexData.memory);
+    VkCommandBufferAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = graphics->commandPool;
+    // Can be submitted to (graphics) queue for execution but not callable
+    // from other command buffers
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
     
-    // Copy contents of staging buffer
-    copyBuffer(graphics, stagingBuffer, graphics->indexData.buffer, bufferSize);
+    // Allocate command buffers for both graphics and compute queues
+    // Note: Command buffers are freed when their command pool is destroyed
+    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
+        graphics->commandBuffers), "Failed to allocate command buffers\n");
     
-    // Cleanup staging buffer
-    vkDestroyBuffer(graphics->device, stagingBuffer, NULL);
-    vkFreeMemory(graphics->device, stagingBufferMemory, NULL);
+    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
+        graphics->computeCommandBuffers), 
+        "Failed to allocate compute command buffers\n");
 }
 
 static void createFlightBuffer(Graphics graphics, 
@@ -1554,7 +1926,8 @@ static void createFlightBuffer(Graphics graphics,
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &bufferResource->buffers[i], &bufferResource->memories[i]);
+            &bufferResource->buffers[i], &bufferResource->memories[i],
+            MEMORY_UNIFORMS);
             
         // Obtain pointer to mapped memory range
         CHK_VK_ERR(vkMapMemory(graphics->device, bufferResource->memories[i],
@@ -1595,80 +1968,42 @@ static void createUniformBuffers(Graphics graphics)
         &graphics->computeDescriptor, bufferSize, 0);
 }
 
-static void randomizeParticles(Particle particles[N_PARTICLES])
-{
-    // Note: Equi-area sampling (uniform)
-    const float r = STARTING_POSITION_RADIUS * sqrtf((float)rand() / (float)RAND_MAX);
-    const float phi = ((float)rand() / (float)RAND_MAX) * 2.0f * GLM_PI;
-    const float randomCenterX = r * cosf(phi);
-    const float randomCenterY = r * sinf(phi);
-    
-    for (uint32_t i = 0; i < N_PARTICLES; ++i) {
-        // Random initial position inside concentric circle for ALL particles
-        particles[i].position[0] = randomCenterX;
-        particles[i].position[1] = randomCenterY;
-        
-        // Random orientation
-        particles[i].orientation = ((float)rand() / (float)RAND_MAX) * 2.0f * GLM_PI;
-        
-        // Random direction
-        const float theta = ((float)rand() / (float)RAND_MAX) * 2.0f * GLM_PI;
-        // Random speed
-        const float minSpeed = 1e-1f;
-        const float maxSpeed = 1.0f;
-        const float xi = ((float)rand() / (float)RAND_MAX);
-        const float speed = (maxSpeed - minSpeed) * xi + minSpeed;
-        particles[i].velocity[0] = speed * cosf(theta);
-        particles[i].velocity[1] = speed * sinf(theta);
-        
-        particles[i].color[0] = (float)rand() / (float)RAND_MAX;
-        particles[i].color[1] = (float)rand() / (float)RAND_MAX;
-        particles[i].color[2] = (float)rand() / (float)RAND_MAX;
-        particles[i].color[3] = 1.0f;  // fully opaque
-    }
-}
-
 static void createShaderStorage(Graphics graphics)
 {
-    // Initialize particle data
-    Particle particles[N_PARTICLES] = {0};
-    randomizeParticles(particles);
-    
-    const VkDeviceSize bufferSize = sizeof(particles);
-    
-    // Initialize staging buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    
-    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
-        
-    void *data;
-    vkMapMemory(graphics->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, particles, (size_t)bufferSize);
-    vkUnmapMemory(graphics->device, stagingBufferMemory);
+    // Note: Particles are left uninitialized, initParticles() fills them
+    // Note: In-place mode aliases all frame slots to a single buffer, so
+    //       update reads and writes the same particles (see --in-place)
+    const uint32_t count = graphics->options.particleCount;
+    // One compute invocation per particle, bucket pass uses 256 per work group
+    const uint32_t maxGroups = 
+        graphics->deviceProperties.limits.maxComputeWorkGroupCount[0];
+    const uint32_t minSize = graphics->options.workgroupSize < 256 ?
+        graphics->options.workgroupSize : 256;
+    if ((count + minSize - 1) / minSize > maxGroups) {
+        fprintf(stderr, "Too many particles for device (max. %llu)\n",
+            (unsigned long long)maxGroups * minSize);
+        exit(EXIT_FAILURE);
+    }
+    const VkDeviceSize bufferSize = (VkDeviceSize)count * sizeof(Particle);
+    const uint32_t bufferCount = graphics->options.inPlace ? 1 : MAX_FRAMES_IN_FLIGHT;
     
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        if (i >= bufferCount) {
+            graphics->shaderStorage.buffers[i] = graphics->shaderStorage.buffers[0];
+            continue;
+        }
+        // Note: Transfers save and restore snapshots (see snapshot.c)
         createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            &graphics->shaderStorage.buffers[i], &graphics->shaderStorage.memories[i]);
-        
-        copyBuffer(graphics, stagingBuffer, graphics->shaderStorage.buffers[i], bufferSize);
+            &graphics->shaderStorage.buffers[i], &graphics->shaderStorage.memories[i],
+            MEMORY_PARTICLES);
     }
     
-    // Cleanup staging buffer
-    vkDestroyBuffer(graphics->device, stagingBuffer, NULL);
-    vkFreeMemory(graphics->device, stagingBufferMemory, NULL);
-    
     // Update descriptor sets accordingly
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        VkWriteDescriptorSet descriptorWrites[2] = {0};
+        VkWriteDescriptorSet descriptorWrites[3] = {0};
         
         VkDescriptorBufferInfo storageBufferInfoLastFrame = {0};
         storageBufferInfoLastFrame.buffer = 
@@ -1697,7 +2032,125 @@ static void createShaderStorage(Graphics graphics)
         descriptorWrites[1].descriptorCount = 1;
         descriptorWrites[1].pBufferInfo = &storageBufferInfoCurrentFrame;
         
-        vkUpdateDescriptorSets(graphics->device, 2, descriptorWrites, 0, NULL);
+        // Vertex shader draws particles written in same frame
+        descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[2].dstSet = graphics->vertexDescriptor.sets[i];
+        descriptorWrites[2].dstBinding = 1;  // see ParticleSSBO in vert shader
+        descriptorWrites[2].dstArrayElement = 0;
+        descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[2].descriptorCount = 1;
+        descriptorWrites[2].pBufferInfo = &storageBufferInfoCurrentFrame;
+        
+        vkUpdateDescriptorSets(graphics->device, 3, descriptorWrites, 0, NULL);
+    }
+}
+
+// Device local buffer initialized with data (uploaded via staging buffer)
+static void createStaticBuffer(Graphics graphics, const void *data,
+    VkDeviceSize bufferSize, VkBufferUsageFlags usage, BufferResource *resource)
+{
+    // Temporary staging buffer to move data from host (CPU) to device (GPU)
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer, &stagingBufferMemory, MEMORY_STAGING);
+    
+    void *mapped = NULL;
+    vkMapMemory(graphics->device, stagingBufferMemory, 0, bufferSize, 0, &mapped);
+        memcpy(mapped, data, (size_t)bufferSize);
+    vkUnmapMemory(graphics->device, stagingBufferMemory);
+    
+    createBuffer(graphics->device, graphics->physicalDevice, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &resource->buffer, &resource->memory, MEMORY_OTHER);
+    
+    copyBuffer(graphics, stagingBuffer, resource->buffer, bufferSize);
+    
+    // Cleanup staging buffer
+    vkDestroyBuffer(graphics->device, stagingBuffer, NULL);
+    freeMemory(graphics->device, stagingBufferMemory);
+}
+
+// Bind whole buffer to binding of descriptor set
+static void writeBufferDescriptor(Graphics graphics, VkDescriptorSet set,
+    uint32_t binding, VkDescriptorType type, VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo = {0};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    
+    VkWriteDescriptorSet descriptorWrite = {0};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = type;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    
+    vkUpdateDescriptorSets(graphics->device, 1, &descriptorWrite, 0, NULL);
+}
+
+// Initialize shape arena, indirect draw commands and bucketed instances
+static void createShapeBuffers(Graphics graphics)
+{
+    ShapeArena arena;
+    geomBuildShapes(&arena);
+    memcpy(graphics->shapeDraws, arena.draws, sizeof(arena.draws));
+    
+    createStaticBuffer(graphics, arena.vertices, 
+        arena.vertexCount * sizeof(arena.vertices[0]),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &graphics->shapeVertices);
+    createStaticBuffer(graphics, arena.indices,
+        arena.indexCount * sizeof(arena.indices[0]),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &graphics->shapeIndices);
+    
+    // Note: Shapes share one range, ordered by shape (see bucket.comp)
+    const uint32_t particleCount = graphics->options.particleCount;
+    const VkDeviceSize instanceSize = (VkDeviceSize)particleCount * sizeof(uint32_t);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        // Note: Reset by CPU and counted by bucket.comp in every frame,
+        //       followed by shape counts of every work group
+        createBuffer(graphics->device, graphics->physicalDevice,
+            SHAPE_COUNT * sizeof(VkDrawIndexedIndirectCommand) +
+            bucketCountsSize(particleCount),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &graphics->drawCommands.buffers[i], &graphics->drawCommands.memories[i],
+            MEMORY_OTHER);
+        createBuffer(graphics->device, graphics->physicalDevice, instanceSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &graphics->shapeInstances.buffers[i], &graphics->shapeInstances.memories[i],
+            MEMORY_PARTICLES);
+    }
+    
+    // Update descriptor sets accordingly
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        // see ShapeVertexSSBO, InstanceSSBO and DrawCommandSSBO in vert shader
+        writeBufferDescriptor(graphics, graphics->vertexDescriptor.sets[i], 2,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->shapeVertices.buffer);
+        writeBufferDescriptor(graphics, graphics->vertexDescriptor.sets[i], 3,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->shapeInstances.buffers[i]);
+        writeBufferDescriptor(graphics, graphics->vertexDescriptor.sets[i], 4,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->drawCommands.buffers[i]);
+        
+        // see bucket.comp (particles of current frame are bucketed)
+        writeBufferDescriptor(graphics, graphics->bucketDescriptor.sets[i], 0,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, graphics->deltaTimeUniform.buffers[i]);
+        writeBufferDescriptor(graphics, graphics->bucketDescriptor.sets[i], 1,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->shaderStorage.buffers[i]);
+        writeBufferDescriptor(graphics, graphics->bucketDescriptor.sets[i], 2,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->drawCommands.buffers[i]);
+        writeBufferDescriptor(graphics, graphics->bucketDescriptor.sets[i], 3,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, graphics->shapeInstances.buffers[i]);
     }
 }
 
@@ -1751,47 +2204,218 @@ static void cleanupSyncObjects(Graphics graphics)
     }
 }
 
-static void recordCommandBuffer(Graphics graphics, 
-    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+// Layout transition of color image (trails) or swapchain image
+static void colorBarrier(VkCommandBuffer commandBuffer, VkImage image,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
 {
-    VkCommandBufferBeginInfo beginInfo = {0};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = 0;  // optional
-    beginInfo.pInheritanceInfo = NULL;  // optional
-    
-    CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
-        "Failed to begin recording command buffer\n");
+    VkImageMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL,
+        1, &barrier);
+}
+
+// Clear accumulated trails once after (re-)creation of color image
+// Note: Render pass loads them in attachment layout (see createRenderPass())
+static void clearTrails(Graphics graphics, VkCommandBuffer commandBuffer)
+{
+    const VkImage image = graphics->swapChainData.colorResource.image;
+    colorBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    
+    const VkClearColorValue black = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    VkImageSubresourceRange range = {0};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+    vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        &black, 1, &range);
+    
+    colorBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    graphics->swapChainData.colorCleared = VK_TRUE;
+}
+
+// Copy single sampled trails into swapchain image, leaving both in layouts
+// expected by next render pass and presentation
+// Note: Transfer stage waits on image acquisition (see draw())
+static void copyTrails(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    const VkImage trails = graphics->swapChainData.colorResource.image;
+    const VkImage image = graphics->swapChainData.images[imageIndex];
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    
+    // Note: Render pass made trails available to transfer (final layout),
+    //       dynamic rendering left them in attachment layout
+    colorBarrier(commandBuffer, trails, graphics->dynamicRendering ?
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    colorBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    
+    VkImageCopy region = {0};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.mipLevel = 0;
+    region.srcSubresource.baseArrayLayer = 0;
+    region.srcSubresource.layerCount = 1;
+    region.dstSubresource = region.srcSubresource;
+    region.extent = (VkExtent3D) {extent.width, extent.height, 1};
+    vkCmdCopyImage(commandBuffer, trails, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    
+    // Same layout as render pass output (see tilesRecordFrame())
+    colorBarrier(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        graphics->options.headless ?
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT);
+    colorBarrier(commandBuffer, trails, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+}
+
+// Start render pass, or with dynamic rendering, transition attachments and
+// draw into their views with the same load, store and resolve operations
+// Note: Swapchain image layouts before and after match createRenderPass()
+static void beginRendering(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    const SwapChainData *swapChain = &graphics->swapChainData;
+    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};  // black
     
-    // Start render pass
-    VkRenderPassBeginInfo renderPassInfo = {0};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = graphics->renderPass;
-    // Bind framebuffer associated with acquired swapchain image to draw to it
-    renderPassInfo.framebuffer = graphics->swapChainData.frameBuffers[imageIndex];
-    renderPassInfo.renderArea.offset = (VkOffset2D) {0, 0};
-    renderPassInfo.renderArea.extent = graphics->swapChainData.extent;
+    if (!graphics->dynamicRendering) {
+        VkRenderPassBeginInfo renderPassInfo = {0};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = graphics->renderPass;
+        // Bind framebuffer associated with acquired swapchain image to draw to it
+        renderPassInfo.framebuffer = swapChain->frameBuffers[imageIndex];
+        renderPassInfo.renderArea.offset = (VkOffset2D) {0, 0};
+        renderPassInfo.renderArea.extent = swapChain->extent;
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearColor;
+        
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, 
+            VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
     
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};  // black
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    const VkBool32 resolve = graphics->msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+    const VkBool32 trails = trailsEnabled(graphics);
+    
+    VkRenderingAttachmentInfoKHR colorAttachment = {0};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = trails ?
+        VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // Note: Samples of MSAA image are dead once resolved, unless trails
+    //       load them again next frame
+    colorAttachment.storeOp = resolve && !trails ?
+        VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearColor;
+    if (resolve || trails) {
+        colorAttachment.imageView = swapChain->colorResource.view;
+        // Trails stay in attachment layout (see clearTrails()), wait for
+        // previous frame to write them
+        colorBarrier(commandBuffer, swapChain->colorResource.image,
+            trails ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            trails ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    } else {
+        colorAttachment.imageView = swapChain->imageViews[imageIndex];
+    }
+    if (resolve) {
+        // Resolve inline into swapchain image
+        colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+        colorAttachment.resolveImageView = swapChain->imageViews[imageIndex];
+        colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+    if (!trailsCopied(graphics)) {
+        // Note: Waits on image acquisition (see draw())
+        colorBarrier(commandBuffer, swapChain->images[imageIndex],
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    }
     
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, 
-        VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-        graphics->graphicsPipeline);
+    VkRenderingInfoKHR renderingInfo = {0};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = (VkOffset2D) {0, 0};
+    renderingInfo.renderArea.extent = swapChain->extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
     
-    // Bind vertex buffers (star vertices + particle data)
-    const VkBuffer vertexBuffers[] = {
-        graphics->vertexData.buffer,
-        graphics->shaderStorage.buffers[graphics->currentFrame]
-    };
-    const VkDeviceSize offsets[] = {0, 0};
+    graphics->cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+// End render pass, or with dynamic rendering, leave swapchain image in
+// output layout
+// Note: Single sampled trails are transitioned by copyTrails()
+static void endRendering(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    if (!graphics->dynamicRendering) {
+        vkCmdEndRenderPass(commandBuffer);
+        return;
+    }
     
-    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    graphics->cmdEndRendering(commandBuffer);
+    if (!trailsCopied(graphics)) {
+        // Same layout and access as after copyTrails()
+        colorBarrier(commandBuffer, graphics->swapChainData.images[imageIndex],
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            graphics->options.headless ?
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT);
+    }
+}
+
+// Draw stars of current frame with graphics pipeline of starLod
+static void recordRenderPass(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (trailsEnabled(graphics) && !graphics->swapChainData.colorCleared) {
+        clearTrails(graphics, commandBuffer);
+    }
     
-    // Bind index buffer
-    vkCmdBindIndexBuffer(commandBuffer, graphics->indexData.buffer, 0, 
-        VK_INDEX_TYPE_UINT16);
+    beginRendering(graphics, commandBuffer, imageIndex);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        graphics->graphicsPipelines[graphics->starLod]);
     
     // Dynamically set viewport and scissor state
     VkViewport viewport = {0};
@@ -1810,16 +2434,311 @@ static void recordCommandBuffer(Graphics graphics,
     
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     
-    // Finally, issue draw command
-    // TODO: Pass N_INDICES_STAR as function argument
-    const uint32_t indexCount = N_INDICES_STAR;
+    if (graphics->trailPipeline != VK_NULL_HANDLE) {
+        // Fade previous frames before drawing stars on top
+        // Note: Viewport and scissor are dynamic in both pipelines
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            graphics->trailPipeline);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            graphics->graphicsPipelines[graphics->starLod]);
+    }
     
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
         graphics->pipelineLayout, 0, 1, 
         &graphics->vertexDescriptor.sets[graphics->currentFrame], 0, NULL);
-    vkCmdDrawIndexed(commandBuffer, indexCount, N_PARTICLES, 0, 0, 0);
     
-    vkCmdEndRenderPass(commandBuffer);
+    // Finally, issue draw commands (one shape instance per particle)
+    // Note: Vertex shader pulls shape outline and particle data itself
+    const uint32_t particleCount = graphics->options.particleCount;
+    uint32_t baseShape = 0;
+    if (graphics->starLod == STAR_LOD_MESH) {
+        // Draw every shape with its instances bucketed by compute pass
+        const VkBuffer drawBuffer = graphics->drawCommands.buffers[graphics->currentFrame];
+        const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        vkCmdBindIndexBuffer(commandBuffer, graphics->shapeIndices.buffer, 0,
+            VK_INDEX_TYPE_UINT16);
+        
+        if (graphics->deviceFeatures.multiDrawIndirect &&
+            graphics->deviceFeatures.drawIndirectFirstInstance)
+        {
+            vkCmdPushConstants(commandBuffer, graphics->pipelineLayout,
+                VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(baseShape), &baseShape);
+            vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, 0, SHAPE_COUNT, stride);
+        } else {
+            // Note: Without firstInstance support, vertex shader offsets
+            //       instances of shape by counts of shapes before it
+            for (uint32_t s = 0; s < SHAPE_COUNT; ++s) {
+                baseShape = graphics->deviceFeatures.drawIndirectFirstInstance ? 0 : s;
+                vkCmdPushConstants(commandBuffer, graphics->pipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(baseShape), &baseShape);
+                vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, 
+                    s * stride, 1, stride);
+            }
+        }
+    } else {
+        // Note: SDF of every shape is evaluated in fragment shader
+        const uint32_t vertexCount = graphics->starLod == STAR_LOD_QUAD ? 6 : 1;
+        vkCmdPushConstants(commandBuffer, graphics->pipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(baseShape), &baseShape);
+        vkCmdDraw(commandBuffer, vertexCount, particleCount, 0, 0);
+    }
+    
+    if (graphics->sparks->enabled) {
+        // Note: #sparks is known on GPU only
+        sparksRecordDraw(graphics, commandBuffer);
+    }
+    
+    endRendering(graphics, commandBuffer, imageIndex);
+    
+    if (trailsCopied(graphics)) {
+        copyTrails(graphics, commandBuffer, imageIndex);
+    }
+}
+
+static void recordGridPass(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    (void)imageIndex;
+    if (graphics->reorderParticles) {
+        // Permutation into Morton order, applied by update
+        gridRecordBuild(graphics, commandBuffer, GRID_KEY_MORTON);
+    }
+    if (graphics->grid->interactions) {
+        // Sort particles of previous step into neighbor grid
+        gridRecordBuild(graphics, commandBuffer, GRID_KEY_HASH);
+    }
+}
+
+static void recordUpdatePass(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    (void)imageIndex;
+    if (graphics->sparks->enabled) {
+        // Move sparks of previous step before stars append new ones
+        sparksRecordUpdate(graphics, commandBuffer);
+    }
+    // Bind the compute pipeline
+    vkCmdBindPipeline(commandBuffer, 
+        VK_PIPELINE_BIND_POINT_COMPUTE, graphics->computePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        graphics->computePipelineLayout, 0, 1, 
+        &graphics->computeDescriptor.sets[graphics->currentFrame], 0, NULL);
+    // Dispatch compute shader
+    // Note: Work group size is set by performance profile (see profile.c),
+    //       excess invocations of last group return early
+    const uint32_t workgroupSize = graphics->options.workgroupSize;
+    vkCmdDispatch(commandBuffer,
+        (graphics->options.particleCount + workgroupSize - 1) / workgroupSize, 1, 1);
+    if (graphics->sparks->enabled) {
+        sparksRecordFinalize(graphics, commandBuffer);
+    }
+    
+    // Reset indirect draws (instances are counted and their
+    // first instance is set by bucket pass)
+    VkDrawIndexedIndirectCommand drawCommands[SHAPE_COUNT] = {0};
+    for (uint32_t s = 0; s < SHAPE_COUNT; ++s) {
+        const ShapeDraw *shapeDraw = &graphics->shapeDraws[s];
+        drawCommands[s].indexCount = shapeDraw->indexCount;
+        drawCommands[s].instanceCount = 0;
+        drawCommands[s].firstIndex = shapeDraw->firstIndex;
+        drawCommands[s].vertexOffset = shapeDraw->vertexOffset;
+        drawCommands[s].firstInstance = 0;
+    }
+    // Note: Star outline is generated in vertex shader for current #tips
+    drawCommands[SHAPE_STAR].indexCount = 
+        GEOM_STAR_VERTEX_COUNT(graphics->options.starPoints);
+    vkCmdUpdateBuffer(commandBuffer, 
+        graphics->drawCommands.buffers[graphics->currentFrame], 
+        0, sizeof(drawCommands), drawCommands);
+}
+
+static void recordBucketPass(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    (void)imageIndex;
+    // Bucket particles by shape
+    vkCmdBindPipeline(commandBuffer, 
+        VK_PIPELINE_BIND_POINT_COMPUTE, graphics->bucketPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        graphics->bucketPipelineLayout, 0, 1, 
+        &graphics->bucketDescriptor.sets[graphics->currentFrame], 0, NULL);
+    // Count particles per shape and work group, sum counts of work groups
+    // before every one, then scatter particles behind them
+    const uint32_t groupCount = bucketGroupCount(graphics->options.particleCount);
+    const uint32_t dispatchSizes[] = { groupCount, 1, groupCount };
+    BucketConstants constants = {0};
+    constants.firstInstance = graphics->deviceFeatures.drawIndirectFirstInstance;
+    for (uint32_t phase = BUCKET_PHASE_COUNT; phase <= BUCKET_PHASE_SCATTER; ++phase) {
+        if (phase != BUCKET_PHASE_COUNT) {
+            VkMemoryBarrier barrier = {0};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+        }
+        constants.phase = phase;
+        vkCmdPushConstants(commandBuffer, graphics->bucketPipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, dispatchSizes[phase], 1, 1);
+    }
+}
+
+static void recordStreamPass(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    (void)imageIndex;
+    streamRecordCapture(graphics, commandBuffer);
+}
+
+// Declare passes of current frame with the resources they access, in
+// submission order (see rendergraph.h)
+// Note: Requires starLod, drawTiles and reorderParticles of current frame
+static void buildFrameGraph(Graphics graphics)
+{
+    RenderGraph *graph = graphics->renderGraph;
+    renderGraphReset(graph);
+    
+    const VkImageLayout outputLayout = graphics->options.headless ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    const VkBool32 sparks = graphics->sparks->enabled;
+    const VkBool32 grid = graphics->reorderParticles || graphics->grid->interactions;
+    RenderGraphPass *pass = NULL;
+    
+    // - Compute submission
+    if (grid) {
+        pass = renderGraphAddPass(graph, "grid", RENDER_QUEUE_COMPUTE,
+            GPU_PASS_GRID, recordGridPass);
+        renderGraphReadPrevious(pass, RENDER_RESOURCE_PARTICLES,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        renderGraphWrite(pass, RENDER_RESOURCE_GRID,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    
+    // Note: Next step reads particles of this one, so update always runs
+    pass = renderGraphAddPass(graph, "update", RENDER_QUEUE_COMPUTE,
+        GPU_PASS_COMPUTE, recordUpdatePass);
+    pass->sideEffects = VK_TRUE;
+    if (grid) {
+        renderGraphRead(pass, RENDER_RESOURCE_GRID,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+    renderGraphReadPrevious(pass, RENDER_RESOURCE_PARTICLES,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    renderGraphWrite(pass, RENDER_RESOURCE_PARTICLES,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    renderGraphWrite(pass, RENDER_RESOURCE_DRAWS,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    if (sparks) {
+        // Sparks of previous step are moved by indirect dispatch, counters
+        // of this step are reset and copied for readback
+        // Note: Finalize makes sparks visible to draw itself
+        renderGraphReadPrevious(pass, RENDER_RESOURCE_SPARKS,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+        renderGraphWrite(pass, RENDER_RESOURCE_SPARKS,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    
+    // Culled unless meshes are drawn from bucketed instances
+    pass = renderGraphAddPass(graph, "bucket", RENDER_QUEUE_COMPUTE,
+        GPU_PASS_COMPUTE, recordBucketPass);
+    renderGraphRead(pass, RENDER_RESOURCE_PARTICLES,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    renderGraphRead(pass, RENDER_RESOURCE_DRAWS,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    renderGraphWrite(pass, RENDER_RESOURCE_DRAWS,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    
+    if (graphics->stream && graphics->frameCounter % graphics->stream->interval == 0) {
+        pass = renderGraphAddPass(graph, "stream", RENDER_QUEUE_COMPUTE,
+            GPU_PASS_COMPUTE, recordStreamPass);
+        pass->sideEffects = VK_TRUE;
+        renderGraphRead(pass, RENDER_RESOURCE_PARTICLES,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+    
+    // - Graphics submission
+    if (graphics->drawTiles) {
+        // Note: Compute passes replace render pass, copying into same image
+        pass = renderGraphAddPass(graph, "tiles", RENDER_QUEUE_GRAPHICS,
+            GPU_PASS_RENDER, tilesRecordFrame);
+        renderGraphRead(pass, RENDER_RESOURCE_PARTICLES,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        renderGraphWriteImage(pass, RENDER_RESOURCE_OUTPUT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, outputLayout);
+    } else {
+        const VkPipelineStageFlags indirectStages =
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+        const VkAccessFlags indirectAccess =
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        pass = renderGraphAddPass(graph, "stars", RENDER_QUEUE_GRAPHICS,
+            GPU_PASS_RENDER, recordRenderPass);
+        renderGraphRead(pass, RENDER_RESOURCE_PARTICLES,
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        if (graphics->starLod == STAR_LOD_MESH) {
+            renderGraphRead(pass, RENDER_RESOURCE_DRAWS, indirectStages, indirectAccess);
+        }
+        if (sparks) {
+            renderGraphRead(pass, RENDER_RESOURCE_SPARKS, indirectStages, indirectAccess);
+        }
+        // Note: Trails are copied into image instead of resolved
+        if (trailsCopied(graphics)) {
+            renderGraphWriteImage(pass, RENDER_RESOURCE_OUTPUT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, outputLayout);
+        } else {
+            renderGraphWriteImage(pass, RENDER_RESOURCE_OUTPUT,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, outputLayout);
+        }
+    }
+    
+    if (graphics->bloom) {
+        // Glow is added before export, so videos match presented frames
+        pass = renderGraphAddPass(graph, "bloom", RENDER_QUEUE_GRAPHICS,
+            GPU_PASS_BLOOM, bloomRecordFrame);
+        renderGraphReadImage(pass, RENDER_RESOURCE_OUTPUT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_UNDEFINED);
+        renderGraphWriteImage(pass, RENDER_RESOURCE_OUTPUT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, outputLayout);
+    }
+    
+    if (graphics->exporter) {
+        // Copy final image to readback buffer (not timed)
+        pass = renderGraphAddPass(graph, "export", RENDER_QUEUE_GRAPHICS,
+            GPU_PASS_COUNT, exportRecordFrame);
+        pass->sideEffects = VK_TRUE;
+        renderGraphReadImage(pass, RENDER_RESOURCE_OUTPUT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, outputLayout);
+    }
+    
+    renderGraphCompile(graph, graphics->currentFrame);
+}
+
+static void recordCommandBuffer(Graphics graphics, 
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = 0;  // optional
+    beginInfo.pInheritanceInfo = NULL;  // optional
+    
+    CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+        "Failed to begin recording command buffer\n");
+    
+    // Passes and barriers compiled by buildFrameGraph()
+    renderGraphRecord(graphics, RENDER_QUEUE_GRAPHICS, commandBuffer, imageIndex);
     
     // Done recording commands
     CHK_VK_ERR(vkEndCommandBuffer(commandBuffer),
@@ -1835,31 +2754,50 @@ static void recordComputeCommandBuffer(Graphics graphics,
     CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
         "Failed to begin recording compute command buffer\n");
     
-    // Bind the compute pipeline
-    vkCmdBindPipeline(commandBuffer, 
-        VK_PIPELINE_BIND_POINT_COMPUTE, graphics->computePipeline);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-        graphics->computePipelineLayout, 0, 1, 
-        &graphics->computeDescriptor.sets[graphics->currentFrame], 0, NULL);
-    // Dispatch compute shader
-    // Note: Using 256 threads per work group in x dimension 
-    vkCmdDispatch(commandBuffer, N_PARTICLES / 256, 1, 1);
+    // Note: Compute passes never access swapchain image
+    renderGraphRecord(graphics, RENDER_QUEUE_COMPUTE, commandBuffer, 0);
     
     CHK_VK_ERR(vkEndCommandBuffer(commandBuffer),
         "Failed to end recording compute command buffer\n");
 }
 
+// Geometry of stars with given diameter in pixels (see RenderMode)
+static StarLod selectStarLod(Graphics graphics, float diameter)
+{
+    const Options *options = &graphics->options;
+    if (options->renderMode == RENDER_MODE_MESH) {
+        return STAR_LOD_MESH;
+    }
+    if (options->renderMode == RENDER_MODE_AUTO && diameter >= options->lodMeshSize) {
+        return STAR_LOD_MESH;
+    }
+    // Note: Sprite includes 1 pixel margin for anti-aliasing on every side
+    const float pointSize = diameter + 2.0f;
+    if (diameter < options->lodPointSize && graphics->deviceFeatures.largePoints &&
+        pointSize <= graphics->deviceProperties.limits.pointSizeRange[1])
+    {
+        return STAR_LOD_POINT;
+    }
+    return STAR_LOD_QUAD;
+}
+
 static void updateShaderBuffers(Graphics graphics)
 {   
     // Compute elapsed time since last frame
-    const double now = glfwGetTime();
+    // Note: Not using GLFW timer, since GLFW is not initialized when headless
+    // Note: Fixed time step decouples animation from rendering speed
+    const double now = graphics->options.fixedTimeStep > 0.0 ?
+        graphics->lastFrameTime + graphics->options.fixedTimeStep :
+        timerSeconds() - graphics->timerStart;
     const double deltaTime = now - graphics->lastFrameTime;
     // Note: Ideally would use some kind of callback for exact timing,
     //       but good enough in practice
     if (now >= ANIMATION_RESET_TIME) {
-        // Reset GLFW timer
-        glfwSetTime(0.0);
-        graphics->lastFrameTime = glfwGetTime();
+        // Reset timer
+        graphics->timerStart = timerSeconds();
+        graphics->lastFrameTime = 0.0;
+        // Next show draws new random numbers
+        ++graphics->show;
     } else {
         graphics->lastFrameTime = now;
     }
@@ -1868,7 +2806,16 @@ static void updateShaderBuffers(Graphics graphics)
     pbo.deltaTime = (float)deltaTime;
     pbo.elapsedTime = (float)now;
     pbo.animationResetTime = (float)ANIMATION_RESET_TIME;
-    pbo.randomSeed = (uint32_t)rand();  // used during animation reset in compute shader
+    pbo.randomSeed = graphics->options.seed;  // key of random numbers with show (see rng.h)
+    pbo.show = graphics->show;
+    pbo.particleCount = graphics->options.particleCount;
+    pbo.interactionRadius = graphics->options.interactionRadius;
+    pbo.interactionStrength = graphics->options.interactionStrength;
+    pbo.gridCellCount = graphics->grid->cellCount;
+    graphics->reorderParticles = gridSelectReorder(graphics);
+    pbo.reorderParticles = graphics->reorderParticles;
+    pbo.sparksPerBurst = graphics->options.sparksPerBurst;
+    pbo.sparkCapacity = graphics->sparks->capacity;
     
     // Copy deltaTime to uniform entry
     memcpy(graphics->deltaTimeUniform.mapped[graphics->currentFrame], 
@@ -1884,76 +2831,322 @@ static void updateShaderBuffers(Graphics graphics)
     // Flip sign for consistency
     ubo.proj[1][1] *= -1.0f;
     
+    // Note: Star shape may change between frames (see glfwKeyCallback)
+    ubo.starSize = graphics->options.starSize;
+    ubo.starInnerRadius = graphics->options.starSize *
+        geomStarInnerRatio(graphics->options.starPoints);
+    ubo.starPoints = graphics->options.starPoints;
+    
+    // Pick geometry by size of stars on screen
+    // Note: All stars share one size, so LOD is uniform per frame
+    vec4 center = {0.0f, 0.0f, 0.0f, 1.0f};
+    mat4 mvp;
+    glm_mat4_mul(ubo.proj, ubo.view, mvp);
+    glm_mat4_mul(mvp, ubo.model, mvp);
+    glm_mat4_mulv(mvp, center, center);
+    ubo.pixelSize = 2.0f * center[3] / (fabsf(ubo.proj[1][1]) *
+        (float)graphics->swapChainData.extent.height);
+    graphics->starLod = selectStarLod(graphics, 2.0f * ubo.starSize / ubo.pixelSize);
+    graphics->drawTiles = tilesSelect(graphics);
+    
     // Copy ubo to mapped range in memory
     memcpy(graphics->mvpUniform.mapped[graphics->currentFrame], &ubo, sizeof(ubo));
 }
 
+// Rough device-local size of allocations scaling with #particles or extent
+// (see createShaderStorage(), initNeighborGrid(), createColorResource(), ...)
+// Note: Extent is taken from options, swapchain images are not counted
+static VkDeviceSize estimateDeviceMemory(Graphics graphics,
+    uint32_t particleCount, VkSampleCountFlagBits samples)
+{
+    const Options *options = &graphics->options;
+    const VkBool32 interactions = options->interactionStrength != 0.0f;
+    
+    // Particle state, per-shape instances and tile entries
+    VkDeviceSize perParticle =
+        (options->inPlace ? 1 : MAX_FRAMES_IN_FLIGHT) * sizeof(Particle) +
+        MAX_FRAMES_IN_FLIGHT * sizeof(uint32_t) +
+        TILE_ENTRIES_PER_PARTICLE * sizeof(uint32_t);
+    if (interactions || options->reorderInterval > 0) {
+        // Note: Up to two keys per particle, each with range and count
+        perParticle += 2 * 3 * sizeof(uint32_t);
+    }
+    if (interactions) {
+        perParticle += 4 * sizeof(float) + sizeof(uint32_t);
+    }
+    if (options->reorderInterval > 0) {
+        perParticle += sizeof(uint32_t);
+    }
+    VkDeviceSize total = (VkDeviceSize)particleCount * perParticle +
+        MAX_FRAMES_IN_FLIGHT * bucketCountsSize(particleCount);
+    if (options->sparksPerBurst > 0) {
+        const VkDeviceSize sparkCapacity = options->sparkCapacity > 0 ?
+            options->sparkCapacity :
+            (VkDeviceSize)particleCount * options->sparksPerBurst;
+        total += MAX_FRAMES_IN_FLIGHT * sparkCapacity * sizeof(Particle);
+    }
+    
+    // Tile rasterizer output, color image if multisampled or accumulating
+    // trails, offscreen render targets
+    const VkDeviceSize pixelCount = (VkDeviceSize)options->width * options->height;
+    VkDeviceSize perPixel = sizeof(uint32_t);
+    if (samples != VK_SAMPLE_COUNT_1_BIT || trailsEnabled(graphics)) {
+        perPixel += (VkDeviceSize)samples * sizeof(uint32_t);
+    }
+    if (options->headless) {
+        perPixel += MAX_FRAMES_IN_FLIGHT * sizeof(uint32_t);
+    }
+    total += pixelCount * perPixel;
+    if (options->quality != QUALITY_LOW) {
+        // Half float texels of bloom pyramid, mip levels add a third
+        const VkDeviceSize scale = options->bloomScale;
+        total += pixelCount / (scale * scale) * 4 * sizeof(uint16_t) * 4 / 3;
+    }
+    return total;
+}
+
+// Lower #MSAA samples (which also shrinks the trail image) and then
+// #particles until estimated allocations fit remaining memory budget
+static void fitMemoryBudget(Graphics graphics)
+{
+    const double MIB = 1024.0 * 1024.0;
+    MemoryStats stats;
+    memoryGetStats(&stats);
+    const VkDeviceSize available =
+        stats.budget > stats.usage ? stats.budget - stats.usage : 0;
+    
+    const VkSampleCountFlags counts =
+        graphics->deviceProperties.limits.framebufferColorSampleCounts;
+    VkSampleCountFlagBits samples = graphics->msaaSamples;
+    uint32_t particleCount = graphics->options.particleCount;
+    while (samples != VK_SAMPLE_COUNT_1_BIT &&
+        estimateDeviceMemory(graphics, particleCount, samples) > available)
+    {
+        // Next lower supported count (single sample is always supported)
+        do {
+            samples = (VkSampleCountFlagBits)(samples >> 1);
+        } while (!(counts & samples));
+    }
+    while (particleCount > MIN_BUDGET_PARTICLES &&
+        estimateDeviceMemory(graphics, particleCount, samples) > available)
+    {
+        particleCount = particleCount / 2 > MIN_BUDGET_PARTICLES ?
+            particleCount / 2 : MIN_BUDGET_PARTICLES;
+    }
+    
+    if (samples != graphics->msaaSamples ||
+        particleCount != graphics->options.particleCount)
+    {
+        fprintf(stderr, "Exceeding device memory budget (%.1f of %.1f MiB "
+            "available), using %ux MSAA instead of %ux and %u instead of %u "
+            "particles\n", available / MIB, stats.budget / MIB,
+            (uint32_t)samples, (uint32_t)graphics->msaaSamples,
+            particleCount, graphics->options.particleCount);
+        graphics->msaaSamples = samples;
+        graphics->options.particleCount = particleCount;
+    }
+    const VkDeviceSize estimate =
+        estimateDeviceMemory(graphics, particleCount, samples);
+    if (estimate > available) {
+        fprintf(stderr, "Estimated %.1f MiB of device memory exceed budget "
+            "(%.1f MiB available), allocations may fail\n",
+            estimate / MIB, available / MIB);
+    }
+}
+
 static void initVulkan(Graphics graphics)
 {    
     initInstance(graphics);
-    // Initialize surface handle
-    CHK_VK_ERR(glfwCreateWindowSurface(graphics->instance, graphics->window,
-        NULL, &graphics->surface), "Failed to create GLFW window surface\n");
+    // Initialize surface handle (nothing to present to when headless)
+    if (!graphics->options.headless) {
+        CHK_VK_ERR(glfwCreateWindowSurface(graphics->instance, graphics->window,
+            NULL, &graphics->surface), "Failed to create GLFW window surface\n");
+    }
     // Select suitable physical device (GPU):
     // This initializes associated queue family indices and 
     // swap chain support details, as well as the #MSAA samples to use
     selectPhysicalDevice(graphics);
     // Initializes device, graphicsQueue and presentQueue
     initLogicalDevice(graphics);
+    memoryInit(graphics->physicalDevice, graphics->memoryBudget);
+    // Lower #MSAA samples and #particles until allocations fit
+    fitMemoryBudget(graphics);
     // Fills most of swapChainData struct
-    createSwapChain(graphics);
-    // Initialize render pass
-    createRenderPass(graphics);
-    // Initialize framebuffers contained in swapChainData
-    createFramebuffers(graphics);
+    if (graphics->options.headless) {
+        createOffscreenImages(graphics);
+    } else {
+        createSwapChain(graphics);
+    }
+    if (!graphics->dynamicRendering) {
+        // Initialize render pass
+        createRenderPass(graphics);
+        // Initialize framebuffers contained in swapChainData
+        createFramebuffers(graphics);
+    }
     // Initialize descriptorData
     createDescriptorResources(graphics);
     // Create graphicsPipeline along with its pipelineLayout
     createGraphicsPipeline(graphics);
+    if (trailsEnabled(graphics)) {
+        createTrailPipeline(graphics);
+    }
     // Initialize command pool and command buffer objects
     createCommandResources(graphics);
-    // Create a star
-    const Star star = geomMakeStar(0.0f, 0.0f, 0.05f);
-    // Initialize vertexData
-    createVertexBuffer(graphics, star.vertices, N_VERTICES_STAR);
-    // Initialize indexData
-    createIndexBuffer(graphics, star.indices, N_INDICES_STAR);
     // Initialize uniform buffers
     createUniformBuffers(graphics);
     // Initialize shaderStorage
     createShaderStorage(graphics);
+    // Initialize shape arena and per-shape draws
+    createShapeBuffers(graphics);
     // Initialize sync
     createSyncObjects(graphics);
 }
 
-Graphics initGraphics()
+// Fill particles of first step on GPU by reset branch of update dispatch
+// Note: Requires all compute bindings (see initNeighborGrid(), initSparks())
+static void initParticles(Graphics graphics)
+{
+    // First step reads particles of last frame slot (see createShaderStorage())
+    const uint32_t frame = MAX_FRAMES_IN_FLIGHT - 1;
+    
+    // Note: Reset time elapsed -> update takes reset branch for all particles,
+    //       random numbers of show 0 keep shows reproducible (see --seed)
+    ParameterBufferObject pbo = {0};
+    pbo.elapsedTime = (float)ANIMATION_RESET_TIME;
+    pbo.animationResetTime = (float)ANIMATION_RESET_TIME;
+    pbo.randomSeed = graphics->options.seed;
+    pbo.particleCount = graphics->options.particleCount;
+    pbo.interactionRadius = graphics->options.interactionRadius;
+    pbo.gridCellCount = graphics->grid->cellCount;
+    pbo.sparkCapacity = graphics->sparks->capacity;
+    pbo.initShapeMask = graphics->options.shapeMask;
+    memcpy(graphics->deltaTimeUniform.mapped[frame], &pbo, sizeof(pbo));
+    
+    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
+    vkCmdBindPipeline(commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE, graphics->computePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        graphics->computePipelineLayout, 0, 1,
+        &graphics->computeDescriptor.sets[frame], 0, NULL);
+    const uint32_t workgroupSize = graphics->options.workgroupSize;
+    vkCmdDispatch(commandBuffer,
+        (graphics->options.particleCount + workgroupSize - 1) / workgroupSize, 1, 1);
+    
+    // Make particles visible to all later submissions (same queue)
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    endSingleUseCommands(graphics, commandBuffer);
+}
+
+Graphics initGraphics(const Options *options)
 {
+    assert(options && "Expected non-NULL options");
+    
     Graphics graphics = NULL;
     // Allocate graphics handle and initialize to 0
     CHK_ALLOC(graphics = (Graphics) calloc(1, sizeof(GraphicsData)));
+    graphics->options = *options;
     
     // Initialize start time
-    graphics->lastFrameTime = glfwGetTime();
+    graphics->timerStart = timerSeconds();
+    graphics->lastFrameTime = 0.0;
     
-    // Seed random engine using current time
-    srand(time(NULL));
+    FILE *exportStream = NULL;
+    if (graphics->options.exportPath) {
+        // Note: Opened first, since exporting to stdout redirects printf()
+        exportStream = openOutputFile(graphics->options.exportPath);
+    }
+    if (graphics->options.restorePath) {
+        // Note: Adopts particle count of snapshot before buffers are sized
+        graphics->snapshot = openSnapshot(graphics->options.restorePath,
+            &graphics->options);
+    }
     
-    initWindow(graphics);
+    if (!graphics->options.headless) {
+        initWindow(graphics);
+    }
     initVulkan(graphics);
+    initTileRasterizer(graphics);
+    initNeighborGrid(graphics);
+    initSparks(graphics);
+    if (graphics->snapshot) {
+        restoreSnapshot(graphics);
+    } else {
+        initParticles(graphics);
+    }
+    initBloom(graphics);
+    
+    initProfiler(graphics);
+    initRenderGraph(graphics);
+    if (exportStream) {
+        initExporter(graphics, exportStream);
+    }
+    if (graphics->options.streamName) {
+        initStream(graphics);
+    }
     
     return graphics;
 }
 
+// Queue presentation of rendered swapchain image to surface
+static void presentImage(Graphics graphics, uint32_t imageIndex)
+{
+    VkPresentInfoKHR presentInfo = {0};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = 
+        &graphics->sync.renderFinishedSemaphores[graphics->currentFrame];
+    
+    // Specify swapchain(s) to present images to
+    const VkSwapchainKHR swapchains[] = {
+        graphics->swapChainData.swapChain
+    };
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = swapchains;
+    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.pResults = NULL;  // optional error handling for individual swapchains
+    
+    const VkResult result = vkQueuePresentKHR(graphics->presentQueue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || 
+        result == VK_SUBOPTIMAL_KHR ||
+        graphics->framebufferResized)
+    {
+        graphics->framebufferResized = VK_FALSE;
+        recreateSwapChain(graphics);
+    } else if (result != VK_SUCCESS) {
+        fprintf(stderr, "Failed to present swapchain image\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
 static void draw(Graphics graphics)
 {
+    profilerBeginFrame(graphics);
+    
     // - Compute submission
+    profilerBeginPhase(graphics, "wait compute fence");
     CHK_VK_ERR(vkWaitForFences(graphics->device, 1,
         &graphics->sync.computeInFlightFences[graphics->currentFrame],
         VK_TRUE, UINT64_MAX),
         "Failed to wait for computeInFlightFence of current frame\n");
+    profilerEndPhase(graphics, CPU_PHASE_FENCE_WAIT);
+    // Compute pass of this slot completed -> read back before re-recording
+    profilerCollect(graphics, GPU_PASS_GRID);
+    profilerCollect(graphics, GPU_PASS_COMPUTE);
+    sparksCollect(graphics);
+    if (graphics->stream) {
+        streamPoll(graphics,
+            graphics->sync.computeInFlightFences[graphics->currentFrame]);
+    }
     
+    profilerBeginPhase(graphics, "record compute");
     // Update shader buffers ahead of shader stages
     updateShaderBuffers(graphics);
+    buildFrameGraph(graphics);
     
     // Reset fence to unsignalled state
     vkResetFences(graphics->device, 1, 
@@ -1963,6 +3156,7 @@ static void draw(Graphics graphics)
     // Record compute commands to computeComandBuffer
     recordComputeCommandBuffer(graphics, 
         graphics->computeCommandBuffers[graphics->currentFrame]);
+    profilerEndPhase(graphics, CPU_PHASE_RECORD);
     
     // Submit recorded command buffer to queue
     VkSubmitInfo submitInfo = {0};
@@ -1975,36 +3169,54 @@ static void draw(Graphics graphics)
     submitInfo.pSignalSemaphores = 
         &graphics->sync.computeFinishedSemaphores[graphics->currentFrame];
     
+    profilerBeginPhase(graphics, "submit compute");
     CHK_VK_ERR(vkQueueSubmit(graphics->computeQueue, 1, &submitInfo,
         graphics->sync.computeInFlightFences[graphics->currentFrame]),
         "Failed to submit compute command buffer\n");
+    profilerEndPhase(graphics, CPU_PHASE_SUBMIT);
     
     // Note: currentFrame is initialized to 0 in initGraphics()
     // Wait for previous frame to finish
+    profilerBeginPhase(graphics, "wait frame fence");
     CHK_VK_ERR(vkWaitForFences(graphics->device, 1, 
         &graphics->sync.inFlightFences[graphics->currentFrame], VK_TRUE,
         UINT64_MAX), "Failed to wait for inFlightFence of current frame\n");
+    profilerEndPhase(graphics, CPU_PHASE_FENCE_WAIT);
+    profilerCollect(graphics, GPU_PASS_RENDER);
+    profilerCollect(graphics, GPU_PASS_BLOOM);
+    
+    if (graphics->exporter) {
+        // Frames captured MAX_FRAMES_IN_FLIGHT ago are complete now
+        exportPollFrames(graphics, 
+            graphics->sync.inFlightFences[graphics->currentFrame]);
+    }
     
+    const VkBool32 headless = graphics->options.headless;
     // Obtain index to next image in swapchain, as it becomes presentable
-    uint32_t imageIndex = 0;
-    VkResult result;
-    result = vkAcquireNextImageKHR(graphics->device, 
-        graphics->swapChainData.swapChain, UINT64_MAX, 
-        graphics->sync.imageAvailableSemaphores[graphics->currentFrame],
-        VK_NULL_HANDLE, &imageIndex);
-    
-    // Note: VK_SUBOPTIMAL_KHR means swapchain no longer matches surface
-    //       properties, but CAN still be used to present image to surface
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        // Current swapchain is no longer adequate (e.g. due to resize)
-        recreateSwapChain(graphics);
-        return;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        fprintf(stderr, "Failed to acquire swapchain image\n");
-        exit(EXIT_FAILURE);
+    // Note: Offscreen image of current frame is free once its fence signalled
+    uint32_t imageIndex = graphics->currentFrame;
+    if (!headless) {
+        profilerBeginPhase(graphics, "acquire image");
+        const VkResult result = vkAcquireNextImageKHR(graphics->device, 
+            graphics->swapChainData.swapChain, UINT64_MAX, 
+            graphics->sync.imageAvailableSemaphores[graphics->currentFrame],
+            VK_NULL_HANDLE, &imageIndex);
+        profilerEndPhase(graphics, CPU_PHASE_ACQUIRE);
+        
+        // Note: VK_SUBOPTIMAL_KHR means swapchain no longer matches surface
+        //       properties, but CAN still be used to present image to surface
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Current swapchain is no longer adequate (e.g. due to resize)
+            recreateSwapChain(graphics);
+            return;
+        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            fprintf(stderr, "Failed to acquire swapchain image\n");
+            exit(EXIT_FAILURE);
+        }
     }
     
     // - Graphics submission
+    profilerBeginPhase(graphics, "record render");
     // Reset fence to unsignalled state
     vkResetFences(graphics->device, 1, 
         &graphics->sync.inFlightFences[graphics->currentFrame]);
@@ -2012,119 +3224,159 @@ static void draw(Graphics graphics)
     vkResetCommandBuffer(graphics->commandBuffers[graphics->currentFrame], 0);
     // Record rendering commands to commandBuffer
     recordCommandBuffer(graphics, graphics->commandBuffers[graphics->currentFrame], imageIndex);
+    profilerEndPhase(graphics, CPU_PHASE_RECORD);
     
-    // Wait on imageAvailable semaphore during COLOR_ATTACHMENT_OUTPUT_BIT
-    // pipeline stage
+    // Wait on compute results and imageAvailable semaphore
     const VkSemaphore waitSemaphores[] = {
         graphics->sync.computeFinishedSemaphores[graphics->currentFrame],
         graphics->sync.imageAvailableSemaphores[graphics->currentFrame]
     };
+    // Note: Stages of first passes using compute results and swapchain
+    //       image (see renderGraphCompile())
     const VkPipelineStageFlags waitStages[] = {
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+        graphics->renderGraph->computeWaitStages,
+        graphics->renderGraph->acquireWaitStages
     };
     submitInfo = (VkSubmitInfo) {0};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
-    submitInfo.waitSemaphoreCount = 2;
+    // Note: No image to wait on for offscreen rendering
+    submitInfo.waitSemaphoreCount = headless ? 1 : 2;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &graphics->commandBuffers[graphics->currentFrame];
     
     // Signal renderFinished semaphore once commandBuffer has finished
-    // execution
+    // execution (awaited by presentImage())
     const VkSemaphore signalSemaphores[] = {
         graphics->sync.renderFinishedSemaphores[graphics->currentFrame]
     }; 
-    submitInfo.signalSemaphoreCount = 1;
+    // Note: Offscreen images are not presented -> nobody waits on semaphore
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
     
     // After MAX_FRAMES_IN_FLIGHT, CPU waits for command buffer to finish execution
     // due to inFlightFence
+    profilerBeginPhase(graphics, "submit render");
     CHK_VK_ERR(vkQueueSubmit(graphics->graphicsQueue, 1, &submitInfo,
         graphics->sync.inFlightFences[graphics->currentFrame]),
         "Failed to submit draw command buffer\n");
+    profilerEndPhase(graphics, CPU_PHASE_SUBMIT);
     
-    // Presentation of image to surface
-    VkPresentInfoKHR presentInfo = {0};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-    
-    // Specify swapchain(s) to present images to
-    const VkSwapchainKHR swapchains[] = {
-        graphics->swapChainData.swapChain
-    };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapchains;
-    presentInfo.pImageIndices = &imageIndex;
-    presentInfo.pResults = NULL;  // optional error handling for individual swapchains
-    
-    result = vkQueuePresentKHR(graphics->presentQueue, &presentInfo);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || 
-        result == VK_SUBOPTIMAL_KHR ||
-        graphics->framebufferResized)
-    {
-        graphics->framebufferResized = VK_FALSE;
-        recreateSwapChain(graphics);
-    } else if (result != VK_SUCCESS) {
-        fprintf(stderr, "Failed to present swapchain image\n");
-        exit(EXIT_FAILURE);
+    if (!headless) {
+        profilerBeginPhase(graphics, "present");
+        presentImage(graphics, imageIndex);
+        profilerEndPhase(graphics, CPU_PHASE_PRESENT);
     }
+    profilerEndFrame(graphics);
     // Move to next frame
+    graphics->frameCounter++;
     graphics->currentFrame = (graphics->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+VkBool32 renderFrame(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    if (!graphics->options.headless) {
+        TRACE_SCOPE("poll events");
+        if (glfwWindowShouldClose(graphics->window)) {
+            return VK_FALSE;
+        }
+        glfwPollEvents();
+    }
+    if (graphics->snapshotRequested) {
+        // Note: Stalls once, so no frame is in flight while reading back
+        vkDeviceWaitIdle(graphics->device);
+        saveSnapshot(graphics, graphics->options.snapshotPath);
+        graphics->snapshotRequested = VK_FALSE;
+    }
+    draw(graphics);  // draw next frame to surface (or offscreen image)
+    return VK_TRUE;
+}
+
 // Main rendering loop
 void renderLoop(Graphics graphics)
 {
     assert(graphics && "Expected non-NULL graphics handle");
     
-    while (!glfwWindowShouldClose(graphics->window)) {
-        glfwPollEvents();
-        draw(graphics);  // draw next frame to surface
+    const Options *options = &graphics->options;
+    while (options->frameCount == 0 || graphics->frameCounter < options->frameCount) {
+        if (!renderFrame(graphics)) {
+            break;
+        }
     }
     // Wait for device to finish all operations before exiting (cleanup)
     vkDeviceWaitIdle(graphics->device);
+    if (options->snapshotPath) {
+        saveSnapshot(graphics, options->snapshotPath);
+    }
 }
 
 void cleanupGraphics(Graphics graphics)
 {
     assert(graphics && "Expected non-NULL graphics handle");
     
+    // Flush exported frames (device is idle after renderLoop())
+    if (graphics->exporter) {
+        cleanupExporter(graphics);
+    }
+    if (graphics->stream) {
+        cleanupStream(graphics);
+    }
+    cleanupProfiler(graphics);
+    cleanupRenderGraph(graphics);
+    cleanupTileRasterizer(graphics);
+    cleanupNeighborGrid(graphics);
+    cleanupSparks(graphics);
+    cleanupBloom(graphics);
+    
     // Cleanup swapchain
     cleanupSwapChain(graphics);
     
-    // Cleanup vertex buffer
-    vkDestroyBuffer(graphics->device, graphics->vertexData.buffer, NULL);
-    vkFreeMemory(graphics->device, graphics->vertexData.memory, NULL);
-    // Cleanup index buffer
-    vkDestroyBuffer(graphics->device, graphics->indexData.buffer, NULL);
-    vkFreeMemory(graphics->device, graphics->indexData.memory, NULL);
     // Cleanup uniform buffers & shader storage buffers
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
         vkDestroyBuffer(graphics->device, graphics->mvpUniform.buffers[i], NULL);
-        vkFreeMemory(graphics->device, graphics->mvpUniform.memories[i], NULL);
+        freeMemory(graphics->device, graphics->mvpUniform.memories[i]);
         
         vkDestroyBuffer(graphics->device, graphics->deltaTimeUniform.buffers[i], NULL);
-        vkFreeMemory(graphics->device, graphics->deltaTimeUniform.memories[i], NULL);
+        freeMemory(graphics->device, graphics->deltaTimeUniform.memories[i]);
         
-        vkDestroyBuffer(graphics->device, graphics->shaderStorage.buffers[i], NULL);
-        vkFreeMemory(graphics->device, graphics->shaderStorage.memories[i], NULL);
+        // Note: Aliased buffers of in-place mode own no memory
+        if (graphics->shaderStorage.memories[i] != VK_NULL_HANDLE) {
+            vkDestroyBuffer(graphics->device, graphics->shaderStorage.buffers[i], NULL);
+            freeMemory(graphics->device, graphics->shaderStorage.memories[i]);
+        }
+        
+        vkDestroyBuffer(graphics->device, graphics->drawCommands.buffers[i], NULL);
+        freeMemory(graphics->device, graphics->drawCommands.memories[i]);
+        
+        vkDestroyBuffer(graphics->device, graphics->shapeInstances.buffers[i], NULL);
+        freeMemory(graphics->device, graphics->shapeInstances.memories[i]);
     }
+    // Cleanup shape arena
+    vkDestroyBuffer(graphics->device, graphics->shapeVertices.buffer, NULL);
+    freeMemory(graphics->device, graphics->shapeVertices.memory);
+    vkDestroyBuffer(graphics->device, graphics->shapeIndices.buffer, NULL);
+    freeMemory(graphics->device, graphics->shapeIndices.memory);
     // Cleanup synchronization objects
     cleanupSyncObjects(graphics);
     
     // Cleanup command pool
     vkDestroyCommandPool(graphics->device, graphics->commandPool, NULL);
     
-    // Destroy graphics pipeline
-    vkDestroyPipeline(graphics->device, graphics->graphicsPipeline, NULL);
+    // Destroy graphics pipelines
+    for (uint32_t i = 0; i < STAR_LOD_COUNT; ++i) {
+        vkDestroyPipeline(graphics->device, graphics->graphicsPipelines[i], NULL);
+    }
+    vkDestroyPipeline(graphics->device, graphics->trailPipeline, NULL);
     vkDestroyPipelineLayout(graphics->device, graphics->pipelineLayout, NULL);
     // Destroy compute pipeline
     vkDestroyPipeline(graphics->device, graphics->computePipeline, NULL);
     vkDestroyPipelineLayout(graphics->device, graphics->computePipelineLayout, NULL);
+    vkDestroyPipeline(graphics->device, graphics->bucketPipeline, NULL);
+    vkDestroyPipelineLayout(graphics->device, graphics->bucketPipelineLayout, NULL);
     
     // Cleanup descriptor set resources
     cleanupDescriptorResources(graphics);
@@ -2133,16 +3385,21 @@ void cleanupGraphics(Graphics graphics)
     vkDestroyRenderPass(graphics->device, graphics->renderPass, NULL);
     // Destroy logical device (wait until device is idle first)
     vkDestroyDevice(graphics->device, NULL);
+    memoryShutdown();
     
     if (ENABLE_VALIDATION_LAYERS) {
         destroyDebugUtilsMessengerEXT(graphics->instance, 
             graphics->debugMessenger, NULL);
     }
-    vkDestroySurfaceKHR(graphics->instance, graphics->surface, NULL);
+    if (!graphics->options.headless) {
+        vkDestroySurfaceKHR(graphics->instance, graphics->surface, NULL);
+    }
     vkDestroyInstance(graphics->instance, NULL);
     
-    glfwDestroyWindow(graphics->window);
-    glfwTerminate();
+    if (!graphics->options.headless) {
+        glfwDestroyWindow(graphics->window);
+        glfwTerminate();
+    }
     
     free(graphics);
 }
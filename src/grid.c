@@ -0,0 +1,222 @@
+#include "grid.h"
+#include "vkutils.h"
+
+static void createPipelines(Graphics graphics)
+{
+    NeighborGrid *grid = graphics->grid;
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/grid.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    // Note: Passes share descriptor sets with update dispatch (see shader.comp)
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = graphics->computePipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    
+    // Note: Pass and key are selected by specialization constants 0 and 1
+    const VkSpecializationMapEntry specEntries[2] = {
+        { 0, 0, sizeof(uint32_t) },
+        { 1, sizeof(uint32_t), sizeof(uint32_t) }
+    };
+    for (uint32_t key = 0; key < GRID_KEY_COUNT; ++key) {
+        for (uint32_t pass = 0; pass < GRID_PASS_COUNT; ++pass) {
+            const uint32_t specData[2] = { pass, key };
+            VkSpecializationInfo specInfo = {0};
+            specInfo.mapEntryCount = 2;
+            specInfo.pMapEntries = specEntries;
+            specInfo.dataSize = sizeof(specData);
+            specInfo.pData = specData;
+            pipelineInfo.stage.pSpecializationInfo = &specInfo;
+            
+            CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE,
+                1, &pipelineInfo, NULL, &grid->pipelines[key][pass]),
+                "Failed to create grid pipeline\n");
+        }
+    }
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+static void createGridBuffer(Graphics graphics, VkDeviceSize size,
+    VkBufferUsageFlags usage, uint32_t binding, BufferResource *resource)
+{
+    createBuffer(graphics->device, graphics->physicalDevice, size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &resource->buffer, &resource->memory, MEMORY_PARTICLES);
+    
+    VkDescriptorBufferInfo bufferInfo = {0};
+    bufferInfo.buffer = resource->buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    
+    VkWriteDescriptorSet descriptorWrites[MAX_FRAMES_IN_FLIGHT] = {0};
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = graphics->computeDescriptor.sets[i];
+        descriptorWrites[i].dstBinding = binding;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfo;
+    }
+    vkUpdateDescriptorSets(graphics->device, MAX_FRAMES_IN_FLIGHT,
+        descriptorWrites, 0, NULL);
+}
+
+static void cleanupGridBuffer(Graphics graphics, BufferResource *resource)
+{
+    vkDestroyBuffer(graphics->device, resource->buffer, NULL);
+    freeMemory(graphics->device, resource->memory);
+    *resource = (BufferResource) {0};
+}
+
+void initNeighborGrid(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    NeighborGrid *grid = NULL;
+    CHK_ALLOC(grid = calloc(1, sizeof(NeighborGrid)));
+    graphics->grid = grid;
+    
+    createPipelines(graphics);
+    
+    grid->interactions = graphics->options.interactionStrength != 0.0f;
+    grid->reorderInterval = graphics->options.reorderInterval;
+    const uint32_t particleCount = graphics->options.particleCount;
+    
+    // Note: At least one key per particle keeps cells sharing keys rare,
+    //       #keys is a power of 2 since keys are masked (see gridKey())
+    uint64_t cellCount = GRID_SCAN_BLOCK_SIZE;
+    if (grid->interactions || grid->reorderInterval > 0) {
+        const uint64_t maxCellCount =
+            graphics->deviceProperties.limits.maxStorageBufferRange / (2 * sizeof(uint32_t));
+        while (cellCount < particleCount && 2 * cellCount <= maxCellCount) {
+            cellCount *= 2;
+        }
+    }
+    grid->cellCount = (uint32_t)cellCount;
+    const uint64_t gridCapacity = grid->interactions ? particleCount : 1;
+    const uint64_t orderCapacity = grid->reorderInterval > 0 ? particleCount : 1;
+    
+    // Note: Bindings must be valid even if grid is never built
+    createGridBuffer(graphics, cellCount * 2 * sizeof(uint32_t), 0,
+        GRID_BINDING_CELLS, &grid->cellRanges);
+    createGridBuffer(graphics, gridCapacity * 4 * sizeof(float), 0,
+        GRID_BINDING_PARTICLES, &grid->particles);
+    createGridBuffer(graphics, gridCapacity * sizeof(uint32_t), 0,
+        GRID_BINDING_INDICES, &grid->indices);
+    createGridBuffer(graphics, cellCount * sizeof(uint32_t),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT, GRID_BINDING_COUNTS, &grid->counts);
+    createGridBuffer(graphics,
+        cellCount / GRID_SCAN_BLOCK_SIZE * sizeof(uint32_t), 0,
+        GRID_BINDING_BLOCKS, &grid->blockSums);
+    createGridBuffer(graphics, orderCapacity * sizeof(uint32_t), 0,
+        GRID_BINDING_ORDER, &grid->order);
+}
+
+VkBool32 gridSelectReorder(Graphics graphics)
+{
+    const NeighborGrid *grid = graphics->grid;
+    // Note: Positions change little between frames, so the order decays
+    //       slowly and is restored periodically
+    return grid->reorderInterval > 0 && !grid->reorderPaused &&
+        graphics->frameCounter % grid->reorderInterval == 0;
+}
+
+// Wait for writes of previous pass before reading/writing grid again
+static void passBarrier(VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+void gridRecordBuild(Graphics graphics, VkCommandBuffer commandBuffer,
+    GridKey key)
+{
+    NeighborGrid *grid = graphics->grid;
+    VkPipeline *pipelines = grid->pipelines[key];
+    
+    // Previous sort or update may still use tables (same queue)
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        1, &barrier, 0, NULL, 0, NULL);
+    
+    vkCmdFillBuffer(commandBuffer, grid->counts.buffer, 0, VK_WHOLE_SIZE, 0);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        graphics->computePipelineLayout, 0, 1,
+        &graphics->computeDescriptor.sets[graphics->currentFrame], 0, NULL);
+    
+    // Note: 256 invocations per work group, 1 per particle or 4 per cell key
+    const uint32_t particleGroups = (graphics->options.particleCount + 255) / 256;
+    const uint32_t blockCount = grid->cellCount / GRID_SCAN_BLOCK_SIZE;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[GRID_PASS_BIN]);
+    vkCmdDispatch(commandBuffer, particleGroups, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[GRID_PASS_SCAN_BLOCKS]);
+    vkCmdDispatch(commandBuffer, blockCount, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[GRID_PASS_SCAN_SUMS]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[GRID_PASS_SPREAD]);
+    vkCmdDispatch(commandBuffer, blockCount, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipelines[GRID_PASS_SCATTER]);
+    vkCmdDispatch(commandBuffer, particleGroups, 1, 1);
+}
+
+void cleanupNeighborGrid(Graphics graphics)
+{
+    NeighborGrid *grid = graphics->grid;
+    if (!grid) {
+        return;
+    }
+    
+    cleanupGridBuffer(graphics, &grid->cellRanges);
+    cleanupGridBuffer(graphics, &grid->particles);
+    cleanupGridBuffer(graphics, &grid->indices);
+    cleanupGridBuffer(graphics, &grid->counts);
+    cleanupGridBuffer(graphics, &grid->blockSums);
+    cleanupGridBuffer(graphics, &grid->order);
+    for (uint32_t key = 0; key < GRID_KEY_COUNT; ++key) {
+        for (uint32_t pass = 0; pass < GRID_PASS_COUNT; ++pass) {
+            vkDestroyPipeline(graphics->device, grid->pipelines[key][pass], NULL);
+        }
+    }
+    
+    FREE_NULL(graphics->grid);
+}
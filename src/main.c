@@ -1,12 +1,27 @@
 #include "graphics.h"
+#include "benchmark.h"
+#include "trace.h"
 
-int main(void)
+int main(int argc, char **argv)
 {
-    Graphics graphics = initGraphics();
+    Options options;
+    parseOptions(argc, argv, &options);
     
-    renderLoop(graphics);
+    traceInit(options.tracePath);
+    traceSetThreadName("main");
     
-    cleanupGraphics(graphics);
+    if (options.benchmark) {
+        runBenchmark(&options);
+    } else {
+        Graphics graphics = initGraphics(&options);
+        
+        renderLoop(graphics);
+        
+        cleanupGraphics(graphics);
+    }
+    
+    // Note: Export writer thread has been joined by cleanupGraphics()
+    traceShutdown();
         
     return EXIT_SUCCESS;
 }
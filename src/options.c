@@ -0,0 +1,642 @@
+#include "options.h"
+#include "graphics.h"
+#include "profile.h"
+#include "stream.h"
+
+#include <string.h>
+#include <signal.h>  // signal(), SIGPIPE
+#include <unistd.h>  // dup(), dup2()
+#include <time.h>    // time()
+#include <math.h>    // isfinite()
+
+// Frames rendered in headless mode if none were requested explicitly
+#define DEFAULT_HEADLESS_FRAMES 600
+#define DEFAULT_EXPORT_FPS 60
+#define DEFAULT_EXPORT_RING_SIZE 4
+#define DEFAULT_BENCH_FRAMES 1000
+#define DEFAULT_BENCH_WARMUP 120
+// Star diameters in pixels at which geometry changes (see RenderMode)
+#define DEFAULT_LOD_MESH_SIZE 64.0f
+#define DEFAULT_LOD_POINT_SIZE 4.0f
+// #particles from which small stars are drawn by tile rasterizer
+#define DEFAULT_TILE_THRESHOLD (1u << 20)
+// Range of particle interactions (see --interaction)
+#define DEFAULT_INTERACTION_RADIUS 0.02f
+// Bloom pyramid starting at half resolution (see bloom.c)
+#define DEFAULT_BLOOM_LEVELS 5
+#define DEFAULT_BLOOM_SCALE 2
+#define MAX_BLOOM_LEVELS 8  // see BLOOM_MAX_LEVELS in bloom.h
+#define MAX_SPARKS_PER_BURST 64
+#define MAX_WORKGROUP_SIZE 1024  // minimum of maxComputeWorkGroupInvocations
+// Environment variable selecting device like --device
+#define DEVICE_ENV "FIREWORKS_DEVICE"
+// Simulated time step of benchmark runs (same workload on every machine)
+#define BENCH_TIME_STEP (1.0 / 60.0)
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --headless         render offscreen (no window or display server)\n");
+    printf("  --width <px>       window/offscreen width (default %u)\n", WINDOW_WIDTH);
+    printf("  --height <px>      window/offscreen height (default %u)\n", WINDOW_HEIGHT);
+    printf("  --device <sel>     use device by index, UUID or part of its name\n");
+    printf("                     (default: $%s, else highest scored)\n", DEVICE_ENV);
+    printf("  --device-probe     pick fastest device by timing particle kernel\n");
+    printf("  --frames <n>       exit after n frames (0 -> unlimited, default;\n");
+    printf("                     %u in headless mode)\n", DEFAULT_HEADLESS_FRAMES);
+    printf("  --export <file>    stream rendered frames to file ('-' for stdout)\n");
+    printf("  --export-format <raw|y4m>\n");
+    printf("                     raw RGBA8 or YUV4MPEG2 (default: from file name)\n");
+    printf("  --export-fps <n>   frame rate of export, fixes time step (default %u)\n",
+        DEFAULT_EXPORT_FPS);
+    printf("  --export-ring <n>  #readback buffers (default %u)\n", 
+        DEFAULT_EXPORT_RING_SIZE);
+    printf("  --export-drop      drop frames instead of stalling if ring is full\n");
+    printf("  --snapshot <file>  save particles, timer and seed to file on exit\n");
+    printf("                     (and on S key)\n");
+    printf("  --snapshot-quantize\n");
+    printf("                     store particles as half floats and RGBA8 (1/3 size)\n");
+    printf("  --restore <file>   resume show of snapshot, overrides --particles and\n");
+    printf("                     --seed\n");
+    printf("  --stream <name>    publish particles to POSIX shared memory (e.g. /fireworks)\n");
+    printf("  --stream-interval <n>\n");
+    printf("                     frames between captures (default 1)\n");
+    printf("  --stream-fields <position,velocity,color,orientation,shape>\n");
+    printf("                     streamed fields (default position,color)\n");
+    printf("  --particles <n,..> #particles (default %u), list is swept in benchmark\n",
+        N_PARTICLES);
+    printf("  --msaa <n,..>      max. MSAA samples (default: from profile),\n");
+    printf("                     list is swept in benchmark\n");
+    printf("  --profile <auto|high|balanced|cpu,..>\n");
+    printf("                     defaults of MSAA, render mode, quality, bloom scale\n");
+    printf("                     and work group size (default auto: by device type),\n");
+    printf("                     list is swept in benchmark\n");
+    printf("  --workgroup-size <n>\n");
+    printf("                     invocations per work group of particle update,\n");
+    printf("                     power of 2 up to %u (default: from profile)\n",
+        MAX_WORKGROUP_SIZE);
+    printf("  --seed <n>         seed of random engine (default: current time)\n");
+    printf("  --star-points <n>  #tips of stars, %u to %u (default %u)\n",
+        MIN_STAR_POINTS, MAX_STAR_POINTS, DEFAULT_STAR_POINTS);
+    printf("  --star-size <d>    distance from star center to tip (default %.2f)\n",
+        (double)DEFAULT_STAR_SIZE);
+    printf("  --shapes <s,..>    shapes of particles: star, polygon, ring, comet\n");
+    printf("                     (default star)\n");
+    printf("  --render-mode <auto|mesh|sdf>\n");
+    printf("                     star geometry (default: from profile, auto picks\n");
+    printf("                     by projected size)\n");
+    printf("  --lod-mesh <px>    min. star diameter drawn as mesh (default %.0f)\n",
+        (double)DEFAULT_LOD_MESH_SIZE);
+    printf("  --lod-point <px>   max. star diameter drawn as point (default %.0f)\n",
+        (double)DEFAULT_LOD_POINT_SIZE);
+    printf("  --rasterizer <auto|pipeline|tiles>\n");
+    printf("                     renderer (default auto: tiles if particles exceed\n");
+    printf("                     threshold and stars are drawn as SDF)\n");
+    printf("  --tile-threshold <n>\n");
+    printf("                     min. #particles drawn by tiles (default %u)\n",
+        DEFAULT_TILE_THRESHOLD);
+    printf("  --render-pass      draw with render pass and framebuffer objects even if\n");
+    printf("                     dynamic rendering is available\n");
+    printf("  --interaction <k>  pair force of particles, > 0 repels, < 0 clusters\n");
+    printf("                     (default 0: off)\n");
+    printf("  --interaction-radius <r>\n");
+    printf("                     range of pair force (default %.2f)\n",
+        (double)DEFAULT_INTERACTION_RADIUS);
+    printf("  --reorder <n,..>   sort particles by Morton code of position every\n");
+    printf("                     n frames (default 0: off), list is swept in benchmark\n");
+    printf("  --in-place         update single particle buffer in place instead of\n");
+    printf("                     one per frame in flight (excludes --reorder)\n");
+    printf("  --quality <auto|low|high>\n");
+    printf("                     low skips bloom (default: from profile)\n");
+    printf("  --bloom-levels <n> #levels of bloom pyramid, 1 to %u (default %u)\n",
+        MAX_BLOOM_LEVELS, DEFAULT_BLOOM_LEVELS);
+    printf("  --bloom-scale <n>  resolution divisor of first bloom level (default %u,\n",
+        DEFAULT_BLOOM_SCALE);
+    printf("                     or from profile)\n");
+    printf("  --trails <f>       keep fraction f of previous frame, 0 to < 1\n");
+    printf("                     (default 0: off)\n");
+    printf("  --sparks <n>       sparks emitted by every bursting star, up to %u\n",
+        MAX_SPARKS_PER_BURST);
+    printf("                     (default 0: off)\n");
+    printf("  --spark-capacity <n>\n");
+    printf("                     max. #live sparks, excess sparks are dropped\n");
+    printf("                     (default: sparks of one burst per star)\n");
+    printf("  --stats <s>        log CPU/GPU frame stats every s seconds\n");
+    printf("  --trace <file>     write Chrome/Perfetto trace of frame phases\n");
+    printf("  --benchmark        measure frame times for every particle/MSAA pair\n");
+    printf("  --bench-frames <n> #measured frames per configuration (default %u)\n",
+        DEFAULT_BENCH_FRAMES);
+    printf("  --bench-seconds <s>\n");
+    printf("                     measured duration per configuration (instead)\n");
+    printf("  --bench-warmup <n> #frames before measuring (default %u)\n",
+        DEFAULT_BENCH_WARMUP);
+    printf("  --bench-format <csv|json>\n");
+    printf("                     format of results (default csv)\n");
+    printf("  --bench-out <file> results file (default '-' for stdout)\n");
+    printf("  --help             show this message\n");
+}
+
+// Returns argument following flag at argv[*i] and advances *i
+static const char *nextArgument(int argc, char **argv, int *i)
+{
+    if (*i + 1 >= argc) {
+        fprintf(stderr, "Missing value for option '%s'\n", argv[*i]);
+        exit(EXIT_FAILURE);
+    }
+    return argv[++(*i)];
+}
+
+static uint64_t parseUnsigned(const char *flag, const char *value)
+{
+    char *end = NULL;
+    errno = 0;
+    const unsigned long long parsed = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || value[0] == '-') {
+        fprintf(stderr, "Invalid value '%s' for option '%s'\n", value, flag);
+        exit(EXIT_FAILURE);
+    }
+    return (uint64_t)parsed;
+}
+
+// Unsigned value that fits 32 bits (e.g. image dimensions)
+static uint32_t parseUnsigned32(const char *flag, const char *value)
+{
+    const uint64_t parsed = parseUnsigned(flag, value);
+    if (parsed > UINT32_MAX) {
+        fprintf(stderr, "Value '%s' for option '%s' is too large (max. %u)\n",
+            value, flag, UINT32_MAX);
+        exit(EXIT_FAILURE);
+    }
+    return (uint32_t)parsed;
+}
+
+static double parsePositiveDouble(const char *flag, const char *value)
+{
+    char *end = NULL;
+    errno = 0;
+    const double parsed = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || !(parsed > 0.0)) {
+        fprintf(stderr, "Invalid value '%s' for option '%s'\n", value, flag);
+        exit(EXIT_FAILURE);
+    }
+    return parsed;
+}
+
+static double parseDouble(const char *flag, const char *value)
+{
+    char *end = NULL;
+    errno = 0;
+    const double parsed = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || !isfinite(parsed)) {
+        fprintf(stderr, "Invalid value '%s' for option '%s'\n", value, flag);
+        exit(EXIT_FAILURE);
+    }
+    return parsed;
+}
+
+// Parse comma separated list of unsigned integers, returns #values
+static uint32_t parseList(const char *flag, const char *value,
+    uint32_t values[MAX_SWEEP_VALUES])
+{
+    char buffer[256];
+    if (strlen(value) >= sizeof(buffer)) {
+        fprintf(stderr, "Value of option '%s' is too long\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(buffer, value);
+    
+    uint32_t count = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(buffer, ",", &save); token;
+         token = strtok_r(NULL, ",", &save))
+    {
+        if (count == MAX_SWEEP_VALUES) {
+            fprintf(stderr, "Too many values for option '%s' (max. %u)\n", 
+                flag, MAX_SWEEP_VALUES);
+            exit(EXIT_FAILURE);
+        }
+        values[count++] = (uint32_t)parseUnsigned(flag, token);
+    }
+    
+    if (count == 0) {
+        fprintf(stderr, "Missing value for option '%s'\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    return count;
+}
+
+// Parse comma separated list of profile names, returns #values
+static uint32_t parseProfiles(const char *flag, const char *value,
+    ProfileKind values[MAX_SWEEP_VALUES])
+{
+    char buffer[256];
+    if (strlen(value) >= sizeof(buffer)) {
+        fprintf(stderr, "Value of option '%s' is too long\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(buffer, value);
+    
+    uint32_t count = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(buffer, ",", &save); token;
+         token = strtok_r(NULL, ",", &save))
+    {
+        if (count == MAX_SWEEP_VALUES) {
+            fprintf(stderr, "Too many values for option '%s' (max. %u)\n", 
+                flag, MAX_SWEEP_VALUES);
+            exit(EXIT_FAILURE);
+        }
+        const ProfileKind profile = profileFromName(token);
+        if (profile == PROFILE_COUNT) {
+            fprintf(stderr, "Unknown profile '%s'\n", token);
+            exit(EXIT_FAILURE);
+        }
+        values[count++] = profile;
+    }
+    
+    if (count == 0) {
+        fprintf(stderr, "Missing value for option '%s'\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    return count;
+}
+
+// Parse comma separated list of shape names, returns bit mask of shapes
+static uint32_t parseShapes(const char *flag, const char *value)
+{
+    char buffer[256];
+    if (strlen(value) >= sizeof(buffer)) {
+        fprintf(stderr, "Value of option '%s' is too long\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(buffer, value);
+    
+    uint32_t mask = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(buffer, ",", &save); token;
+         token = strtok_r(NULL, ",", &save))
+    {
+        const ShapeKind shape = geomShapeFromName(token);
+        if (shape == SHAPE_COUNT) {
+            fprintf(stderr, "Unknown shape '%s'\n", token);
+            exit(EXIT_FAILURE);
+        }
+        mask |= 1u << shape;
+    }
+    
+    if (mask == 0) {
+        fprintf(stderr, "Missing value for option '%s'\n", flag);
+        exit(EXIT_FAILURE);
+    }
+    return mask;
+}
+
+void parseOptions(int argc, char **argv, Options *options)
+{
+    assert(options && "Expected non-NULL options");
+    
+    *options = (Options) {0};
+    options->width = WINDOW_WIDTH;
+    options->height = WINDOW_HEIGHT;
+    options->device = getenv(DEVICE_ENV);
+    if (options->device && options->device[0] == '\0') {
+        options->device = NULL;
+    }
+    options->exportFps = DEFAULT_EXPORT_FPS;
+    options->exportRingSize = DEFAULT_EXPORT_RING_SIZE;
+    options->streamInterval = 1;
+    options->streamFields = (1u << STREAM_FIELD_POSITION) | (1u << STREAM_FIELD_COLOR);
+    options->seed = (uint32_t)time(NULL);
+    options->starPoints = DEFAULT_STAR_POINTS;
+    options->starSize = DEFAULT_STAR_SIZE;
+    options->shapeMask = 1u << SHAPE_STAR;
+    options->lodMeshSize = DEFAULT_LOD_MESH_SIZE;
+    options->lodPointSize = DEFAULT_LOD_POINT_SIZE;
+    options->tileThreshold = DEFAULT_TILE_THRESHOLD;
+    options->interactionRadius = DEFAULT_INTERACTION_RADIUS;
+    options->bloomLevels = DEFAULT_BLOOM_LEVELS;
+    options->bloomScale = DEFAULT_BLOOM_SCALE;
+    options->benchWarmup = DEFAULT_BENCH_WARMUP;
+    options->benchOutput = "-";
+    options->particleSweep[0] = N_PARTICLES;
+    options->particleSweepCount = 1;
+    options->msaaSweep[0] = 0;  // highest supported
+    options->msaaSweepCount = 1;
+    options->reorderSweep[0] = 0;  // off
+    options->reorderSweepCount = 1;
+    options->profileSweep[0] = PROFILE_AUTO;
+    options->profileSweepCount = 1;
+    
+    VkBool32 frameCountSet = VK_FALSE;
+    VkBool32 exportFormatSet = VK_FALSE;
+    for (int i = 1; i < argc; ++i) {
+        const char *flag = argv[i];
+        
+        if (strcmp(flag, "--headless") == 0) {
+            options->headless = VK_TRUE;
+        } else if (strcmp(flag, "--device") == 0) {
+            options->device = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--device-probe") == 0) {
+            options->deviceProbe = VK_TRUE;
+        } else if (strcmp(flag, "--width") == 0) {
+            options->width = parseUnsigned32(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--height") == 0) {
+            options->height = parseUnsigned32(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--frames") == 0) {
+            options->frameCount = parseUnsigned(flag, nextArgument(argc, argv, &i));
+            frameCountSet = VK_TRUE;
+        } else if (strcmp(flag, "--export") == 0) {
+            options->exportPath = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--export-format") == 0) {
+            const char *format = nextArgument(argc, argv, &i);
+            if (strcmp(format, "raw") == 0) {
+                options->exportFormat = EXPORT_FORMAT_RAW;
+            } else if (strcmp(format, "y4m") == 0) {
+                options->exportFormat = EXPORT_FORMAT_Y4M;
+            } else {
+                fprintf(stderr, "Unknown export format '%s'\n", format);
+                exit(EXIT_FAILURE);
+            }
+            exportFormatSet = VK_TRUE;
+        } else if (strcmp(flag, "--export-fps") == 0) {
+            options->exportFps = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--export-ring") == 0) {
+            options->exportRingSize = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--export-drop") == 0) {
+            options->exportDropFrames = VK_TRUE;
+        } else if (strcmp(flag, "--snapshot") == 0) {
+            options->snapshotPath = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--snapshot-quantize") == 0) {
+            options->snapshotQuantize = VK_TRUE;
+        } else if (strcmp(flag, "--restore") == 0) {
+            options->restorePath = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--stream") == 0) {
+            options->streamName = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--stream-interval") == 0) {
+            options->streamInterval = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+            if (options->streamInterval == 0) {
+                fprintf(stderr, "Stream interval must be at least 1\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(flag, "--stream-fields") == 0) {
+            const char *fields = nextArgument(argc, argv, &i);
+            options->streamFields = streamParseFields(fields);
+            if (options->streamFields == 0) {
+                fprintf(stderr, "Invalid stream fields '%s'\n", fields);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(flag, "--particles") == 0) {
+            options->particleSweepCount = parseList(flag, 
+                nextArgument(argc, argv, &i), options->particleSweep);
+        } else if (strcmp(flag, "--msaa") == 0) {
+            options->msaaSweepCount = parseList(flag, 
+                nextArgument(argc, argv, &i), options->msaaSweep);
+            options->profileOverrides |= PROFILE_OVERRIDE_MSAA;
+        } else if (strcmp(flag, "--profile") == 0) {
+            options->profileSweepCount = parseProfiles(flag,
+                nextArgument(argc, argv, &i), options->profileSweep);
+        } else if (strcmp(flag, "--workgroup-size") == 0) {
+            options->workgroupSize = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+            options->profileOverrides |= PROFILE_OVERRIDE_WORKGROUP;
+        } else if (strcmp(flag, "--seed") == 0) {
+            options->seed = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--star-points") == 0) {
+            options->starPoints = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--star-size") == 0) {
+            options->starSize = (float)parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--shapes") == 0) {
+            options->shapeMask = parseShapes(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--render-mode") == 0) {
+            const char *mode = nextArgument(argc, argv, &i);
+            if (strcmp(mode, "auto") == 0) {
+                options->renderMode = RENDER_MODE_AUTO;
+            } else if (strcmp(mode, "mesh") == 0) {
+                options->renderMode = RENDER_MODE_MESH;
+            } else if (strcmp(mode, "sdf") == 0) {
+                options->renderMode = RENDER_MODE_SDF;
+            } else {
+                fprintf(stderr, "Unknown render mode '%s'\n", mode);
+                exit(EXIT_FAILURE);
+            }
+            options->profileOverrides |= PROFILE_OVERRIDE_RENDER_MODE;
+        } else if (strcmp(flag, "--lod-mesh") == 0) {
+            options->lodMeshSize = (float)parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--lod-point") == 0) {
+            options->lodPointSize = (float)parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--rasterizer") == 0) {
+            const char *rasterizer = nextArgument(argc, argv, &i);
+            if (strcmp(rasterizer, "auto") == 0) {
+                options->rasterizer = RASTERIZER_AUTO;
+            } else if (strcmp(rasterizer, "pipeline") == 0) {
+                options->rasterizer = RASTERIZER_PIPELINE;
+            } else if (strcmp(rasterizer, "tiles") == 0) {
+                options->rasterizer = RASTERIZER_TILES;
+            } else {
+                fprintf(stderr, "Unknown rasterizer '%s'\n", rasterizer);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(flag, "--tile-threshold") == 0) {
+            options->tileThreshold = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--render-pass") == 0) {
+            options->renderPasses = VK_TRUE;
+        } else if (strcmp(flag, "--interaction") == 0) {
+            options->interactionStrength = (float)parseDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--interaction-radius") == 0) {
+            options->interactionRadius = (float)parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--reorder") == 0) {
+            options->reorderSweepCount = parseList(flag, 
+                nextArgument(argc, argv, &i), options->reorderSweep);
+        } else if (strcmp(flag, "--in-place") == 0) {
+            options->inPlace = VK_TRUE;
+        } else if (strcmp(flag, "--quality") == 0) {
+            const char *quality = nextArgument(argc, argv, &i);
+            if (strcmp(quality, "auto") == 0) {
+                options->quality = QUALITY_AUTO;
+            } else if (strcmp(quality, "low") == 0) {
+                options->quality = QUALITY_LOW;
+            } else if (strcmp(quality, "high") == 0) {
+                options->quality = QUALITY_HIGH;
+            } else {
+                fprintf(stderr, "Unknown quality '%s'\n", quality);
+                exit(EXIT_FAILURE);
+            }
+            options->profileOverrides |= PROFILE_OVERRIDE_QUALITY;
+        } else if (strcmp(flag, "--bloom-levels") == 0) {
+            options->bloomLevels = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--bloom-scale") == 0) {
+            options->bloomScale = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+            options->profileOverrides |= PROFILE_OVERRIDE_BLOOM_SCALE;
+        } else if (strcmp(flag, "--trails") == 0) {
+            options->trailDecay = (float)parseDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--sparks") == 0) {
+            options->sparksPerBurst = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--spark-capacity") == 0) {
+            options->sparkCapacity = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--trace") == 0) {
+            options->tracePath = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--stats") == 0) {
+            options->statsInterval = parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--benchmark") == 0) {
+            options->benchmark = VK_TRUE;
+        } else if (strcmp(flag, "--bench-frames") == 0) {
+            options->benchFrames = parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--bench-seconds") == 0) {
+            options->benchSeconds = parsePositiveDouble(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--bench-warmup") == 0) {
+            options->benchWarmup = (uint32_t)parseUnsigned(flag, nextArgument(argc, argv, &i));
+        } else if (strcmp(flag, "--bench-format") == 0) {
+            const char *format = nextArgument(argc, argv, &i);
+            if (strcmp(format, "csv") == 0) {
+                options->benchFormat = BENCH_FORMAT_CSV;
+            } else if (strcmp(format, "json") == 0) {
+                options->benchFormat = BENCH_FORMAT_JSON;
+            } else {
+                fprintf(stderr, "Unknown benchmark format '%s'\n", format);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(flag, "--bench-out") == 0) {
+            options->benchOutput = nextArgument(argc, argv, &i);
+        } else if (strcmp(flag, "--help") == 0 || strcmp(flag, "-h") == 0) {
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", flag);
+            printUsage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (options->width == 0 || options->height == 0) {
+        fprintf(stderr, "Width and height must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->starPoints < MIN_STAR_POINTS || options->starPoints > MAX_STAR_POINTS) {
+        fprintf(stderr, "Stars must have %u to %u points\n", MIN_STAR_POINTS,
+            MAX_STAR_POINTS);
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; options->inPlace && i < options->reorderSweepCount; ++i) {
+        // Note: Reordering gathers particles, which needs a separate input
+        if (options->reorderSweep[i] > 0) {
+            fprintf(stderr, "Reordering requires one particle buffer per frame\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (options->bloomLevels == 0 || options->bloomLevels > MAX_BLOOM_LEVELS) {
+        fprintf(stderr, "Bloom pyramid must have 1 to %u levels\n", MAX_BLOOM_LEVELS);
+        exit(EXIT_FAILURE);
+    }
+    if (options->bloomScale == 0) {
+        fprintf(stderr, "Bloom scale must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->trailDecay < 0.0f || options->trailDecay >= 1.0f) {
+        fprintf(stderr, "Trail decay must be in [0, 1)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->trailDecay > 0.0f && options->rasterizer == RASTERIZER_TILES) {
+        // Note: Tile rasterizer replaces whole image instead of blending
+        fprintf(stderr, "Trails require the pipeline rasterizer\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->sparksPerBurst > MAX_SPARKS_PER_BURST) {
+        fprintf(stderr, "Stars burst into at most %u sparks\n", MAX_SPARKS_PER_BURST);
+        exit(EXIT_FAILURE);
+    }
+    if (options->sparksPerBurst > 0 && options->rasterizer == RASTERIZER_TILES) {
+        // Note: Sparks are drawn by indirect draw of graphics pipeline
+        fprintf(stderr, "Sparks require the pipeline rasterizer\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options->exportPath) {
+        if (options->exportFps == 0 || options->exportRingSize == 0) {
+            fprintf(stderr, "Export frame rate and ring size must be positive\n");
+            exit(EXIT_FAILURE);
+        }
+        // Deduce container from file extension unless given explicitly
+        const size_t length = strlen(options->exportPath);
+        if (!exportFormatSet && length >= 4 &&
+            strcmp(options->exportPath + length - 4, ".y4m") == 0)
+        {
+            options->exportFormat = EXPORT_FORMAT_Y4M;
+        }
+        // Recorded shows advance by exactly one frame period per frame
+        options->fixedTimeStep = 1.0 / (double)options->exportFps;
+    }
+    
+    for (uint32_t i = 0; i < options->particleSweepCount; ++i) {
+        if (options->particleSweep[i] == 0) {
+            fprintf(stderr, "Particle count must be positive\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (uint32_t i = 0; i < options->msaaSweepCount; ++i) {
+        const uint32_t samples = options->msaaSweep[i];
+        // Note: 0 selects highest supported sample count
+        if (samples > 64 || (samples & (samples - 1)) != 0) {
+            fprintf(stderr, "MSAA sample count must be a power of 2 (max. 64)\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if ((options->profileOverrides & PROFILE_OVERRIDE_WORKGROUP) &&
+        (options->workgroupSize == 0 || options->workgroupSize > MAX_WORKGROUP_SIZE ||
+         (options->workgroupSize & (options->workgroupSize - 1)) != 0))
+    {
+        fprintf(stderr, "Work group size must be a power of 2 (max. %u)\n",
+            MAX_WORKGROUP_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    // Regular runs use first value of swept parameters
+    options->particleCount = options->particleSweep[0];
+    options->msaaSamples = options->msaaSweep[0];
+    options->reorderInterval = options->reorderSweep[0];
+    options->profile = options->profileSweep[0];
+    
+    if (options->benchmark) {
+        if (options->benchFrames == 0 && options->benchSeconds == 0.0) {
+            options->benchFrames = DEFAULT_BENCH_FRAMES;
+        }
+        if (options->exportPath) {
+            // Note: Every configuration would overwrite exported video
+            fprintf(stderr, "Export cannot be combined with benchmark mode\n");
+            exit(EXIT_FAILURE);
+        }
+        if (options->fixedTimeStep == 0.0) {
+            options->fixedTimeStep = BENCH_TIME_STEP;
+        }
+    }
+    
+    // Nobody can close a window that does not exist -> terminate eventually
+    if (options->headless && !frameCountSet) {
+        options->frameCount = DEFAULT_HEADLESS_FRAMES;
+    }
+}
+
+FILE *openOutputFile(const char *path)
+{
+    if (strcmp(path, "-") != 0) {
+        FILE *stream = fopen(path, "wb");
+        if (!stream) {
+            fprintf(stderr, "Failed to open output file '%s': %s\n", path,
+                strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        return stream;
+    }
+    
+    // Keep results on stdout, but move regular output (printf) to stderr
+    const int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Failed to redirect stdout: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // Closed pipe should surface as write error instead of killing process
+    signal(SIGPIPE, SIG_IGN);
+    
+    FILE *stream = fdopen(fd, "wb");
+    if (!stream) {
+        fprintf(stderr, "Failed to open stdout for output: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return stream;
+}
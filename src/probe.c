@@ -0,0 +1,293 @@
+#include "probe.h"
+#include "grid.h"
+#include "vkutils.h"
+#include "timer.h"
+
+#include <string.h>
+
+// Large enough for fixed-size blocks declared in unused bindings
+#define PROBE_DUMMY_SIZE 4096
+
+// Buffers and pipeline of probe on its temporary device
+typedef struct ProbeContext {
+    VkDevice device;
+    VkQueue queue;
+    VkBuffer buffers[3];  // uniforms, particles, dummy
+    VkDeviceMemory memories[3];
+    VkDescriptorSetLayout descriptorLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+} ProbeContext;
+
+static void createProbeDevice(ProbeContext *ctx, VkPhysicalDevice physicalDevice,
+    uint32_t queueFamily)
+{
+    const float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo = {0};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+    
+    VkDeviceCreateInfo deviceInfo = {0};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    
+    CHK_VK_ERR(vkCreateDevice(physicalDevice, &deviceInfo, NULL, &ctx->device),
+        "Failed to create logical device for probe\n");
+    vkGetDeviceQueue(ctx->device, queueFamily, 0, &ctx->queue);
+    
+    VkCommandPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    CHK_VK_ERR(vkCreateCommandPool(ctx->device, &poolInfo, NULL,
+        &ctx->commandPool), "Failed to create probe command pool\n");
+    
+    VkCommandBufferAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = ctx->commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    CHK_VK_ERR(vkAllocateCommandBuffers(ctx->device, &allocInfo,
+        &ctx->commandBuffer), "Failed to allocate probe command buffer\n");
+    
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    CHK_VK_ERR(vkCreateFence(ctx->device, &fenceInfo, NULL, &ctx->fence),
+        "Failed to create probe fence\n");
+}
+
+// Note: Unlike createBuffer(), allocations of the temporary device are not
+//       tracked, so memory statistics only count the device rendering
+static void createProbeBuffer(ProbeContext *ctx, VkPhysicalDevice physicalDevice,
+    uint32_t index, VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties)
+{
+    VkBufferCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = size;
+    createInfo.usage = usage;
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    CHK_VK_ERR(vkCreateBuffer(ctx->device, &createInfo, NULL, &ctx->buffers[index]),
+        "Failed to create probe buffer\n");
+    
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(ctx->device, ctx->buffers[index], &memReq);
+    VkMemoryAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits,
+        properties, physicalDevice);
+    CHK_VK_ERR(vkAllocateMemory(ctx->device, &allocInfo, NULL, &ctx->memories[index]),
+        "Failed to allocate probe buffer memory\n");
+    CHK_VK_ERR(vkBindBufferMemory(ctx->device, ctx->buffers[index],
+        ctx->memories[index], 0), "Failed to bind memory to probe buffer\n");
+}
+
+// Uniforms of update branch, particles updated in place (see --in-place)
+// and one dummy buffer for grid and spark bindings, which stay unused since
+// interactions, reordering and sparks are off
+static void createProbeBuffers(ProbeContext *ctx, VkPhysicalDevice physicalDevice)
+{
+    createProbeBuffer(ctx, physicalDevice, 0, sizeof(ParameterBufferObject),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    createProbeBuffer(ctx, physicalDevice, 1,
+        (VkDeviceSize)PROBE_PARTICLES * sizeof(Particle),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    createProbeBuffer(ctx, physicalDevice, 2, PROBE_DUMMY_SIZE,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    ParameterBufferObject pbo = {0};
+    pbo.deltaTime = 1.0f / 60.0f;
+    pbo.elapsedTime = 0.0f;
+    pbo.animationResetTime = (float)ANIMATION_RESET_TIME;
+    pbo.randomSeed = 1;
+    pbo.particleCount = PROBE_PARTICLES;
+    pbo.gridCellCount = GRID_SCAN_BLOCK_SIZE;
+    void *mapped = NULL;
+    CHK_VK_ERR(vkMapMemory(ctx->device, ctx->memories[0], 0, sizeof(pbo), 0,
+        &mapped), "Failed to map probe uniform buffer\n");
+    memcpy(mapped, &pbo, sizeof(pbo));
+    vkUnmapMemory(ctx->device, ctx->memories[0]);
+}
+
+// Same layout as compute descriptor set of application
+static void createProbePipeline(ProbeContext *ctx, uint32_t workgroupSize)
+{
+    VkDescriptorSetLayoutBinding bindings[COMPUTE_BINDING_COUNT] = {0};
+    for (uint32_t i = 0; i < COMPUTE_BINDING_COUNT; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = COMPUTE_BINDING_COUNT;
+    layoutInfo.pBindings = bindings;
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(ctx->device, &layoutInfo, NULL,
+        &ctx->descriptorLayout), "Failed to create probe descriptor set layout\n");
+    
+    VkDescriptorPoolSize poolSizes[2] = {0};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = COMPUTE_BINDING_COUNT - 1;
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = 1;
+    CHK_VK_ERR(vkCreateDescriptorPool(ctx->device, &poolInfo, NULL,
+        &ctx->descriptorPool), "Failed to create probe descriptor pool\n");
+    
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = ctx->descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &ctx->descriptorLayout;
+    CHK_VK_ERR(vkAllocateDescriptorSets(ctx->device, &allocInfo,
+        &ctx->descriptorSet), "Failed to allocate probe descriptor set\n");
+    
+    VkDescriptorBufferInfo bufferInfos[COMPUTE_BINDING_COUNT] = {0};
+    VkWriteDescriptorSet writes[COMPUTE_BINDING_COUNT] = {0};
+    for (uint32_t i = 0; i < COMPUTE_BINDING_COUNT; ++i) {
+        // Note: Bindings 1 and 2 (input and output) alias particles
+        bufferInfos[i].buffer = ctx->buffers[i == 0 ? 0 : i <= 2 ? 1 : 2];
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = ctx->descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(ctx->device, COMPUTE_BINDING_COUNT, writes, 0, NULL);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &ctx->descriptorLayout;
+    CHK_VK_ERR(vkCreatePipelineLayout(ctx->device, &pipelineLayoutInfo, NULL,
+        &ctx->pipelineLayout), "Failed to create probe pipeline layout\n");
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/comp.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(ctx->device,
+        shaderSource, shaderSize);
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    // Note: Work group size is specialization constant 0 (see shader.comp)
+    const VkSpecializationMapEntry workgroupEntry = { 0, 0, sizeof(uint32_t) };
+    VkSpecializationInfo workgroupInfo = {0};
+    workgroupInfo.mapEntryCount = 1;
+    workgroupInfo.pMapEntries = &workgroupEntry;
+    workgroupInfo.dataSize = sizeof(uint32_t);
+    workgroupInfo.pData = &workgroupSize;
+    pipelineInfo.stage.pSpecializationInfo = &workgroupInfo;
+    pipelineInfo.layout = ctx->pipelineLayout;
+    CHK_VK_ERR(vkCreateComputePipelines(ctx->device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &ctx->pipeline),
+        "Failed to create probe pipeline\n");
+    
+    vkDestroyShaderModule(ctx->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+// Zero particles once, then PROBE_STEPS dependent update dispatches
+static void recordProbe(ProbeContext *ctx, uint32_t workgroupSize)
+{
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    CHK_VK_ERR(vkBeginCommandBuffer(ctx->commandBuffer, &beginInfo),
+        "Failed to begin recording probe command buffer\n");
+    
+    vkCmdFillBuffer(ctx->commandBuffer, ctx->buffers[1], 0, VK_WHOLE_SIZE, 0);
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(ctx->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    
+    vkCmdBindPipeline(ctx->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        ctx->pipeline);
+    vkCmdBindDescriptorSets(ctx->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        ctx->pipelineLayout, 0, 1, &ctx->descriptorSet, 0, NULL);
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    const uint32_t groupCount = (PROBE_PARTICLES + workgroupSize - 1) / workgroupSize;
+    for (uint32_t i = 0; i < PROBE_STEPS; ++i) {
+        vkCmdDispatch(ctx->commandBuffer, groupCount, 1, 1);
+        vkCmdPipelineBarrier(ctx->commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, NULL, 0, NULL);
+    }
+    
+    CHK_VK_ERR(vkEndCommandBuffer(ctx->commandBuffer),
+        "Failed to record probe command buffer\n");
+}
+
+// Returns seconds from submission until fence is signalled
+static double submitProbe(ProbeContext *ctx)
+{
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &ctx->commandBuffer;
+    
+    const uint64_t start = timerNanoseconds();
+    CHK_VK_ERR(vkQueueSubmit(ctx->queue, 1, &submitInfo, ctx->fence),
+        "Failed to submit probe command buffer\n");
+    CHK_VK_ERR(vkWaitForFences(ctx->device, 1, &ctx->fence, VK_TRUE, UINT64_MAX),
+        "Failed to wait for probe fence\n");
+    const uint64_t end = timerNanoseconds();
+    vkResetFences(ctx->device, 1, &ctx->fence);
+    return (double)(end - start) * 1e-9;
+}
+
+double probeDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamily,
+    uint32_t workgroupSize)
+{
+    ProbeContext ctx = {0};
+    createProbeDevice(&ctx, physicalDevice, queueFamily);
+    createProbeBuffers(&ctx, physicalDevice);
+    createProbePipeline(&ctx, workgroupSize);
+    recordProbe(&ctx, workgroupSize);
+    
+    // Note: First submission warms up caches and lazily compiled pipeline
+    submitProbe(&ctx);
+    const double seconds = submitProbe(&ctx);
+    
+    vkDestroyFence(ctx.device, ctx.fence, NULL);
+    vkDestroyCommandPool(ctx.device, ctx.commandPool, NULL);
+    vkDestroyPipeline(ctx.device, ctx.pipeline, NULL);
+    vkDestroyPipelineLayout(ctx.device, ctx.pipelineLayout, NULL);
+    vkDestroyDescriptorPool(ctx.device, ctx.descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(ctx.device, ctx.descriptorLayout, NULL);
+    for (uint32_t i = 0; i < 3; ++i) {
+        vkDestroyBuffer(ctx.device, ctx.buffers[i], NULL);
+        vkFreeMemory(ctx.device, ctx.memories[i], NULL);
+    }
+    vkDestroyDevice(ctx.device, NULL);
+    
+    return seconds > 0.0 ? (double)PROBE_PARTICLES * PROBE_STEPS / seconds : 0.0;
+}
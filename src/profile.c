@@ -0,0 +1,125 @@
+#include "profile.h"
+#include "vkutils.h"
+
+#include <string.h>
+
+static const PerformanceProfile PROFILES[PROFILE_COUNT] = {
+    [PROFILE_AUTO] = { "auto", 0, RENDER_MODE_AUTO, QUALITY_AUTO, 0, 0 },
+    // Note: Full meshes and highest MSAA for large stars
+    [PROFILE_HIGH] = { "high", 0, RENDER_MODE_AUTO, QUALITY_HIGH, 2, 256 },
+    [PROFILE_BALANCED] = { "balanced", 4, RENDER_MODE_AUTO, QUALITY_HIGH, 4, 256 },
+    // Note: Every fragment and invocation costs CPU time, so stars are
+    //       analytically anti-aliased quads and small work groups spread
+    //       particles evenly over threads of driver
+    [PROFILE_CPU] = { "cpu", 1, RENDER_MODE_SDF, QUALITY_LOW, 4, 64 },
+};
+
+const PerformanceProfile *profileGet(ProfileKind kind)
+{
+    return &PROFILES[kind < PROFILE_COUNT ? kind : PROFILE_AUTO];
+}
+
+ProfileKind profileFromName(const char *name)
+{
+    for (uint32_t i = 0; i < PROFILE_COUNT; ++i) {
+        if (strcmp(name, PROFILES[i].name) == 0) {
+            return (ProfileKind)i;
+        }
+    }
+    return PROFILE_COUNT;
+}
+
+// Profile fitting device, sets reason for log
+static ProfileKind selectProfile(VkPhysicalDevice physicalDevice,
+    const VkPhysicalDeviceProperties *props, const char **reason)
+{
+    switch (props->deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            *reason = "CPU device";
+            return PROFILE_CPU;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            *reason = "integrated or virtual GPU";
+            return PROFILE_BALANCED;
+        default:
+            break;
+    }
+    if (deviceLocalHeapSize(physicalDevice) < PROFILE_SMALL_HEAP_SIZE) {
+        *reason = "small device-local heap";
+        return PROFILE_BALANCED;
+    }
+    if (props->limits.maxComputeWorkGroupInvocations <
+        PROFILES[PROFILE_HIGH].workgroupSize)
+    {
+        *reason = "small work groups";
+        return PROFILE_BALANCED;
+    }
+    *reason = "discrete GPU";
+    return PROFILE_HIGH;
+}
+
+// Largest power of 2 up to size within device limits
+static uint32_t clampWorkgroupSize(uint32_t size, const VkPhysicalDeviceLimits *limits)
+{
+    while (size > 1 &&
+        (size > limits->maxComputeWorkGroupSize[0] ||
+         size > limits->maxComputeWorkGroupInvocations))
+    {
+        size /= 2;
+    }
+    return size;
+}
+
+uint32_t profileWorkgroupSize(const Options *options, VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    uint32_t size = options->workgroupSize;
+    if (!(options->profileOverrides & PROFILE_OVERRIDE_WORKGROUP)) {
+        const char *reason = NULL;
+        const ProfileKind kind = options->profile != PROFILE_AUTO ?
+            options->profile : selectProfile(physicalDevice, &props, &reason);
+        size = PROFILES[kind].workgroupSize;
+    }
+    return clampWorkgroupSize(size, &props.limits);
+}
+
+void profileApply(Graphics graphics)
+{
+    Options *options = &graphics->options;
+    const char *reason = "--profile";
+    if (options->profile == PROFILE_AUTO) {
+        options->profile = selectProfile(graphics->physicalDevice,
+            &graphics->deviceProperties, &reason);
+    }
+    const PerformanceProfile *profile = &PROFILES[options->profile];
+    
+    const uint32_t overrides = options->profileOverrides;
+    if (!(overrides & PROFILE_OVERRIDE_MSAA)) {
+        options->msaaSamples = profile->msaaSamples;
+    }
+    if (!(overrides & PROFILE_OVERRIDE_RENDER_MODE)) {
+        options->renderMode = profile->renderMode;
+    }
+    if (!(overrides & PROFILE_OVERRIDE_QUALITY)) {
+        options->quality = profile->quality;
+    }
+    if (!(overrides & PROFILE_OVERRIDE_BLOOM_SCALE)) {
+        options->bloomScale = profile->bloomScale;
+    }
+    if (!(overrides & PROFILE_OVERRIDE_WORKGROUP)) {
+        options->workgroupSize = profile->workgroupSize;
+    }
+    // Signed distance stars are anti-aliased analytically -> no MSAA needed
+    if (options->renderMode == RENDER_MODE_SDF &&
+        !(overrides & PROFILE_OVERRIDE_MSAA))
+    {
+        options->msaaSamples = 1;
+    }
+    
+    options->workgroupSize = clampWorkgroupSize(options->workgroupSize,
+        &graphics->deviceProperties.limits);
+    
+    printf("Using profile: %s (%s), work groups of %u\n", profile->name,
+        reason, options->workgroupSize);
+}
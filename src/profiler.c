@@ -0,0 +1,452 @@
+#include "profiler.h"
+#include "vkmemory.h"
+
+#include <string.h>
+
+// GPU and CPU clocks drift apart, so re-calibrate periodically
+#define CALIBRATION_INTERVAL_NS 1000000000ull
+
+// Counters queried during render pass (see PipelineStat)
+static const VkQueryPipelineStatisticFlags PIPELINE_STAT_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+// Index of first of two timestamp queries of pass in given frame slot
+static uint32_t queryIndex(uint32_t frame, GpuPass pass)
+{
+    return (frame * GPU_PASS_COUNT + (uint32_t)pass) * 2;
+}
+
+const char *cpuPhaseName(CpuPhase phase)
+{
+    static const char *const names[CPU_PHASE_COUNT] = {
+        "fence_wait", "acquire", "record", "submit", "present"
+    };
+    assert(phase < CPU_PHASE_COUNT && "Invalid CPU phase");
+    return names[phase];
+}
+
+const char *gpuPassName(GpuPass pass)
+{
+    static const char *const names[GPU_PASS_COUNT] = {
+        "compute", "render", "grid", "bloom"
+    };
+    assert(pass < GPU_PASS_COUNT && "Invalid GPU pass");
+    return names[pass];
+}
+
+const char *pipelineStatName(PipelineStat stat)
+{
+    static const char *const names[PIPELINE_STAT_COUNT] = {
+        "vertex_invocations", "primitive_invocations", "fragment_invocations"
+    };
+    assert(stat < PIPELINE_STAT_COUNT && "Invalid pipeline statistic");
+    return names[stat];
+}
+
+const char *gpuCounterName(GpuCounter counter)
+{
+    static const char *const names[GPU_COUNTER_COUNT] = {
+        "sparks_live", "sparks_emitted", "sparks_dropped"
+    };
+    assert(counter < GPU_COUNTER_COUNT && "Invalid GPU counter");
+    return names[counter];
+}
+
+// Number of valid timestamp bits of queue family used for all submissions
+static uint32_t timestampValidBits(Graphics graphics)
+{
+    // Note: Compute and graphics commands are submitted to the graphics family
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(graphics->physicalDevice,
+        &familyCount, NULL);
+    VkQueueFamilyProperties *families = NULL;
+    CHK_ALLOC(families = malloc(familyCount * sizeof(VkQueueFamilyProperties)));
+    vkGetPhysicalDeviceQueueFamilyProperties(graphics->physicalDevice,
+        &familyCount, families);
+    const uint32_t validBits =
+        families[graphics->queueFamilies.graphicsFamily].timestampValidBits;
+    free(families);
+    
+    return validBits;
+}
+
+// Sample GPU and CPU clock at (approximately) the same time
+static void calibrate(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    
+    VkCalibratedTimestampInfoEXT infos[2] = {0};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    // Note: Same clock as timerNanoseconds()
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+    
+    uint64_t timestamps[2];
+    uint64_t maxDeviation;
+    if (profiler->getCalibratedTimestamps(graphics->device, 2, infos,
+            timestamps, &maxDeviation) == VK_SUCCESS)
+    {
+        profiler->calibrationTicks = timestamps[0];
+        profiler->calibrationNs = timestamps[1];
+    }
+}
+
+// Enable tracing of GPU passes if device and CPU clock can be correlated
+static void initCalibration(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    if (!graphics->calibratedTimestamps || 
+        profiler->timestampPool == VK_NULL_HANDLE) 
+    {
+        printf("Calibrated timestamps not supported, GPU passes not traced\n");
+        return;
+    }
+    
+    PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT getTimeDomains =
+        (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT) vkGetInstanceProcAddr(
+            graphics->instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+    PFN_vkGetCalibratedTimestampsEXT getTimestamps =
+        (PFN_vkGetCalibratedTimestampsEXT) vkGetDeviceProcAddr(
+            graphics->device, "vkGetCalibratedTimestampsEXT");
+    if (!getTimeDomains || !getTimestamps) {
+        printf("Calibrated timestamps not supported, GPU passes not traced\n");
+        return;
+    }
+    
+    uint32_t domainCount = 0;
+    getTimeDomains(graphics->physicalDevice, &domainCount, NULL);
+    VkTimeDomainEXT *domains = NULL;
+    CHK_ALLOC(domains = malloc((domainCount + 1) * sizeof(VkTimeDomainEXT)));
+    getTimeDomains(graphics->physicalDevice, &domainCount, domains);
+    
+    VkBool32 foundDevice = VK_FALSE;
+    VkBool32 foundMonotonic = VK_FALSE;
+    for (uint32_t i = 0; i < domainCount; ++i) {
+        foundDevice |= domains[i] == VK_TIME_DOMAIN_DEVICE_EXT;
+        foundMonotonic |= domains[i] == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+    }
+    free(domains);
+    
+    if (!foundDevice || !foundMonotonic) {
+        printf("GPU clock cannot be correlated with CPU clock, "
+            "GPU passes not traced\n");
+        return;
+    }
+    profiler->getCalibratedTimestamps = getTimestamps;
+    calibrate(graphics);
+}
+
+// Convert GPU timestamp to timerNanoseconds() clock
+static uint64_t gpuToCpuTime(const Profiler *profiler, uint64_t ticks)
+{
+    const uint64_t mask = profiler->timestampMask;
+    // Note: Timestamps may precede calibration -> sign-extend masked delta
+    const uint64_t delta = (ticks - profiler->calibrationTicks) & mask;
+    const double signedDelta = delta > (mask >> 1) ?
+        -(double)(mask - delta) - 1.0 : (double)delta;
+    return profiler->calibrationNs + 
+        (uint64_t)(int64_t)(signedDelta * profiler->timestampPeriod);
+}
+
+void initProfiler(Graphics graphics)
+{
+    Profiler *profiler = NULL;
+    CHK_ALLOC(profiler = calloc(1, sizeof(Profiler)));
+    graphics->profiler = profiler;
+    profiler->resetTime = timerNanoseconds();
+    
+    const uint32_t validBits = timestampValidBits(graphics);
+    if (validBits > 0) {
+        profiler->timestampPeriod =
+            (double)graphics->deviceProperties.limits.timestampPeriod;
+        profiler->timestampMask = validBits >= 64 ?
+            UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+        
+        VkQueryPoolCreateInfo createInfo = {0};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = queryIndex(MAX_FRAMES_IN_FLIGHT, 0);
+        
+        CHK_VK_ERR(vkCreateQueryPool(graphics->device, &createInfo, NULL,
+            &profiler->timestampPool), "Failed to create timestamp query pool\n");
+    } else {
+        // Note: GPU times are simply reported as unavailable
+        printf("Timestamp queries not supported, GPU times unavailable\n");
+    }
+    
+    if (graphics->deviceFeatures.pipelineStatisticsQuery) {
+        // One query per frame slot, spanning render pass
+        VkQueryPoolCreateInfo createInfo = {0};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        createInfo.queryCount = MAX_FRAMES_IN_FLIGHT;
+        createInfo.pipelineStatistics = PIPELINE_STAT_FLAGS;
+        
+        CHK_VK_ERR(vkCreateQueryPool(graphics->device, &createInfo, NULL,
+            &profiler->statisticsPool),
+            "Failed to create pipeline statistics query pool\n");
+    } else {
+        printf("Pipeline statistics queries not supported\n");
+    }
+    
+    if (traceActive) {
+        initCalibration(graphics);
+    }
+}
+
+void profilerBeginFrame(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    memset(&profiler->timings, 0, sizeof(FrameTimings));
+    profiler->frameStart = timerNanoseconds();
+}
+
+// Print means since last reset as single line
+static void logStats(Graphics graphics)
+{
+    ProfilerStats stats;
+    profilerGetStats(graphics, &stats);
+    
+    printf("Stats: %.1f fps | frame %.3f ms | cpu",
+        (double)stats.frames / stats.seconds, stats.frameMs);
+    for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+        printf(" %s %.3f", cpuPhaseName(i), stats.cpuMs[i]);
+    }
+    printf(" ms | gpu");
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        if (stats.gpuValid[i]) {
+            printf(" %s %.3f", gpuPassName(i), stats.gpuMs[i]);
+        } else {
+            printf(" %s n/a", gpuPassName(i));
+        }
+    }
+    printf(" ms");
+    if (stats.pipelineStatsValid) {
+        printf(" |");
+        for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+            printf(" %s %.0f", pipelineStatName(i), stats.pipelineStats[i]);
+        }
+    }
+    if (stats.countersValid) {
+        printf(" |");
+        for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+            printf(" %s %.0f", gpuCounterName(i), stats.counters[i]);
+        }
+    }
+    printf(" | ");
+    memoryPrintStats(stdout);
+    printf("\n");
+}
+
+void profilerEndFrame(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    const uint64_t now = timerNanoseconds();
+    FrameTimings *timings = &profiler->timings;
+    timings->frameMs = (double)(now - profiler->frameStart) * 1e-6;
+    if (traceActive) {
+        traceRecord("frame", profiler->frameStart, now);
+    }
+    
+    // Accumulate
+    ProfilerStats *sums = &profiler->sums;
+    sums->frames++;
+    sums->frameMs += timings->frameMs;
+    for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+        sums->cpuMs[i] += timings->cpuMs[i];
+    }
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        if (timings->gpuValid[i]) {
+            sums->gpuMs[i] += timings->gpuMs[i];
+            profiler->gpuSamples[i]++;
+        }
+    }
+    if (timings->pipelineStatsValid) {
+        for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+            sums->pipelineStats[i] += (double)timings->pipelineStats[i];
+        }
+        profiler->statisticsSamples++;
+    }
+    if (timings->countersValid) {
+        for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+            sums->counters[i] += (double)timings->counters[i];
+        }
+        profiler->counterSamples++;
+    }
+    
+    const double interval = graphics->options.statsInterval;
+    if (interval > 0.0 &&
+        (double)(now - profiler->resetTime) * 1e-9 >= interval)
+    {
+        logStats(graphics);
+        profilerResetStats(graphics);
+    }
+}
+
+void profilerBeginPhase(Graphics graphics, const char *name)
+{
+    graphics->profiler->phaseName = name;
+    graphics->profiler->phaseStart = timerNanoseconds();
+}
+
+void profilerEndPhase(Graphics graphics, CpuPhase phase)
+{
+    Profiler *profiler = graphics->profiler;
+    const uint64_t now = timerNanoseconds();
+    profiler->timings.cpuMs[phase] += (double)(now - profiler->phaseStart) * 1e-6;
+    
+    if (traceActive) {
+        traceRecord(profiler->phaseName, profiler->phaseStart, now);
+    }
+}
+
+void profilerBeginPass(Graphics graphics, VkCommandBuffer commandBuffer,
+    GpuPass pass)
+{
+    Profiler *profiler = graphics->profiler;
+    const uint32_t frame = graphics->currentFrame;
+    
+    // Note: Queries must be reset before being written again
+    if (profiler->statisticsPool != VK_NULL_HANDLE && pass == GPU_PASS_RENDER) {
+        vkCmdResetQueryPool(commandBuffer, profiler->statisticsPool, frame, 1);
+        vkCmdBeginQuery(commandBuffer, profiler->statisticsPool, frame, 0);
+    }
+    if (profiler->timestampPool != VK_NULL_HANDLE) {
+        const uint32_t query = queryIndex(frame, pass);
+        vkCmdResetQueryPool(commandBuffer, profiler->timestampPool, query, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            profiler->timestampPool, query);
+    }
+}
+
+void profilerEndPass(Graphics graphics, VkCommandBuffer commandBuffer,
+    GpuPass pass)
+{
+    Profiler *profiler = graphics->profiler;
+    const uint32_t frame = graphics->currentFrame;
+    
+    if (profiler->timestampPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            profiler->timestampPool, queryIndex(frame, pass) + 1);
+        profiler->pending[frame][pass] = VK_TRUE;
+    }
+    if (profiler->statisticsPool != VK_NULL_HANDLE && pass == GPU_PASS_RENDER) {
+        vkCmdEndQuery(commandBuffer, profiler->statisticsPool, frame);
+        profiler->pending[frame][pass] = VK_TRUE;
+    }
+}
+
+void profilerCollect(Graphics graphics, GpuPass pass)
+{
+    Profiler *profiler = graphics->profiler;
+    const uint32_t frame = graphics->currentFrame;
+    VkBool32 *pending = &profiler->pending[frame][pass];
+    if (!*pending) {
+        return;  // nothing recorded yet (or queries unsupported)
+    }
+    *pending = VK_FALSE;
+    
+    // Note: Not waiting, results are available once fence is signalled
+    if (profiler->timestampPool != VK_NULL_HANDLE) {
+        uint64_t timestamps[2];
+        const VkResult result = vkGetQueryPoolResults(graphics->device,
+            profiler->timestampPool, queryIndex(frame, pass), 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            // Note: Masking handles wrap-around of timestamps with < 64
+            //       valid bits
+            const uint64_t ticks =
+                (timestamps[1] - timestamps[0]) & profiler->timestampMask;
+            profiler->timings.gpuMs[pass] =
+                (double)ticks * profiler->timestampPeriod * 1e-6;
+            profiler->timings.gpuValid[pass] = VK_TRUE;
+            
+            if (traceActive && profiler->getCalibratedTimestamps) {
+                if (timerNanoseconds() - profiler->calibrationNs >= 
+                    CALIBRATION_INTERVAL_NS) 
+                {
+                    calibrate(graphics);
+                }
+                traceRecordGpu(gpuPassName(pass), 
+                    gpuToCpuTime(profiler, timestamps[0]),
+                    gpuToCpuTime(profiler, timestamps[1]));
+            }
+        }
+    }
+    if (profiler->statisticsPool != VK_NULL_HANDLE && pass == GPU_PASS_RENDER) {
+        uint64_t *counters = profiler->timings.pipelineStats;
+        const VkResult result = vkGetQueryPoolResults(graphics->device,
+            profiler->statisticsPool, frame, 1,
+            PIPELINE_STAT_COUNT * sizeof(uint64_t), counters,
+            PIPELINE_STAT_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        profiler->timings.pipelineStatsValid = result == VK_SUCCESS;
+    }
+}
+
+void profilerSetCounters(Graphics graphics,
+    const uint32_t counters[GPU_COUNTER_COUNT])
+{
+    FrameTimings *timings = &graphics->profiler->timings;
+    for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+        timings->counters[i] = counters[i];
+    }
+    timings->countersValid = VK_TRUE;
+}
+
+void profilerGetStats(Graphics graphics, ProfilerStats *stats)
+{
+    const Profiler *profiler = graphics->profiler;
+    const ProfilerStats *sums = &profiler->sums;
+    
+    *stats = (ProfilerStats) {0};
+    stats->frames = sums->frames;
+    stats->seconds = (double)(timerNanoseconds() - profiler->resetTime) * 1e-9;
+    if (sums->frames > 0) {
+        stats->frameMs = sums->frameMs / (double)sums->frames;
+        for (uint32_t i = 0; i < CPU_PHASE_COUNT; ++i) {
+            stats->cpuMs[i] = sums->cpuMs[i] / (double)sums->frames;
+        }
+    }
+    for (uint32_t i = 0; i < GPU_PASS_COUNT; ++i) {
+        stats->gpuValid[i] = profiler->gpuSamples[i] > 0;
+        if (stats->gpuValid[i]) {
+            stats->gpuMs[i] = sums->gpuMs[i] / (double)profiler->gpuSamples[i];
+        }
+    }
+    stats->pipelineStatsValid = profiler->statisticsSamples > 0;
+    if (stats->pipelineStatsValid) {
+        for (uint32_t i = 0; i < PIPELINE_STAT_COUNT; ++i) {
+            stats->pipelineStats[i] = sums->pipelineStats[i] /
+                (double)profiler->statisticsSamples;
+        }
+    }
+    stats->countersValid = profiler->counterSamples > 0;
+    if (stats->countersValid) {
+        for (uint32_t i = 0; i < GPU_COUNTER_COUNT; ++i) {
+            stats->counters[i] = sums->counters[i] /
+                (double)profiler->counterSamples;
+        }
+    }
+}
+
+void profilerResetStats(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    profiler->sums = (ProfilerStats) {0};
+    memset(profiler->gpuSamples, 0, sizeof(profiler->gpuSamples));
+    profiler->statisticsSamples = 0;
+    profiler->counterSamples = 0;
+    profiler->resetTime = timerNanoseconds();
+}
+
+void cleanupProfiler(Graphics graphics)
+{
+    Profiler *profiler = graphics->profiler;
+    vkDestroyQueryPool(graphics->device, profiler->timestampPool, NULL);
+    vkDestroyQueryPool(graphics->device, profiler->statisticsPool, NULL);
+    FREE_NULL(graphics->profiler);
+}
@@ -0,0 +1,399 @@
+#include "rendergraph.h"
+
+#include <string.h>
+
+// State of a resource instance after the passes compiled so far
+typedef struct ResourceState {
+    VkBool32 touched;                    // accessed earlier in frame
+    RenderQueue queue;                   // queue of last access
+    VkPipelineStageFlags writeStage;     // last write (0 -> none)
+    VkAccessFlags writeAccess;
+    VkPipelineStageFlags visibleStages;  // stages last write was made visible to
+    VkAccessFlags visibleAccess;
+    VkPipelineStageFlags readStages;     // reads since last write
+    VkImageLayout layout;
+} ResourceState;
+
+// Accesses of a pass to one resource instance, merged
+typedef struct ResourceUse {
+    VkPipelineStageFlags readStage;
+    VkAccessFlags readAccess;
+    VkPipelineStageFlags writeStage;
+    VkAccessFlags writeAccess;
+    VkImageLayout layout;
+    VkImageLayout exitLayout;
+} ResourceUse;
+
+void initRenderGraph(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    RenderGraph *graph = NULL;
+    CHK_ALLOC(graph = calloc(1, sizeof(RenderGraph)));
+    // Note: Update writes particles in place or into buffer of frame slot,
+    //       grid tables are shared (see createShaderStorage(), grid.h)
+    graph->slotted[RENDER_RESOURCE_PARTICLES] = !graphics->options.inPlace;
+    graph->slotted[RENDER_RESOURCE_SPARKS] = VK_TRUE;
+    graph->slotted[RENDER_RESOURCE_DRAWS] = VK_TRUE;
+    graphics->renderGraph = graph;
+}
+
+void renderGraphReset(RenderGraph *graph)
+{
+    graph->passCount = 0;
+    graph->culledCount = 0;
+    graph->computeWaitStages = 0;
+    graph->acquireWaitStages = 0;
+}
+
+RenderGraphPass *renderGraphAddPass(RenderGraph *graph, const char *name,
+    RenderQueue queue, GpuPass profilerPass, RenderPassRecord record)
+{
+    assert(graph->passCount < RENDER_GRAPH_MAX_PASSES && "Too many render graph passes");
+    
+    RenderGraphPass *pass = &graph->passes[graph->passCount++];
+    memset(pass, 0, sizeof(RenderGraphPass));
+    pass->name = name;
+    pass->queue = queue;
+    pass->profilerPass = profilerPass;
+    pass->record = record;
+    return pass;
+}
+
+static RenderAccess *addAccess(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access, VkBool32 write,
+    VkImageLayout layout, VkImageLayout exitLayout)
+{
+    assert(pass->accessCount < RENDER_GRAPH_MAX_ACCESSES && "Too many accesses of pass");
+    
+    RenderAccess *entry = &pass->accesses[pass->accessCount++];
+    entry->resource = resource;
+    entry->previous = VK_FALSE;
+    entry->stage = stage;
+    entry->access = access;
+    entry->write = write;
+    entry->layout = layout;
+    entry->exitLayout = exitLayout;
+    return entry;
+}
+
+void renderGraphRead(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access)
+{
+    addAccess(pass, resource, stage, access, VK_FALSE,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void renderGraphWrite(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access)
+{
+    addAccess(pass, resource, stage, access, VK_TRUE,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void renderGraphReadPrevious(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access)
+{
+    assert(resource != RENDER_RESOURCE_OUTPUT && "Output image has no previous instance");
+    
+    addAccess(pass, resource, stage, access, VK_FALSE,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED)->previous = VK_TRUE;
+}
+
+void renderGraphReadImage(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access,
+    VkImageLayout layout, VkImageLayout exitLayout)
+{
+    addAccess(pass, resource, stage, access, VK_FALSE, layout, exitLayout);
+}
+
+void renderGraphWriteImage(RenderGraphPass *pass, RenderResource resource,
+    VkPipelineStageFlags stage, VkAccessFlags access,
+    VkImageLayout layout, VkImageLayout exitLayout)
+{
+    addAccess(pass, resource, stage, access, VK_TRUE, layout, exitLayout);
+}
+
+// Walk passes backwards, keeping those with side effects or writing a
+// resource read later (the output image is read by presentation/export)
+static void cullPasses(RenderGraph *graph)
+{
+    VkBool32 needed[RENDER_RESOURCE_COUNT] = {0};
+    needed[RENDER_RESOURCE_OUTPUT] = VK_TRUE;
+    
+    for (uint32_t i = graph->passCount; i-- > 0;) {
+        RenderGraphPass *pass = &graph->passes[i];
+        VkBool32 keep = pass->sideEffects;
+        for (uint32_t a = 0; a < pass->accessCount; ++a) {
+            keep |= pass->accesses[a].write && needed[pass->accesses[a].resource];
+        }
+        pass->culled = !keep;
+        if (!keep) {
+            graph->culledCount++;
+            continue;
+        }
+        for (uint32_t a = 0; a < pass->accessCount; ++a) {
+            if (!pass->accesses[a].write) {
+                needed[pass->accesses[a].resource] = VK_TRUE;
+            }
+        }
+    }
+}
+
+// Instance of resource accessed in frame slot
+static uint32_t resourceInstance(const RenderGraph *graph, RenderResource resource,
+    uint32_t slot, VkBool32 previous)
+{
+    if (!graph->slotted[resource]) {
+        return 0;
+    }
+    return previous ? (slot + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT : slot;
+}
+
+static void mergeUses(const RenderGraph *graph, const RenderGraphPass *pass,
+    uint32_t slot, ResourceUse uses[RENDER_RESOURCE_COUNT][MAX_FRAMES_IN_FLIGHT])
+{
+    memset(uses, 0, RENDER_RESOURCE_COUNT * MAX_FRAMES_IN_FLIGHT * sizeof(ResourceUse));
+    for (uint32_t a = 0; a < pass->accessCount; ++a) {
+        const RenderAccess *entry = &pass->accesses[a];
+        const uint32_t instance = resourceInstance(graph, entry->resource, slot,
+            entry->previous);
+        ResourceUse *use = &uses[entry->resource][instance];
+        if (entry->write) {
+            use->writeStage |= entry->stage;
+            use->writeAccess |= entry->access;
+        } else {
+            use->readStage |= entry->stage;
+            use->readAccess |= entry->access;
+        }
+        if (entry->layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+            use->layout = entry->layout;
+        }
+        if (entry->exitLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+            use->exitLayout = entry->exitLayout;
+        }
+    }
+}
+
+// Add dependency of pass on earlier accesses of resource on same queue,
+// if any are hazardous or the image changes layout
+// Returns VK_TRUE if barrier was extended
+static VkBool32 addDependency(RenderGraphPass *pass, RenderResource resource,
+    const ResourceState *state, const ResourceUse *use)
+{
+    // Note: A pass orders its own writes after its reads of a resource
+    const VkPipelineStageFlags stage = use->readStage ? use->readStage : use->writeStage;
+    const VkAccessFlags access = use->readStage ? use->readAccess : use->writeAccess;
+    
+    const VkBool32 readHazard = use->readStage && state->writeStage &&
+        ((stage & ~state->visibleStages) || (access & ~state->visibleAccess));
+    const VkBool32 writeHazard = use->writeStage &&
+        (state->writeStage || state->readStages);
+    const VkBool32 transition = use->layout != VK_IMAGE_LAYOUT_UNDEFINED &&
+        use->layout != state->layout;
+    if (!readHazard && !writeHazard && !transition) {
+        return VK_FALSE;
+    }
+    
+    VkPipelineStageFlags srcStage = state->writeStage |
+        (writeHazard ? state->readStages : 0);
+    if (!srcStage) {
+        // Layout transition only
+        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    }
+    pass->srcStage |= srcStage;
+    pass->dstStage |= stage;
+    if (resource == RENDER_RESOURCE_OUTPUT) {
+        pass->outputBarrier = VK_TRUE;
+        pass->outputSrcAccess = state->writeAccess;
+        pass->outputDstAccess = access;
+        pass->outputOldLayout = state->layout;
+        pass->outputNewLayout = transition ? use->layout : state->layout;
+    } else {
+        pass->srcAccess |= state->writeAccess;
+        pass->dstAccess |= access;
+    }
+    return VK_TRUE;
+}
+
+// Start state of instance at its first access in frame from accesses of
+// earlier frames, which the first pass using it waits on
+// Returns reads of earlier frames that later writes must still wait on
+static VkPipelineStageFlags seedState(ResourceState *state,
+    const RenderHistory *history, const RenderGraphPass *pass, const ResourceUse *use)
+{
+    state->queue = pass->queue;
+    state->writeStage = history->writeStages;
+    state->writeAccess = history->writeAccess;
+    state->readStages = history->readStages;
+    // Note: Barrier of a write waits on all earlier accesses, that of a
+    //       read only on earlier writes
+    return use->writeStage ? 0 : history->readStages;
+}
+
+void renderGraphCompile(RenderGraph *graph, uint32_t slot)
+{
+    cullPasses(graph);
+    
+    ResourceState states[RENDER_RESOURCE_COUNT][MAX_FRAMES_IN_FLIGHT] = {0};
+    RenderHistory histories[RENDER_RESOURCE_COUNT][MAX_FRAMES_IN_FLIGHT] = {0};
+    for (uint32_t i = 0; i < graph->passCount; ++i) {
+        RenderGraphPass *pass = &graph->passes[i];
+        pass->srcStage = 0;
+        pass->dstStage = 0;
+        pass->srcAccess = 0;
+        pass->dstAccess = 0;
+        pass->outputBarrier = VK_FALSE;
+        if (pass->culled) {
+            continue;
+        }
+        
+        ResourceUse uses[RENDER_RESOURCE_COUNT][MAX_FRAMES_IN_FLIGHT];
+        mergeUses(graph, pass, slot, uses);
+        for (uint32_t r = 0; r < RENDER_RESOURCE_COUNT; ++r) {
+            for (uint32_t k = 0; k < MAX_FRAMES_IN_FLIGHT; ++k) {
+                const ResourceUse *use = &uses[r][k];
+                if (!use->readStage && !use->writeStage) {
+                    continue;
+                }
+                ResourceState *state = &states[r][k];
+                RenderHistory *history = &histories[r][k];
+                const VkPipelineStageFlags stage = use->readStage ? use->readStage : use->writeStage;
+                const VkAccessFlags access = use->readStage ? use->readAccess : use->writeAccess;
+                
+                if (!state->touched && r == RENDER_RESOURCE_OUTPUT) {
+                    // Note: Output image is acquired
+                    graph->acquireWaitStages |= stage;
+                } else if (state->touched && state->queue != pass->queue) {
+                    if (pass->queue == RENDER_QUEUE_COMPUTE) {
+                        fprintf(stderr, "Compute pass %s reads results of graphics "
+                            "pass, but compute is submitted first\n", pass->name);
+                        exit(EXIT_FAILURE);
+                    }
+                    // Semaphore makes every write of compute submission visible
+                    graph->computeWaitStages |= stage;
+                    state->writeStage = 0;
+                    state->writeAccess = 0;
+                    state->readStages = 0;
+                } else {
+                    if (!state->touched) {
+                        // Note: Earlier frames used instance (same queue)
+                        history->readStages = seedState(state,
+                            &graph->history[r][k], pass, use);
+                    }
+                    if (addDependency(pass, (RenderResource)r, state, use)) {
+                        state->visibleStages |= stage;
+                        state->visibleAccess |= access;
+                    }
+                }
+                
+                state->touched = VK_TRUE;
+                state->queue = pass->queue;
+                if (use->writeStage) {
+                    state->writeStage = use->writeStage;
+                    state->writeAccess = use->writeAccess;
+                    state->visibleStages = 0;
+                    state->visibleAccess = 0;
+                    state->readStages = 0;
+                } else {
+                    state->readStages |= use->readStage;
+                }
+                if (use->exitLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                    state->layout = use->exitLayout;
+                } else if (use->layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                    state->layout = use->layout;
+                }
+                history->readStages |= use->readStage;
+                history->writeStages |= use->writeStage;
+                history->writeAccess |= use->writeAccess;
+            }
+        }
+    }
+    
+    // Accesses of this frame (and reads not waited on yet) are waited on
+    // by first pass using the same instance in a later frame
+    for (uint32_t r = 0; r < RENDER_RESOURCE_COUNT; ++r) {
+        for (uint32_t k = 0; k < MAX_FRAMES_IN_FLIGHT; ++k) {
+            if (r != RENDER_RESOURCE_OUTPUT && states[r][k].touched) {
+                graph->history[r][k] = histories[r][k];
+            }
+        }
+    }
+    
+    // Note: Semaphores are waited on even if no pass depends on them
+    if (!graph->computeWaitStages) {
+        graph->computeWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+    if (!graph->acquireWaitStages) {
+        graph->acquireWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+}
+
+// Barrier derived for pass, global for buffers
+static void recordBarrier(Graphics graphics, const RenderGraphPass *pass,
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (!pass->dstStage) {
+        return;
+    }
+    
+    VkMemoryBarrier memoryBarrier = {0};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = pass->srcAccess;
+    memoryBarrier.dstAccessMask = pass->dstAccess;
+    const uint32_t memoryBarrierCount = pass->srcAccess || pass->dstAccess ? 1 : 0;
+    
+    VkImageMemoryBarrier imageBarrier = {0};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = pass->outputSrcAccess;
+    imageBarrier.dstAccessMask = pass->outputDstAccess;
+    imageBarrier.oldLayout = pass->outputOldLayout;
+    imageBarrier.newLayout = pass->outputNewLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = graphics->swapChainData.images[imageIndex];
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+    const uint32_t imageBarrierCount = pass->outputBarrier ? 1 : 0;
+    
+    vkCmdPipelineBarrier(commandBuffer, pass->srcStage, pass->dstStage, 0,
+        memoryBarrierCount, &memoryBarrier, 0, NULL,
+        imageBarrierCount, &imageBarrier);
+}
+
+void renderGraphRecord(Graphics graphics, RenderQueue queue,
+    VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    const RenderGraph *graph = graphics->renderGraph;
+    
+    // Note: Consecutive passes of a group share one profiler pass
+    GpuPass group = GPU_PASS_COUNT;
+    for (uint32_t i = 0; i < graph->passCount; ++i) {
+        const RenderGraphPass *pass = &graph->passes[i];
+        if (pass->queue != queue || pass->culled) {
+            continue;
+        }
+        if (pass->profilerPass != group) {
+            if (group != GPU_PASS_COUNT) {
+                profilerEndPass(graphics, commandBuffer, group);
+            }
+            group = pass->profilerPass;
+            if (group != GPU_PASS_COUNT) {
+                profilerBeginPass(graphics, commandBuffer, group);
+            }
+        }
+        recordBarrier(graphics, pass, commandBuffer, imageIndex);
+        pass->record(graphics, commandBuffer, imageIndex);
+    }
+    if (group != GPU_PASS_COUNT) {
+        profilerEndPass(graphics, commandBuffer, group);
+    }
+}
+
+void cleanupRenderGraph(Graphics graphics)
+{
+    FREE_NULL(graphics->renderGraph);
+}
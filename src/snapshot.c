@@ -0,0 +1,372 @@
+#include "snapshot.h"
+#include "vkutils.h"
+
+#include <string.h>
+#include <fcntl.h>     // open
+#include <unistd.h>    // close
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+
+// Direction of snapshot.comp (specialization constant 0)
+typedef enum SnapshotCodecDirection {
+    SNAPSHOT_DECODE,  // quantized records -> particles
+    SNAPSHOT_ENCODE   // particles -> quantized records
+} SnapshotCodecDirection;
+
+// Pipeline converting between particles and quantized records, created
+// for a single submission
+typedef struct SnapshotCodec {
+    VkDescriptorSetLayout descriptorLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+} SnapshotCodec;
+
+static const uint32_t recordSizes[SNAPSHOT_ENCODING_COUNT] = {
+    sizeof(Particle), sizeof(QuantizedParticle)
+};
+
+// Particles read by next update step (see createShaderStorage())
+// Note: Also the slot initParticles() fills, since currentFrame starts at 0
+static VkBuffer nextParticles(Graphics graphics)
+{
+    return graphics->shaderStorage.buffers[
+        (graphics->currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+}
+
+static void createCodec(Graphics graphics, SnapshotCodec *codec,
+    SnapshotCodecDirection direction, VkBuffer particles, VkBuffer records)
+{
+    // Particles and quantized records (see snapshot.comp)
+    VkDescriptorSetLayoutBinding layoutBindings[2] = {0};
+    for (uint32_t i = 0; i < 2; ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = layoutBindings;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfo,
+        NULL, &codec->descriptorLayout),
+        "Failed to create snapshot descriptor set layout\n");
+    
+    VkDescriptorPoolSize poolSize = {0};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 2;
+    
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    
+    CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
+        &codec->descriptorPool), "Failed to create snapshot descriptor pool\n");
+    
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = codec->descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &codec->descriptorLayout;
+    
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+        &codec->descriptorSet), "Failed to allocate snapshot descriptor set\n");
+    
+    const VkBuffer buffers[2] = { particles, records };
+    VkDescriptorBufferInfo bufferInfos[2] = {0};
+    VkWriteDescriptorSet descriptorWrites[2] = {0};
+    for (uint32_t i = 0; i < 2; ++i) {
+        bufferInfos[i].buffer = buffers[i];
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+        
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = codec->descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(graphics->device, 2, descriptorWrites, 0, NULL);
+    
+    // Particle count as push constant
+    VkPushConstantRange pushConstantRange = {0};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &codec->descriptorLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfo,
+        NULL, &codec->pipelineLayout),
+        "Failed to create snapshot pipeline layout\n");
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/snapshot.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    const uint32_t encode = direction;
+    const VkSpecializationMapEntry encodeEntry = { 0, 0, sizeof(uint32_t) };
+    VkSpecializationInfo specInfo = {0};
+    specInfo.mapEntryCount = 1;
+    specInfo.pMapEntries = &encodeEntry;
+    specInfo.dataSize = sizeof(uint32_t);
+    specInfo.pData = &encode;
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = codec->pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specInfo;
+    
+    CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &codec->pipeline),
+        "Failed to create snapshot pipeline\n");
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+static void recordCodec(const SnapshotCodec *codec,
+    VkCommandBuffer commandBuffer, uint32_t particleCount)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        codec->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        codec->pipelineLayout, 0, 1, &codec->descriptorSet, 0, NULL);
+    vkCmdPushConstants(commandBuffer, codec->pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &particleCount);
+    vkCmdDispatch(commandBuffer, (particleCount + 255) / 256, 1, 1);
+}
+
+// Note: Submission using codec must have completed
+static void destroyCodec(Graphics graphics, SnapshotCodec *codec)
+{
+    vkDestroyPipeline(graphics->device, codec->pipeline, NULL);
+    vkDestroyPipelineLayout(graphics->device, codec->pipelineLayout, NULL);
+    vkDestroyDescriptorPool(graphics->device, codec->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device, codec->descriptorLayout, NULL);
+}
+
+Snapshot *openSnapshot(const char *path, Options *options)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open snapshot '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Snapshot '%s' is truncated\n", path);
+        exit(EXIT_FAILURE);
+    }
+    void *mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Note: Mapping stays valid after closing file
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Failed to map snapshot '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Validate header, records are used without further checks
+    const SnapshotHeader *header = (const SnapshotHeader *)mapped;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->headerSize != sizeof(SnapshotHeader))
+    {
+        fprintf(stderr, "'%s' is no snapshot of version %u\n", path,
+            SNAPSHOT_VERSION);
+        exit(EXIT_FAILURE);
+    }
+    if (header->encoding >= SNAPSHOT_ENCODING_COUNT ||
+        header->recordSize != recordSizes[header->encoding] ||
+        header->particleCount == 0 || header->particleCount > UINT32_MAX ||
+        header->dataOffset % SNAPSHOT_DATA_ALIGNMENT != 0 ||
+        header->dataSize != header->particleCount * header->recordSize ||
+        header->dataOffset > (uint64_t)info.st_size ||
+        header->dataSize > (uint64_t)info.st_size - header->dataOffset)
+    {
+        fprintf(stderr, "Snapshot '%s' is corrupt or truncated\n", path);
+        exit(EXIT_FAILURE);
+    }
+    
+    Snapshot *snapshot = NULL;
+    CHK_ALLOC(snapshot = (Snapshot *) calloc(1, sizeof(Snapshot)));
+    snapshot->header = header;
+    snapshot->records = (const char *)mapped + header->dataOffset;
+    snapshot->mappedSize = (size_t)info.st_size;
+    
+    // Note: Overrides --particles and --seed
+    options->particleCount = (uint32_t)header->particleCount;
+    options->seed = header->seed;
+    printf("Restoring %u particles from '%s' (show %u, %.2f s, %s)\n",
+        options->particleCount, path, header->show, header->elapsedTime,
+        header->encoding == SNAPSHOT_ENCODING_QUANTIZED ? "quantized" : "raw");
+    return snapshot;
+}
+
+void restoreSnapshot(Graphics graphics)
+{
+    Snapshot *snapshot = graphics->snapshot;
+    assert(snapshot && "Expected mapped snapshot");
+    const SnapshotHeader *header = snapshot->header;
+    const VkBool32 quantized = header->encoding == SNAPSHOT_ENCODING_QUANTIZED;
+    
+    uint32_t count = (uint32_t)header->particleCount;
+    if (graphics->options.particleCount < count) {
+        fprintf(stderr, "Dropping %u of %u snapshot particles to fit memory budget\n",
+            count - graphics->options.particleCount, count);
+        count = graphics->options.particleCount;
+    }
+    const VkDeviceSize size = (VkDeviceSize)count * header->recordSize;
+    
+    // Single copy of mapped records into staging memory, read by copy or
+    // decode pass
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(graphics->device, graphics->physicalDevice, size,
+        quantized ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer, &stagingMemory, MEMORY_STAGING);
+    void *mapped;
+    CHK_VK_ERR(vkMapMemory(graphics->device, stagingMemory, 0, size, 0, &mapped),
+        "Failed to map snapshot staging buffer\n");
+    memcpy(mapped, snapshot->records, (size_t)size);
+    vkUnmapMemory(graphics->device, stagingMemory);
+    
+    SnapshotCodec codec = {0};
+    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
+    if (quantized) {
+        createCodec(graphics, &codec, SNAPSHOT_DECODE, nextParticles(graphics),
+            stagingBuffer);
+        recordCodec(&codec, commandBuffer, count);
+    } else {
+        VkBufferCopy copyRegion = {0};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, nextParticles(graphics),
+            1, &copyRegion);
+    }
+    
+    // Make particles visible to all later submissions (same queue)
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = quantized ?
+        VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, quantized ?
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    endSingleUseCommands(graphics, commandBuffer);
+    
+    if (quantized) {
+        destroyCodec(graphics, &codec);
+    }
+    vkDestroyBuffer(graphics->device, stagingBuffer, NULL);
+    freeMemory(graphics->device, stagingMemory);
+    
+    // Resume show where it was saved
+    // Note: Key of random numbers stays (seed, show), so later shows repeat too
+    graphics->show = header->show;
+    graphics->lastFrameTime = header->elapsedTime;
+    graphics->timerStart = timerSeconds() - header->elapsedTime;
+    
+    munmap((void *)header, snapshot->mappedSize);
+    FREE_NULL(graphics->snapshot);
+}
+
+void saveSnapshot(Graphics graphics, const char *path)
+{
+    const SnapshotEncoding encoding = graphics->options.snapshotQuantize ?
+        SNAPSHOT_ENCODING_QUANTIZED : SNAPSHOT_ENCODING_RAW;
+    const VkBool32 quantized = encoding == SNAPSHOT_ENCODING_QUANTIZED;
+    const uint32_t count = graphics->options.particleCount;
+    const VkDeviceSize size = (VkDeviceSize)count * recordSizes[encoding];
+    
+    // Read back particles of next step (encoded on GPU if quantized)
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    createBuffer(graphics->device, graphics->physicalDevice, size,
+        quantized ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        readbackMemoryProperties(graphics->physicalDevice),
+        &readbackBuffer, &readbackMemory, MEMORY_STAGING);
+    
+    SnapshotCodec codec = {0};
+    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
+    if (quantized) {
+        createCodec(graphics, &codec, SNAPSHOT_ENCODE, nextParticles(graphics),
+            readbackBuffer);
+        recordCodec(&codec, commandBuffer, count);
+    } else {
+        VkBufferCopy copyRegion = {0};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, nextParticles(graphics), readbackBuffer,
+            1, &copyRegion);
+    }
+    
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = quantized ?
+        VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, quantized ?
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    endSingleUseCommands(graphics, commandBuffer);
+    
+    if (quantized) {
+        destroyCodec(graphics, &codec);
+    }
+    
+    SnapshotHeader header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.encoding = encoding;
+    header.recordSize = recordSizes[encoding];
+    header.particleCount = count;
+    header.dataOffset = SNAPSHOT_DATA_ALIGNMENT;
+    header.dataSize = size;
+    header.elapsedTime = graphics->lastFrameTime;
+    header.animationResetTime = ANIMATION_RESET_TIME;
+    header.seed = graphics->options.seed;
+    header.show = graphics->show;
+    
+    // Header, zero padding up to page boundary, records
+    static const char padding[SNAPSHOT_DATA_ALIGNMENT] = {0};
+    void *mapped;
+    CHK_VK_ERR(vkMapMemory(graphics->device, readbackMemory, 0, size, 0, &mapped),
+        "Failed to map snapshot readback buffer\n");
+    FILE *file = fopen(path, "wb");
+    const VkBool32 written = file &&
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(padding, SNAPSHOT_DATA_ALIGNMENT - sizeof(header), 1, file) == 1 &&
+        fwrite(mapped, (size_t)size, 1, file) == 1;
+    vkUnmapMemory(graphics->device, readbackMemory);
+    vkDestroyBuffer(graphics->device, readbackBuffer, NULL);
+    freeMemory(graphics->device, readbackMemory);
+    
+    // Note: Failing to save does not end the show
+    if (!file || fclose(file) != 0 || !written) {
+        fprintf(stderr, "Failed to write snapshot '%s'\n", path);
+        return;
+    }
+    printf("Saved snapshot of %u particles to '%s' (show %u, %.2f s, %.1f MiB)\n",
+        count, path, header.show, header.elapsedTime,
+        (double)(header.dataOffset + size) / (1024.0 * 1024.0));
+}
@@ -0,0 +1,388 @@
+#include "sparks.h"
+#include "profiler.h"
+#include "vkutils.h"
+
+#include <stddef.h>  // offsetof
+#include <string.h>
+
+// Counters following indirect arguments (see SparkState)
+#define SPARK_COUNTER_OFFSET offsetof(SparkState, count)
+#define SPARK_COUNTER_SIZE (3 * sizeof(uint32_t))
+
+static void createDescriptors(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    
+    // Parameters, input/output sparks and input/output state (see sparks.comp)
+    VkDescriptorSetLayoutBinding layoutBindings[5] = {0};
+    for (uint32_t i = 0; i < 5; ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = i == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 5;
+    layoutInfo.pBindings = layoutBindings;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfo,
+        NULL, &sparks->descriptor.layout),
+        "Failed to create spark descriptor set layout\n");
+    // Note: Sparks are drawn like stars, with their own particle binding
+    sparks->vertexDescriptor.layout = graphics->vertexDescriptor.layout;
+    
+    VkDescriptorPoolSize poolSizes[2] = {0};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * 2;
+    
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    // Note: Spark (4) and vertex (4) sets
+    poolSizes[1].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * (4 + 4);
+    
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = (uint32_t)MAX_FRAMES_IN_FLIGHT * 2;
+    
+    CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
+        &sparks->descriptorPool), "Failed to create spark descriptor pool\n");
+    
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        layouts[i] = sparks->descriptor.layout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = sparks->descriptorPool;
+    allocInfo.descriptorSetCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
+    allocInfo.pSetLayouts = layouts;
+    
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+        sparks->descriptor.sets), "Failed to allocate spark descriptor sets\n");
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        layouts[i] = sparks->vertexDescriptor.layout;
+    }
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+        sparks->vertexDescriptor.sets),
+        "Failed to allocate spark vertex descriptor sets\n");
+}
+
+static void createPipelines(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &sparks->descriptor.layout;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfo,
+        NULL, &sparks->pipelineLayout),
+        "Failed to create spark pipeline layout\n");
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/sparks.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = sparks->pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    
+    // Note: Pass is selected by specialization constant 0
+    const VkSpecializationMapEntry passEntry = { 0, 0, sizeof(uint32_t) };
+    for (uint32_t pass = 0; pass < SPARK_PASS_COUNT; ++pass) {
+        VkSpecializationInfo specInfo = {0};
+        specInfo.mapEntryCount = 1;
+        specInfo.pMapEntries = &passEntry;
+        specInfo.dataSize = sizeof(uint32_t);
+        specInfo.pData = &pass;
+        pipelineInfo.stage.pSpecializationInfo = &specInfo;
+        
+        CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+            &pipelineInfo, NULL, &sparks->pipelines[pass]),
+            "Failed to create spark pipeline\n");
+    }
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+static void writeDescriptor(Graphics graphics, VkDescriptorSet set,
+    uint32_t binding, VkDescriptorType type, VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo = {0};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    
+    VkWriteDescriptorSet descriptorWrite = {0};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = type;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    
+    vkUpdateDescriptorSets(graphics->device, 1, &descriptorWrite, 0, NULL);
+}
+
+static void createBuffers(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    const VkDeviceSize sparkSize = (VkDeviceSize)sparks->capacity * sizeof(Particle);
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        createBuffer(graphics->device, graphics->physicalDevice, sparkSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &sparks->sparks.buffers[i], &sparks->sparks.memories[i],
+            MEMORY_PARTICLES);
+        createBuffer(graphics->device, graphics->physicalDevice, sizeof(SparkState),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &sparks->states.buffers[i], &sparks->states.memories[i],
+            MEMORY_OTHER);
+        createBuffer(graphics->device, graphics->physicalDevice, SPARK_COUNTER_SIZE,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &sparks->readback.buffers[i], &sparks->readback.memories[i],
+            MEMORY_STAGING);
+        vkMapMemory(graphics->device, sparks->readback.memories[i], 0,
+            SPARK_COUNTER_SIZE, 0, &sparks->readback.mapped[i]);
+    }
+    
+    // No sparks and empty indirect dispatch/draw before first step
+    // Note: Dispatches and draws with a count of 0 do nothing
+    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        vkCmdFillBuffer(commandBuffer, sparks->states.buffers[i], 0,
+            sizeof(SparkState), 0);
+    }
+    endSingleUseCommands(graphics, commandBuffer);
+}
+
+static void writeDescriptors(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    const VkDescriptorType uniform = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    const VkDescriptorType storage = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        const uint32_t previous = (i + 1) % MAX_FRAMES_IN_FLIGHT;
+        
+        // Sparks appended by update dispatch (see shader.comp)
+        VkDescriptorSet set = graphics->computeDescriptor.sets[i];
+        writeDescriptor(graphics, set, SPARK_BINDING_SPARKS, storage,
+            sparks->sparks.buffers[i]);
+        writeDescriptor(graphics, set, SPARK_BINDING_STATE, storage,
+            sparks->states.buffers[i]);
+        
+        // Spark passes (see sparks.comp)
+        set = sparks->descriptor.sets[i];
+        writeDescriptor(graphics, set, 0, uniform,
+            graphics->deltaTimeUniform.buffers[i]);
+        writeDescriptor(graphics, set, 1, storage, sparks->sparks.buffers[previous]);
+        writeDescriptor(graphics, set, 2, storage, sparks->sparks.buffers[i]);
+        writeDescriptor(graphics, set, 3, storage, sparks->states.buffers[previous]);
+        writeDescriptor(graphics, set, 4, storage, sparks->states.buffers[i]);
+        
+        // Same bindings as star vertex set, but sparks instead of particles
+        // (see shader.vert)
+        set = sparks->vertexDescriptor.sets[i];
+        writeDescriptor(graphics, set, 0, uniform, graphics->mvpUniform.buffers[i]);
+        writeDescriptor(graphics, set, 1, storage, sparks->sparks.buffers[i]);
+        writeDescriptor(graphics, set, 2, storage, graphics->shapeVertices.buffer);
+        writeDescriptor(graphics, set, 3, storage, graphics->shapeInstances.buffers[i]);
+        writeDescriptor(graphics, set, 4, storage, graphics->drawCommands.buffers[i]);
+    }
+}
+
+void initSparks(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    Sparks *sparks = NULL;
+    CHK_ALLOC(sparks = calloc(1, sizeof(Sparks)));
+    graphics->sparks = sparks;
+    
+    const Options *options = &graphics->options;
+    sparks->enabled = options->sparksPerBurst > 0;
+    
+    // Note: Every star bursts once per show and sparks burn out long before
+    //       the next show, so one burst per star never overflows by default
+    uint64_t capacity = 1;
+    if (sparks->enabled) {
+        capacity = options->sparkCapacity > 0 ? options->sparkCapacity :
+            (uint64_t)options->particleCount * options->sparksPerBurst;
+        const uint64_t maxCapacity =
+            graphics->deviceProperties.limits.maxStorageBufferRange / sizeof(Particle);
+        const uint64_t maxGroups = (uint64_t)SPARK_LOCAL_SIZE *
+            graphics->deviceProperties.limits.maxComputeWorkGroupCount[0];
+        if (capacity > maxCapacity) {
+            capacity = maxCapacity;
+        }
+        if (capacity > maxGroups) {
+            capacity = maxGroups;
+        }
+    }
+    sparks->capacity = (uint32_t)capacity;
+    
+    createDescriptors(graphics);
+    createPipelines(graphics);
+    // Note: Bindings must be valid even if stars never burst
+    createBuffers(graphics);
+    writeDescriptors(graphics);
+}
+
+// Wait for writes of previous commands before reading/writing sparks again
+static void passBarrier(VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0,
+        1, &barrier, 0, NULL, 0, NULL);
+}
+
+void sparksRecordUpdate(Graphics graphics, VkCommandBuffer commandBuffer)
+{
+    const Sparks *sparks = graphics->sparks;
+    const uint32_t frame = graphics->currentFrame;
+    const uint32_t previous = (frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    
+    // Note: Render graph orders reset after earlier frames using buffers of
+    //       this slot (see buildFrameGraph())
+    vkCmdFillBuffer(commandBuffer, sparks->states.buffers[frame],
+        SPARK_COUNTER_OFFSET, SPARK_COUNTER_SIZE, 0);
+    passBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    
+    // Note: #work groups was written by finalize pass of previous step
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        sparks->pipelines[SPARK_PASS_UPDATE]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        sparks->pipelineLayout, 0, 1, &sparks->descriptor.sets[frame], 0, NULL);
+    vkCmdDispatchIndirect(commandBuffer, sparks->states.buffers[previous],
+        offsetof(SparkState, dispatch));
+    
+    // Survivors come first, bursting stars append behind them
+    passBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void sparksRecordFinalize(Graphics graphics, VkCommandBuffer commandBuffer)
+{
+    Sparks *sparks = graphics->sparks;
+    const uint32_t frame = graphics->currentFrame;
+    
+    passBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        sparks->pipelines[SPARK_PASS_FINALIZE]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        sparks->pipelineLayout, 0, 1, &sparks->descriptor.sets[frame], 0, NULL);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    
+    // Arguments are consumed by draw of this frame and update of next step
+    passBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+        VK_ACCESS_TRANSFER_READ_BIT);
+    
+    // Note: Counters are only reported, never read to size GPU work
+    const VkBufferCopy copyRegion = { SPARK_COUNTER_OFFSET, 0, SPARK_COUNTER_SIZE };
+    vkCmdCopyBuffer(commandBuffer, sparks->states.buffers[frame],
+        sparks->readback.buffers[frame], 1, &copyRegion);
+    passBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    sparks->pending[frame] = VK_TRUE;
+}
+
+void sparksRecordDraw(Graphics graphics, VkCommandBuffer commandBuffer)
+{
+    const Sparks *sparks = graphics->sparks;
+    const uint32_t frame = graphics->currentFrame;
+    
+    // Note: Sparks are small and short-lived, quads suffice at any size
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        graphics->graphicsPipelines[STAR_LOD_QUAD]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        graphics->pipelineLayout, 0, 1, &sparks->vertexDescriptor.sets[frame],
+        0, NULL);
+    const uint32_t baseShape = 0;
+    vkCmdPushConstants(commandBuffer, graphics->pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(baseShape), &baseShape);
+    // Note: #instances was written by finalize pass (see sparks.comp)
+    vkCmdDrawIndirect(commandBuffer, sparks->states.buffers[frame],
+        offsetof(SparkState, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+void sparksCollect(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    const uint32_t frame = graphics->currentFrame;
+    if (!sparks->pending[frame]) {
+        return;
+    }
+    sparks->pending[frame] = VK_FALSE;
+    
+    // Same order as GpuCounter (live, emitted, dropped)
+    uint32_t counters[GPU_COUNTER_COUNT];
+    memcpy(counters, sparks->readback.mapped[frame], SPARK_COUNTER_SIZE);
+    profilerSetCounters(graphics, counters);
+}
+
+void cleanupSparks(Graphics graphics)
+{
+    Sparks *sparks = graphics->sparks;
+    if (!sparks) {
+        return;
+    }
+    
+    for (uint32_t pass = 0; pass < SPARK_PASS_COUNT; ++pass) {
+        vkDestroyPipeline(graphics->device, sparks->pipelines[pass], NULL);
+    }
+    vkDestroyPipelineLayout(graphics->device, sparks->pipelineLayout, NULL);
+    // Note: Vertex layout is owned by graphics
+    vkDestroyDescriptorPool(graphics->device, sparks->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device, sparks->descriptor.layout, NULL);
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        vkDestroyBuffer(graphics->device, sparks->sparks.buffers[i], NULL);
+        freeMemory(graphics->device, sparks->sparks.memories[i]);
+        vkDestroyBuffer(graphics->device, sparks->states.buffers[i], NULL);
+        freeMemory(graphics->device, sparks->states.memories[i]);
+        // Note: Freeing memory implicitly unmaps it
+        vkDestroyBuffer(graphics->device, sparks->readback.buffers[i], NULL);
+        freeMemory(graphics->device, sparks->readback.memories[i]);
+    }
+    
+    FREE_NULL(graphics->sparks);
+}
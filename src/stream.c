@@ -0,0 +1,443 @@
+#include "stream.h"
+#include "vkutils.h"
+#include "trace.h"
+
+#include <string.h>
+#include <fcntl.h>     // O_* constants
+#include <unistd.h>    // ftruncate, close
+#include <sys/mman.h>  // shm_open, mmap
+
+// Push constants of pack pass (see stream.comp)
+typedef struct StreamConstants {
+    uint32_t particleCount;
+    uint32_t fieldMask;
+    uint32_t offsets[STREAM_FIELD_COUNT];  // words from slot start
+} StreamConstants;
+
+static const char *const fieldNames[STREAM_FIELD_COUNT] = {
+    "position", "velocity", "color", "orientation", "shape"
+};
+
+// Bytes per particle of every field (see StreamField)
+static const uint32_t fieldSizes[STREAM_FIELD_COUNT] = { 8, 8, 4, 4, 4 };
+
+uint32_t streamParseFields(const char *list)
+{
+    uint32_t mask = 0;
+    while (*list) {
+        const char *end = strchr(list, ',');
+        const size_t length = end ? (size_t)(end - list) : strlen(list);
+        uint32_t field = 0;
+        while (field < STREAM_FIELD_COUNT &&
+               (strlen(fieldNames[field]) != length ||
+                strncmp(fieldNames[field], list, length) != 0))
+        {
+            ++field;
+        }
+        if (field == STREAM_FIELD_COUNT) {
+            return 0;
+        }
+        mask |= 1u << field;
+        list += end ? length + 1 : length;
+    }
+    return mask;
+}
+
+static VkDeviceSize alignUp(VkDeviceSize size, VkDeviceSize alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Frame header first, then one array per selected field
+static void computeLayout(Graphics graphics)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    VkDeviceSize offset = alignUp(sizeof(StreamFrameHeader), STREAM_FIELD_ALIGNMENT);
+    for (uint32_t field = 0; field < STREAM_FIELD_COUNT; ++field) {
+        stream->fieldOffsets[field] = 0;
+        if (stream->fieldMask & (1u << field)) {
+            stream->fieldOffsets[field] = offset;
+            offset += alignUp((VkDeviceSize)graphics->options.particleCount *
+                fieldSizes[field], STREAM_FIELD_ALIGNMENT);
+        }
+    }
+    stream->slotSize = offset;
+}
+
+static void createRing(ParticleStream *stream)
+{
+    const VkDeviceSize slotOffset =
+        alignUp(sizeof(StreamRingHeader), STREAM_FIELD_ALIGNMENT);
+    stream->ringSize = (size_t)(slotOffset + STREAM_SLOT_COUNT * stream->slotSize);
+    
+    // Note: Replaces object left behind by a previous run
+    const int fd = shm_open(stream->name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)stream->ringSize) != 0) {
+        fprintf(stderr, "Failed to create shared memory '%s'\n", stream->name);
+        exit(EXIT_FAILURE);
+    }
+    void *mapped = mmap(NULL, stream->ringSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Failed to map shared memory '%s'\n", stream->name);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Note: New object is zero-filled -> all slot sequences are 0
+    stream->ring = (StreamRingHeader *)mapped;
+    stream->ring->version = STREAM_VERSION;
+    stream->ring->slotCount = STREAM_SLOT_COUNT;
+    stream->ring->slotOffset = slotOffset;
+    stream->ring->slotSize = stream->slotSize;
+    atomic_store(&stream->ring->latest, 0);
+    // Magic last, readers check it before anything else
+    memcpy(stream->ring->magic, STREAM_MAGIC, sizeof(stream->ring->magic));
+}
+
+static void createPipeline(Graphics graphics)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    // Particles and readback buffer (see stream.comp)
+    VkDescriptorSetLayoutBinding layoutBindings[2] = {0};
+    for (uint32_t i = 0; i < 2; ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = layoutBindings;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfo,
+        NULL, &stream->descriptorLayout),
+        "Failed to create stream descriptor set layout\n");
+    
+    const uint32_t setCount = MAX_FRAMES_IN_FLIGHT * STREAM_SLOT_COUNT;
+    VkDescriptorPoolSize poolSize = {0};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 2 * setCount;
+    
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = setCount;
+    
+    CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
+        &stream->descriptorPool), "Failed to create stream descriptor pool\n");
+    
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+        for (uint32_t s = 0; s < STREAM_SLOT_COUNT; ++s) {
+            VkDescriptorSetAllocateInfo allocInfo = {0};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = stream->descriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &stream->descriptorLayout;
+            
+            CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+                &stream->sets[frame][s]),
+                "Failed to allocate stream descriptor set\n");
+            
+            // Particles written by step of frame slot, readback buffer s
+            const VkBuffer buffers[2] = {
+                graphics->shaderStorage.buffers[frame], stream->slots[s].buffer
+            };
+            VkDescriptorBufferInfo bufferInfos[2] = {0};
+            VkWriteDescriptorSet descriptorWrites[2] = {0};
+            for (uint32_t i = 0; i < 2; ++i) {
+                bufferInfos[i].buffer = buffers[i];
+                bufferInfos[i].offset = 0;
+                bufferInfos[i].range = VK_WHOLE_SIZE;
+                
+                descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[i].dstSet = stream->sets[frame][s];
+                descriptorWrites[i].dstBinding = i;
+                descriptorWrites[i].dstArrayElement = 0;
+                descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorWrites[i].descriptorCount = 1;
+                descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+            }
+            vkUpdateDescriptorSets(graphics->device, 2, descriptorWrites, 0, NULL);
+        }
+    }
+    
+    VkPushConstantRange pushConstantRange = {0};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(StreamConstants);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &stream->descriptorLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfo,
+        NULL, &stream->pipelineLayout),
+        "Failed to create stream pipeline layout\n");
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/stream.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = stream->pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    
+    CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+        &pipelineInfo, NULL, &stream->pipeline),
+        "Failed to create stream pipeline\n");
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+// Copy captured slot into shared-memory slot of next sequence number
+static void publishSlot(ParticleStream *stream, const StreamSlot *slot)
+{
+    TRACE_SCOPE("publish particles");
+    const uint64_t sequence = ++stream->sequence;
+    char *shared = (char *)stream->ring + stream->ring->slotOffset +
+        (sequence % STREAM_SLOT_COUNT) * stream->slotSize;
+    StreamFrameHeader *header = (StreamFrameHeader *)shared;
+    
+    // Seqlock: odd while written, readers discard copies overlapping it
+    atomic_store_explicit(&header->sequence, 2 * sequence - 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    // Note: Sequence of captured header is skipped
+    const size_t skip = sizeof(header->sequence);
+    memcpy(shared + skip, (const char *)slot->mapped + skip,
+        (size_t)stream->slotSize - skip);
+    atomic_store_explicit(&header->sequence, 2 * sequence, memory_order_release);
+    atomic_store_explicit(&stream->ring->latest, sequence, memory_order_release);
+}
+
+static void *publisherThread(void *arg)
+{
+    ParticleStream *stream = (ParticleStream *)arg;
+    traceSetThreadName("stream publisher");
+    
+    pthread_mutex_lock(&stream->mutex);
+    for (;;) {
+        while (stream->queueCount == 0 && !stream->stop) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+        if (stream->queueCount == 0) {
+            break;  // stop requested and all captures published
+        }
+        
+        StreamSlot *slot = &stream->slots[stream->queue[stream->queueHead]];
+        stream->queueHead = (stream->queueHead + 1) % STREAM_SLOT_COUNT;
+        stream->queueCount--;
+        slot->state = STREAM_SLOT_PUBLISHING;
+        
+        // Note: Copy happens without holding the lock
+        pthread_mutex_unlock(&stream->mutex);
+        publishSlot(stream, slot);
+        pthread_mutex_lock(&stream->mutex);
+        
+        stream->published++;
+        slot->state = STREAM_SLOT_FREE;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    
+    return NULL;
+}
+
+void initStream(Graphics graphics)
+{
+    assert(graphics && graphics->options.streamName &&
+        "Expected graphics handle with stream enabled");
+    
+    ParticleStream *stream = NULL;
+    CHK_ALLOC(stream = calloc(1, sizeof(ParticleStream)));
+    graphics->stream = stream;
+    
+    stream->name = graphics->options.streamName;
+    stream->fieldMask = graphics->options.streamFields;
+    stream->interval = graphics->options.streamInterval;
+    computeLayout(graphics);
+    createRing(stream);
+    
+    // Note: Written by pack pass through PCIe (or shared memory), read by host
+    const VkMemoryPropertyFlags memProps =
+        readbackMemoryProperties(graphics->physicalDevice);
+    for (uint32_t i = 0; i < STREAM_SLOT_COUNT; ++i) {
+        StreamSlot *slot = &stream->slots[i];
+        createBuffer(graphics->device, graphics->physicalDevice,
+            stream->slotSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, memProps,
+            &slot->buffer, &slot->memory, MEMORY_STAGING);
+        CHK_VK_ERR(vkMapMemory(graphics->device, slot->memory, 0,
+            stream->slotSize, 0, &slot->mapped),
+            "Failed to map stream readback buffer\n");
+        slot->state = STREAM_SLOT_FREE;
+    }
+    createPipeline(graphics);
+    
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    if (pthread_create(&stream->thread, NULL, publisherThread, stream) != 0) {
+        fprintf(stderr, "Failed to start stream publisher thread\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("Streaming particles to shared memory '%s' every %u frames "
+        "(%.2f MiB per capture)\n", stream->name, stream->interval,
+        (double)stream->slotSize / (1024.0 * 1024.0));
+}
+
+// Oldest capture whose pack pass has not been handed to the publisher yet
+static StreamSlot *oldestPendingSlot(ParticleStream *stream)
+{
+    StreamSlot *oldest = NULL;
+    for (uint32_t i = 0; i < STREAM_SLOT_COUNT; ++i) {
+        StreamSlot *slot = &stream->slots[i];
+        if (slot->state == STREAM_SLOT_PENDING &&
+            (!oldest || slot->frame < oldest->frame))
+        {
+            oldest = slot;
+        }
+    }
+    return oldest;
+}
+
+// Queue completed captures in frame order (requires stream->mutex)
+static void queueCompletedSlots(Graphics graphics, VkFence computeFence)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    StreamSlot *slot = NULL;
+    while ((slot = oldestPendingSlot(stream))) {
+        // Note: Fences are polled, never waited on
+        if (slot->fence != computeFence &&
+            vkGetFenceStatus(graphics->device, slot->fence) != VK_SUCCESS)
+        {
+            break;  // keep frame order, later captures wait for this one
+        }
+        
+        const uint32_t tail = (stream->queueHead + stream->queueCount) %
+            STREAM_SLOT_COUNT;
+        stream->queue[tail] = (uint32_t)(slot - stream->slots);
+        stream->queueCount++;
+        slot->state = STREAM_SLOT_QUEUED;
+        pthread_cond_signal(&stream->cond);
+    }
+}
+
+void streamPoll(Graphics graphics, VkFence computeFence)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    pthread_mutex_lock(&stream->mutex);
+    queueCompletedSlots(graphics, computeFence);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+void streamRecordCapture(Graphics graphics, VkCommandBuffer commandBuffer)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    // Note: Never waits, capture is dropped if publisher lags behind
+    StreamSlot *slot = NULL;
+    pthread_mutex_lock(&stream->mutex);
+    for (uint32_t i = 0; i < STREAM_SLOT_COUNT && !slot; ++i) {
+        if (stream->slots[i].state == STREAM_SLOT_FREE) {
+            slot = &stream->slots[i];
+            slot->state = STREAM_SLOT_PENDING;
+            slot->fence = graphics->sync.computeInFlightFences[graphics->currentFrame];
+            slot->frame = graphics->frameCounter;
+        }
+    }
+    if (!slot) {
+        stream->dropped++;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    if (!slot) {
+        return;
+    }
+    
+    // Frame header ahead of field arrays, which the pack pass fills
+    StreamFrameHeader *header = (StreamFrameHeader *)slot->mapped;
+    header->frame = graphics->frameCounter;
+    header->time = graphics->lastFrameTime;
+    header->show = graphics->show;
+    header->particleCount = graphics->options.particleCount;
+    header->fieldMask = stream->fieldMask;
+    memcpy(header->fieldOffsets, stream->fieldOffsets, sizeof(header->fieldOffsets));
+    
+    StreamConstants constants = {0};
+    constants.particleCount = graphics->options.particleCount;
+    constants.fieldMask = stream->fieldMask;
+    for (uint32_t field = 0; field < STREAM_FIELD_COUNT; ++field) {
+        constants.offsets[field] = (uint32_t)(stream->fieldOffsets[field] / 4);
+    }
+    
+    // Note: Barrier after update dispatch already covers reads of particles
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        stream->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        stream->pipelineLayout, 0, 1,
+        &stream->sets[graphics->currentFrame][slot - stream->slots], 0, NULL);
+    vkCmdPushConstants(commandBuffer, stream->pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (constants.particleCount + 255) / 256, 1, 1);
+    
+    // Make packed fields visible to host once compute fence is signalled
+    VkBufferMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot->buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+void cleanupStream(Graphics graphics)
+{
+    ParticleStream *stream = graphics->stream;
+    
+    // Device is idle -> every pending pack pass has completed
+    pthread_mutex_lock(&stream->mutex);
+    queueCompletedSlots(graphics, VK_NULL_HANDLE);
+    stream->stop = VK_TRUE;
+    pthread_cond_signal(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+    
+    pthread_join(stream->thread, NULL);
+    pthread_cond_destroy(&stream->cond);
+    pthread_mutex_destroy(&stream->mutex);
+    
+    fprintf(stderr, "Stream: %llu captures published, %llu dropped\n",
+        (unsigned long long)stream->published,
+        (unsigned long long)stream->dropped);
+    
+    // Note: Readers keep their mappings, name is free for next run
+    munmap(stream->ring, stream->ringSize);
+    shm_unlink(stream->name);
+    
+    vkDestroyPipeline(graphics->device, stream->pipeline, NULL);
+    vkDestroyPipelineLayout(graphics->device, stream->pipelineLayout, NULL);
+    vkDestroyDescriptorPool(graphics->device, stream->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device, stream->descriptorLayout, NULL);
+    for (uint32_t i = 0; i < STREAM_SLOT_COUNT; ++i) {
+        vkDestroyBuffer(graphics->device, stream->slots[i].buffer, NULL);
+        freeMemory(graphics->device, stream->slots[i].memory);
+    }
+    FREE_NULL(graphics->stream);
+}
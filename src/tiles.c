@@ -0,0 +1,408 @@
+#include "tiles.h"
+#include "vkutils.h"
+
+// Output flags for swapchain format, VK_FALSE if pixels cannot be packed
+static VkBool32 outputFlags(VkFormat format, uint32_t *flags)
+{
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            *flags = TILE_OUTPUT_SRGB;
+            return VK_TRUE;
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            *flags = TILE_OUTPUT_BGRA | TILE_OUTPUT_SRGB;
+            return VK_TRUE;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            *flags = 0;
+            return VK_TRUE;
+        case VK_FORMAT_B8G8R8A8_UNORM:
+            *flags = TILE_OUTPUT_BGRA;
+            return VK_TRUE;
+        default:
+            return VK_FALSE;
+    }
+}
+
+static void createDescriptors(Graphics graphics)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    
+    // Stars, particles, counts, offsets, entries and pixels (see tiles.comp)
+    VkDescriptorSetLayoutBinding layoutBindings[6] = {0};
+    for (uint32_t i = 0; i < 6; ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = i == 0 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {0};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 6;
+    layoutInfo.pBindings = layoutBindings;
+    
+    CHK_VK_ERR(vkCreateDescriptorSetLayout(graphics->device, &layoutInfo,
+        NULL, &tiles->descriptor.layout),
+        "Failed to create tile descriptor set layout\n");
+    
+    VkDescriptorPoolSize poolSizes[2] = {0};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
+    
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT * 5;
+    
+    VkDescriptorPoolCreateInfo poolInfo = {0};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = (uint32_t)MAX_FRAMES_IN_FLIGHT;
+    
+    CHK_VK_ERR(vkCreateDescriptorPool(graphics->device, &poolInfo, NULL,
+        &tiles->descriptorPool), "Failed to create tile descriptor pool\n");
+    
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        layouts[i] = tiles->descriptor.layout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = tiles->descriptorPool;
+    allocInfo.descriptorSetCount = (uint32_t)MAX_FRAMES_IN_FLIGHT;
+    allocInfo.pSetLayouts = layouts;
+    
+    CHK_VK_ERR(vkAllocateDescriptorSets(graphics->device, &allocInfo,
+        tiles->descriptor.sets), "Failed to allocate tile descriptor sets\n");
+}
+
+static void createPipelines(Graphics graphics)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    
+    VkPushConstantRange pushConstantRange = {0};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(TileConstants);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {0};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &tiles->descriptor.layout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    CHK_VK_ERR(vkCreatePipelineLayout(graphics->device, &pipelineLayoutInfo,
+        NULL, &tiles->pipelineLayout),
+        "Failed to create tile pipeline layout\n");
+    
+    uint32_t shaderSize = 0;
+    char *shaderSource = readBinFile("shaders/bin/tiles.spv", &shaderSize);
+    VkShaderModule shaderModule = createShaderModule(graphics->device,
+        shaderSource, shaderSize);
+    
+    VkComputePipelineCreateInfo pipelineInfo = {0};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = tiles->pipelineLayout;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    
+    // Note: Pass is selected by specialization constant 0
+    const VkSpecializationMapEntry passEntry = { 0, 0, sizeof(uint32_t) };
+    for (uint32_t pass = 0; pass < TILE_PASS_COUNT; ++pass) {
+        VkSpecializationInfo specInfo = {0};
+        specInfo.mapEntryCount = 1;
+        specInfo.pMapEntries = &passEntry;
+        specInfo.dataSize = sizeof(uint32_t);
+        specInfo.pData = &pass;
+        pipelineInfo.stage.pSpecializationInfo = &specInfo;
+        
+        CHK_VK_ERR(vkCreateComputePipelines(graphics->device, VK_NULL_HANDLE, 1,
+            &pipelineInfo, NULL, &tiles->pipelines[pass]),
+            "Failed to create tile pipeline\n");
+    }
+    
+    vkDestroyShaderModule(graphics->device, shaderModule, NULL);
+    free(shaderSource);
+}
+
+static void writeDescriptor(Graphics graphics, uint32_t frame, uint32_t binding,
+    VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo = {0};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    
+    VkWriteDescriptorSet descriptorWrite = {0};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = graphics->tiles->descriptor.sets[frame];
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = binding == 0 ?
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    
+    vkUpdateDescriptorSets(graphics->device, 1, &descriptorWrite, 0, NULL);
+}
+
+static void createTileBuffer(Graphics graphics, VkDeviceSize size,
+    VkBufferUsageFlags usage, MemoryCategory category, BufferResource *resource)
+{
+    createBuffer(graphics->device, graphics->physicalDevice, size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &resource->buffer, &resource->memory, category);
+}
+
+static void cleanupTileBuffer(Graphics graphics, BufferResource *resource)
+{
+    vkDestroyBuffer(graphics->device, resource->buffer, NULL);
+    freeMemory(graphics->device, resource->memory);
+    *resource = (BufferResource) {0};
+}
+
+static void cleanupTileBuffers(Graphics graphics)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    cleanupTileBuffer(graphics, &tiles->counts);
+    cleanupTileBuffer(graphics, &tiles->offsets);
+    cleanupTileBuffer(graphics, &tiles->entries);
+    cleanupTileBuffer(graphics, &tiles->pixels);
+}
+
+void initTileRasterizer(Graphics graphics)
+{
+    assert(graphics && "Expected non-NULL graphics handle");
+    
+    TileRasterizer *tiles = NULL;
+    CHK_ALLOC(tiles = calloc(1, sizeof(TileRasterizer)));
+    graphics->tiles = tiles;
+    
+    createDescriptors(graphics);
+    createPipelines(graphics);
+    
+    // Note: Bins hold a few tiles per particle on average, large stars
+    //       overlapping many tiles are drawn by pipeline in auto mode
+    uint64_t capacity = (uint64_t)graphics->options.particleCount *
+        TILE_ENTRIES_PER_PARTICLE;
+    const uint64_t maxCapacity =
+        graphics->deviceProperties.limits.maxStorageBufferRange / sizeof(uint32_t);
+    if (capacity > maxCapacity) {
+        capacity = maxCapacity;
+    }
+    tiles->constants.particleCount = graphics->options.particleCount;
+    tiles->constants.entryCapacity = (uint32_t)capacity;
+    createTileBuffer(graphics, capacity * sizeof(uint32_t), 0,
+        MEMORY_PARTICLES, &tiles->entries);
+    
+    // Uniforms and particles of every frame
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        writeDescriptor(graphics, i, 0, graphics->mvpUniform.buffers[i]);
+        writeDescriptor(graphics, i, 1, graphics->shaderStorage.buffers[i]);
+        writeDescriptor(graphics, i, 4, tiles->entries.buffer);
+    }
+    
+    tilesResize(graphics);
+    
+    if (graphics->options.rasterizer == RASTERIZER_TILES && !tiles->supported) {
+        fprintf(stderr, "Tile rasterizer cannot write swapchain images, "
+            "using graphics pipeline instead\n");
+    }
+}
+
+void tilesResize(Graphics graphics)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    
+    // Note: Swapchain images must be copy destinations (always true offscreen)
+    const VkBool32 copyable = graphics->options.headless ||
+        (graphics->swapChainSupport.capabilities.supportedUsageFlags &
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    tiles->supported = copyable &&
+        outputFlags(graphics->swapChainData.format, &tiles->constants.outputFlags);
+    
+    const VkExtent2D extent = graphics->swapChainData.extent;
+    tiles->constants.width = extent.width;
+    tiles->constants.height = extent.height;
+    tiles->constants.tilesX = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles->constants.tilesY = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+    
+    const VkDeviceSize tileCount =
+        (VkDeviceSize)tiles->constants.tilesX * tiles->constants.tilesY;
+    const VkDeviceSize pixelCount = (VkDeviceSize)extent.width * extent.height;
+    
+    // Release buffers of previous extent
+    if (tiles->pixels.buffer != VK_NULL_HANDLE) {
+        cleanupTileBuffer(graphics, &tiles->counts);
+        cleanupTileBuffer(graphics, &tiles->offsets);
+        cleanupTileBuffer(graphics, &tiles->pixels);
+    }
+    createTileBuffer(graphics, tileCount * sizeof(uint32_t),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_ATTACHMENTS, &tiles->counts);
+    createTileBuffer(graphics, tileCount * sizeof(uint32_t), 0,
+        MEMORY_ATTACHMENTS, &tiles->offsets);
+    createTileBuffer(graphics, pixelCount * sizeof(uint32_t),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_ATTACHMENTS, &tiles->pixels);
+    
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        writeDescriptor(graphics, i, 2, tiles->counts.buffer);
+        writeDescriptor(graphics, i, 3, tiles->offsets.buffer);
+        writeDescriptor(graphics, i, 5, tiles->pixels.buffer);
+    }
+}
+
+VkBool32 tilesSelect(Graphics graphics)
+{
+    const Options *options = &graphics->options;
+    // Note: Trails accumulate frames in render pass attachment (see --trails),
+    //       sparks are drawn indirectly by the graphics pipeline (see --sparks)
+    if (!graphics->tiles->supported || options->rasterizer == RASTERIZER_PIPELINE ||
+        options->trailDecay > 0.0f || options->sparksPerBurst > 0)
+    {
+        return VK_FALSE;
+    }
+    if (options->rasterizer == RASTERIZER_TILES) {
+        return VK_TRUE;
+    }
+    // Note: Tiles replace signed distance pipelines only, large stars overlap
+    //       too many tiles and are cheaper as meshes
+    return options->particleCount >= options->tileThreshold &&
+        graphics->starLod != STAR_LOD_MESH;
+}
+
+// Wait for writes of previous pass before reading/writing bins again
+static void passBarrier(VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess)
+{
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+void tilesRecordFrame(Graphics graphics, VkCommandBuffer commandBuffer,
+    uint32_t imageIndex)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    const TileConstants *constants = &tiles->constants;
+    
+    // Previous frame may still use bins and pixels (same queue)
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        1, &barrier, 0, NULL, 0, NULL);
+    
+    vkCmdFillBuffer(commandBuffer, tiles->counts.buffer, 0, VK_WHOLE_SIZE, 0);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        tiles->pipelineLayout, 0, 1,
+        &tiles->descriptor.sets[graphics->currentFrame], 0, NULL);
+    vkCmdPushConstants(commandBuffer, tiles->pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TileConstants), constants);
+    
+    // Note: 256 invocations per work group, 1 per particle or pixel of tile
+    const uint32_t particleGroups = (constants->particleCount + 255) / 256;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        tiles->pipelines[TILE_PASS_BIN]);
+    vkCmdDispatch(commandBuffer, particleGroups, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        tiles->pipelines[TILE_PASS_SCAN]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        tiles->pipelines[TILE_PASS_SCATTER]);
+    vkCmdDispatch(commandBuffer, particleGroups, 1, 1);
+    passBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        tiles->pipelines[TILE_PASS_RASTER]);
+    vkCmdDispatch(commandBuffer, constants->tilesX, constants->tilesY, 1);
+    
+    // Copy pixels into image once rasterized
+    // Note: Transfer stage waits on image acquisition (see draw())
+    const VkImage image = graphics->swapChainData.images[imageIndex];
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    
+    VkImageMemoryBarrier imageBarrier = {0};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;  // contents are replaced
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = 1;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+    
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 1, &imageBarrier);
+    
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;  // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = (VkOffset3D) {0, 0, 0};
+    region.imageExtent = (VkExtent3D) {constants->width, constants->height, 1};
+    
+    vkCmdCopyBufferToImage(commandBuffer, tiles->pixels.buffer, image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    
+    // Leave image in layout of render pass output (see createRenderPass())
+    // Note: Export copies image afterwards (see exportRecordFrame())
+    imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.newLayout = graphics->options.headless ?
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        0, 0, NULL, 0, NULL, 1, &imageBarrier);
+}
+
+void cleanupTileRasterizer(Graphics graphics)
+{
+    TileRasterizer *tiles = graphics->tiles;
+    if (!tiles) {
+        return;
+    }
+    
+    cleanupTileBuffers(graphics);
+    for (uint32_t i = 0; i < TILE_PASS_COUNT; ++i) {
+        vkDestroyPipeline(graphics->device, tiles->pipelines[i], NULL);
+    }
+    vkDestroyPipelineLayout(graphics->device, tiles->pipelineLayout, NULL);
+    // Note: Descriptor sets are freed along with their pool
+    vkDestroyDescriptorPool(graphics->device, tiles->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(graphics->device, tiles->descriptor.layout, NULL);
+    
+    FREE_NULL(graphics->tiles);
+}
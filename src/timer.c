@@ -0,0 +1,16 @@
+#include "timer.h"
+
+#include <time.h>  // clock_gettime()
+
+uint64_t timerNanoseconds(void)
+{
+    struct timespec ts;
+    // Note: Unaffected by changes of the system time (unlike gettimeofday)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+double timerSeconds(void)
+{
+    return (double)timerNanoseconds() * 1e-9;
+}
@@ -0,0 +1,157 @@
+#include "trace.h"
+#include "graphics.h"
+
+#include <stdatomic.h>
+
+typedef struct TraceEvent {
+    const char *name;
+    uint64_t start;     // timerNanoseconds() at begin of event
+    uint64_t end;       // timerNanoseconds() at end of event
+    uint32_t track;     // thread id in trace
+} TraceEvent;
+
+// Single producer ring, owned by one thread
+typedef struct TraceRing {
+    TraceEvent events[TRACE_RING_SIZE];
+    _Atomic uint64_t head;    // #events recorded so far (only owner writes)
+    uint32_t track;           // thread id of owner
+    const char *threadName;   // NULL -> unnamed
+    struct TraceRing *next;   // list of all rings (see traceRings)
+} TraceRing;
+
+int traceActive = 0;
+
+static FILE *traceStream = NULL;
+static uint64_t traceStart = 0;  // origin of trace timeline
+// Note: Rings are only ever prepended while tracing
+static _Atomic(TraceRing *) traceRings = NULL;
+static atomic_uint nextTrack = TRACE_GPU_TRACK + 1;
+static _Thread_local TraceRing *threadRing = NULL;
+
+void traceInit(const char *path)
+{
+    if (!path) {
+        return;
+    }
+    // Note: Opened first, since writing to stdout redirects printf()
+    traceStream = openOutputFile(path);
+    traceStart = timerNanoseconds();
+    traceActive = 1;
+}
+
+// Ring of calling thread, registered on first use
+static TraceRing *getThreadRing(void)
+{
+    if (!threadRing) {
+        TraceRing *ring = NULL;
+        CHK_ALLOC(ring = calloc(1, sizeof(TraceRing)));
+        ring->track = atomic_fetch_add(&nextTrack, 1);
+        
+        // Lock-free push onto list of rings
+        TraceRing *head = atomic_load(&traceRings);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak(&traceRings, &head, ring));
+        threadRing = ring;
+    }
+    return threadRing;
+}
+
+static void pushEvent(const char *name, uint64_t start, uint64_t end,
+    uint32_t track)
+{
+    TraceRing *ring = getThreadRing();
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    // Note: Overwrites oldest event once ring is full
+    ring->events[head % TRACE_RING_SIZE] = (TraceEvent) {
+        name, start, end, track
+    };
+    // Publish event to traceShutdown()
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void traceSetThreadName(const char *name)
+{
+    if (traceActive) {
+        getThreadRing()->threadName = name;
+    }
+}
+
+void traceRecord(const char *name, uint64_t start, uint64_t end)
+{
+    pushEvent(name, start, end, getThreadRing()->track);
+}
+
+void traceRecordGpu(const char *name, uint64_t start, uint64_t end)
+{
+    pushEvent(name, start, end, TRACE_GPU_TRACK);
+}
+
+// Microseconds since begin of trace (events may precede it slightly)
+static double traceMicroseconds(uint64_t time)
+{
+    return (double)(int64_t)(time - traceStart) * 1e-3;
+}
+
+static void writeThreadName(FILE *stream, uint32_t track, const char *name)
+{
+    fprintf(stream, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+        "\"tid\": %u, \"args\": {\"name\": \"%s\"}}", track, name);
+}
+
+void traceShutdown(void)
+{
+    if (!traceActive) {
+        return;
+    }
+    traceActive = 0;
+    
+    FILE *stream = traceStream;
+    fprintf(stream, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(stream, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+        "\"args\": {\"name\": \"Fireworks\"}}");
+    writeThreadName(stream, TRACE_GPU_TRACK, "GPU");
+    
+    uint64_t written = 0;
+    uint64_t overwritten = 0;
+    TraceRing *ring = atomic_load(&traceRings);
+    while (ring) {
+        char name[32];
+        if (!ring->threadName) {
+            snprintf(name, sizeof(name), "thread %u", ring->track);
+        }
+        writeThreadName(stream, ring->track,
+            ring->threadName ? ring->threadName : name);
+        
+        const uint64_t head = atomic_load_explicit(&ring->head,
+            memory_order_acquire);
+        const uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for (uint64_t i = first; i < head; ++i) {
+            const TraceEvent *event = &ring->events[i % TRACE_RING_SIZE];
+            // Note: Event names are literals without characters to escape
+            fprintf(stream, ",\n{\"name\": \"%s\", \"cat\": \"%s\", "
+                "\"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, "
+                "\"dur\": %.3f}", event->name,
+                event->track == TRACE_GPU_TRACK ? "gpu" : "cpu", event->track,
+                traceMicroseconds(event->start),
+                (double)(event->end - event->start) * 1e-3);
+        }
+        written += head - first;
+        overwritten += first;
+        
+        TraceRing *next = ring->next;
+        free(ring);
+        ring = next;
+    }
+    atomic_store(&traceRings, NULL);
+    threadRing = NULL;
+    
+    fprintf(stream, "\n]}\n");
+    if (fclose(stream) != 0) {
+        fprintf(stderr, "Failed to write trace\n");
+    } else {
+        printf("Trace written: %llu events (%llu oldest overwritten)\n",
+            (unsigned long long)written, (unsigned long long)overwritten);
+    }
+    traceStream = NULL;
+}
@@ -0,0 +1,133 @@
+#include "vkmemory.h"
+#include "graphics.h"
+
+typedef struct MemoryAllocation {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    MemoryCategory category;
+    uint32_t heapIndex;
+} MemoryAllocation;
+
+static VkPhysicalDevice memoryDevice = VK_NULL_HANDLE;
+static VkBool32 memoryBudgetEnabled = VK_FALSE;
+// Note: Few dozen allocations at most, searched linearly on free
+static MemoryAllocation *allocations = NULL;
+static uint32_t allocationCount = 0;
+static uint32_t allocationCapacity = 0;
+
+static const char *const CATEGORY_NAMES[MEMORY_CATEGORY_COUNT] = {
+    [MEMORY_PARTICLES]   = "particles",
+    [MEMORY_STAGING]     = "staging",
+    [MEMORY_ATTACHMENTS] = "attachments",
+    [MEMORY_UNIFORMS]    = "uniforms",
+    [MEMORY_OTHER]       = "other",
+};
+
+const char *memoryCategoryName(MemoryCategory category)
+{
+    return category < MEMORY_CATEGORY_COUNT ? CATEGORY_NAMES[category] : "?";
+}
+
+void memoryInit(VkPhysicalDevice physicalDevice, VkBool32 budgetEnabled)
+{
+    memoryDevice = physicalDevice;
+    memoryBudgetEnabled = budgetEnabled;
+}
+
+void memoryTrack(VkDeviceMemory memory, VkDeviceSize size,
+    uint32_t memoryTypeIndex, MemoryCategory category)
+{
+    if (allocationCount == allocationCapacity) {
+        allocationCapacity = allocationCapacity ? 2 * allocationCapacity : 64;
+        MemoryAllocation *grown = NULL;
+        CHK_ALLOC(grown = realloc(allocations,
+            allocationCapacity * sizeof(MemoryAllocation)));
+        allocations = grown;
+    }
+    
+    uint32_t heapIndex = 0;
+    if (memoryDevice != VK_NULL_HANDLE) {
+        VkPhysicalDeviceMemoryProperties memProps;
+        vkGetPhysicalDeviceMemoryProperties(memoryDevice, &memProps);
+        heapIndex = memProps.memoryTypes[memoryTypeIndex].heapIndex;
+    }
+    allocations[allocationCount++] = (MemoryAllocation) {
+        memory, size, category, heapIndex
+    };
+}
+
+void freeMemory(VkDevice device, VkDeviceMemory memory)
+{
+    if (memory == VK_NULL_HANDLE) {
+        return;
+    }
+    for (uint32_t i = 0; i < allocationCount; ++i) {
+        if (allocations[i].memory == memory) {
+            allocations[i] = allocations[--allocationCount];
+            break;
+        }
+    }
+    vkFreeMemory(device, memory, NULL);
+}
+
+void memoryGetStats(MemoryStats *stats)
+{
+    *stats = (MemoryStats) {0};
+    
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps = {0};
+    budgetProps.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 memProps = {0};
+    memProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProps.pNext = memoryBudgetEnabled ? &budgetProps : NULL;
+    if (memoryDevice != VK_NULL_HANDLE) {
+        vkGetPhysicalDeviceMemoryProperties2(memoryDevice, &memProps);
+    }
+    const VkPhysicalDeviceMemoryProperties *heaps = &memProps.memoryProperties;
+    
+    VkDeviceSize tracked[VK_MAX_MEMORY_HEAPS] = {0};
+    for (uint32_t i = 0; i < allocationCount; ++i) {
+        stats->allocated[allocations[i].category] += allocations[i].size;
+        tracked[allocations[i].heapIndex] += allocations[i].size;
+    }
+    
+    // Note: Host-visible device-local memory (e.g. integrated GPUs) counts
+    for (uint32_t i = 0; i < heaps->memoryHeapCount; ++i) {
+        if (!(heaps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+            continue;
+        }
+        if (memoryBudgetEnabled) {
+            stats->usage += budgetProps.heapUsage[i];
+            stats->budget += budgetProps.heapBudget[i];
+        } else {
+            stats->usage += tracked[i];
+            stats->budget += heaps->memoryHeaps[i].size / 100 *
+                MEMORY_FALLBACK_BUDGET_PERCENT;
+        }
+    }
+    stats->queried = memoryBudgetEnabled;
+}
+
+void memoryPrintStats(FILE *stream)
+{
+    const double MIB = 1024.0 * 1024.0;
+    MemoryStats stats;
+    memoryGetStats(&stats);
+    
+    fprintf(stream, "memory %.1f / %.1f MiB%s (", stats.usage / MIB,
+        stats.budget / MIB, stats.queried ? "" : " estimated");
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+        fprintf(stream, "%s%s %.1f", i ? ", " : "",
+            memoryCategoryName((MemoryCategory)i), stats.allocated[i] / MIB);
+    }
+    fprintf(stream, ")");
+}
+
+void memoryShutdown(void)
+{
+    FREE_NULL(allocations);
+    allocationCount = 0;
+    allocationCapacity = 0;
+    memoryDevice = VK_NULL_HANDLE;
+    memoryBudgetEnabled = VK_FALSE;
+}
@@ -0,0 +1,324 @@
+#include "vkutils.h"
+
+#include <string.h>
+
+char *readBinFile(const char *fileName, uint32_t *fileSize)
+{
+    FILE *fp = fopen(fileName, "rb");
+    if (!fp) {
+        fprintf(stderr, "Failed to open file: '%s'\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+    
+    // Move to end of file
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fprintf(stderr, "fseek() error: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    *fileSize = (uint32_t) ftell(fp);
+    // Go back to beginning
+    rewind(fp);
+    // Allocate buffer containing file contents
+    char *bin = NULL;
+    CHK_ALLOC(bin = malloc(*fileSize * sizeof(char)));
+    // Read 
+    if (fread(bin, sizeof(char), *fileSize, fp) != *fileSize * sizeof(char)) {
+        fprintf(stderr, "Failed to read file: '%s'\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+    // Cleanup
+    fclose(fp);
+    
+    return bin;
+}
+
+VkImageView createImageView(VkImage image, VkFormat format, 
+    VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkDevice device)
+{
+    VkImageView imageView;
+    
+    VkImageViewCreateInfo viewInfo = {0};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.subresourceRange.aspectMask = aspectFlags;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    
+    CHK_VK_ERR(vkCreateImageView(device, &viewInfo, NULL, 
+        &imageView), "Failed to create image view\n");
+    
+    return imageView;
+}
+
+VkBool32 deviceExtensionSupported(VkPhysicalDevice physicalDevice,
+    const char *name)
+{
+    uint32_t extensionCount = 0;
+    CHK_VK_ERR(vkEnumerateDeviceExtensionProperties(physicalDevice, NULL,
+        &extensionCount, NULL), "Failed to fetch number of device extensions\n");
+    
+    VkExtensionProperties *extensions = NULL;
+    CHK_ALLOC(extensions = malloc((extensionCount + 1) * sizeof(VkExtensionProperties)));
+    CHK_VK_ERR(vkEnumerateDeviceExtensionProperties(physicalDevice, NULL,
+        &extensionCount, extensions), "Failed to list available device extensions\n");
+    
+    VkBool32 found = VK_FALSE;
+    for (uint32_t i = 0; i < extensionCount; ++i) {
+        if (strncmp(name, extensions[i].extensionName, 
+                VK_MAX_EXTENSION_NAME_SIZE) == 0) 
+        {
+            found = VK_TRUE;
+            break;
+        }
+    }
+    free(extensions);
+    
+    return found;
+}
+
+uint32_t findMemoryType(uint32_t typeFilter, 
+    VkMemoryPropertyFlags props, VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+    
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+        if ((typeFilter & (1 << i)) &&
+            (memProps.memoryTypes[i].propertyFlags & props) == props)
+        {
+            return i;
+        }
+    }
+    
+    fprintf(stderr, "Failed to find requested memory type\n");
+    exit(EXIT_FAILURE);
+}
+
+VkDeviceSize deviceLocalHeapSize(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+    
+    VkDeviceSize heapSize = 0;
+    for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i) {
+        if ((memProps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+            memProps.memoryHeaps[i].size > heapSize)
+        {
+            heapSize = memProps.memoryHeaps[i].size;
+        }
+    }
+    return heapSize;
+}
+
+VkMemoryPropertyFlags readbackMemoryProperties(VkPhysicalDevice device)
+{
+    const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(device, &memProps);
+    
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+        if ((memProps.memoryTypes[i].propertyFlags & cached) == cached) {
+            return cached;
+        }
+    }
+    
+    return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+// Allocate and track memory, report accounting when device is out of memory
+static void allocateMemory(VkDevice device, const VkMemoryAllocateInfo *allocInfo,
+    MemoryCategory category, VkDeviceMemory *memory)
+{
+    const VkResult result = vkAllocateMemory(device, allocInfo, NULL, memory);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "Failed to allocate %llu bytes of %s memory: ",
+            (unsigned long long)allocInfo->allocationSize,
+            memoryCategoryName(category));
+        memoryPrintStats(stderr);
+        fprintf(stderr, "\n");
+        exit(EXIT_FAILURE);
+    }
+    memoryTrack(*memory, allocInfo->allocationSize,
+        allocInfo->memoryTypeIndex, category);
+}
+
+void createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
+    VkSampleCountFlagBits nSamples, VkFormat format, VkImageTiling tiling,
+    VkImageUsageFlags usage, VkMemoryPropertyFlags props, 
+    VkImage *image, VkDeviceMemory *imageMemory, VkDevice device, 
+    VkPhysicalDevice physicalDevice, MemoryCategory category)
+{
+    VkImageCreateInfo imageInfo = {0};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;  // 3D extent
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = nSamples;  // #samples per pixel (multisampling)
+    imageInfo.tiling = tiling;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    
+    CHK_VK_ERR(vkCreateImage(device, &imageInfo, NULL, image),
+        "Failed to create image\n");
+    
+    // Get memory requirements of image
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, *image, &memRequirements);
+    
+    VkMemoryAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(
+        memRequirements.memoryTypeBits, props, physicalDevice
+    );
+    
+    // Allocate image memory
+    allocateMemory(device, &allocInfo, category, imageMemory);
+    
+    // Bind device memory to image
+    CHK_VK_ERR(vkBindImageMemory(device, *image, *imageMemory, 0),
+        "Failed to bind device memory to image\n");
+}
+
+VkShaderModule createShaderModule(VkDevice device, 
+    const char *code, uint32_t codeSize)
+{
+    VkShaderModuleCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = codeSize;
+    createInfo.pCode = (const uint32_t *)code;
+    
+    VkShaderModule shaderModule;
+    CHK_VK_ERR(vkCreateShaderModule(device, &createInfo, NULL, 
+        &shaderModule), "Failed to create shader module\n");
+    
+    return shaderModule;
+}
+
+void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+    VkDeviceSize size, VkBufferUsageFlags usage, 
+    VkMemoryPropertyFlags properties, VkBuffer *buffer, 
+    VkDeviceMemory *bufferMemory, MemoryCategory category)
+{
+    VkBufferCreateInfo createInfo = {0};
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    createInfo.size = size;
+    createInfo.usage = usage;
+    // Only accessed by single queue family
+    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.queueFamilyIndexCount = 0;  // optional
+    createInfo.pQueueFamilyIndices = NULL;  // optional
+    
+    CHK_VK_ERR(vkCreateBuffer(device, &createInfo, NULL, buffer),
+        "Failed to create buffer\n");
+    
+    // Query memory requirements of this buffer
+    VkMemoryRequirements memReq;
+    vkGetBufferMemoryRequirements(device, *buffer, &memReq);
+    
+    VkMemoryAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits,
+        properties, physicalDevice);
+    
+    // Allocate required memory for buffer
+    allocateMemory(device, &allocInfo, category, bufferMemory);
+    
+    // Bind buffer memory to buffer object
+    CHK_VK_ERR(vkBindBufferMemory(device, *buffer, *bufferMemory, 0),
+        "Failed to bind memory to buffer\n");
+}
+
+VkCommandBuffer beginSingleUseCommands(Graphics graphics)
+{
+    VkCommandBufferAllocateInfo allocInfo = {0};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = graphics->commandPool;
+    allocInfo.commandBufferCount = 1;
+    
+    VkCommandBuffer commandBuffer;
+    CHK_VK_ERR(vkAllocateCommandBuffers(graphics->device, &allocInfo,
+        &commandBuffer), "Failed to allocate single use command buffer\n");
+    
+    // Begin recording commands to single time command buffer
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // Commands of command buffer are only submitted once 
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    
+    CHK_VK_ERR(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+        "Failed to begin recording single use command buffer\n");
+    
+    return commandBuffer;
+}
+
+void endSingleUseCommands(Graphics graphics, 
+    VkCommandBuffer commandBuffer)
+{
+    // End recording commands
+    CHK_VK_ERR(vkEndCommandBuffer(commandBuffer), 
+        "Failed to end recording single use command buffer\n");
+    
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    
+    // Note: Wait on fence instead of queue to be idle
+    // Submit command buffer to graphics queue
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    
+    VkFence fence;
+    CHK_VK_ERR(vkCreateFence(graphics->device, &fenceInfo, NULL, &fence),
+        "Failed to create fence for single use command buffer\n");
+    
+    CHK_VK_ERR(vkQueueSubmit(graphics->graphicsQueue, 1, &submitInfo,
+        fence), "Failed to submit single use command buffer to graphics queue\n");
+    // Wait until commands recorded to command buffer are executed
+    // (timeout is maximum possible value)
+    CHK_VK_ERR(vkWaitForFences(graphics->device, 1, &fence, VK_TRUE,
+        UINT64_MAX), "Failed to wait for single use command buffer completion\n");
+    
+    // Cleanup
+    vkDestroyFence(graphics->device, fence, NULL);
+    vkFreeCommandBuffers(graphics->device, graphics->commandPool,
+        1, &commandBuffer);
+}
+
+void copyBuffer(Graphics graphics, VkBuffer src, VkBuffer dst, 
+    VkDeviceSize size)
+{
+    VkCommandBuffer commandBuffer = beginSingleUseCommands(graphics);
+    
+    VkBufferCopy copyRegion = {0};
+    // No offsets
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = size;
+    
+    // Record command to copy buffer data
+    vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
+    
+    // Cleanup
+    endSingleUseCommands(graphics, commandBuffer);
+}